@@ -0,0 +1,58 @@
+#ifndef P7_HMM_READER_BINARY_CURSOR_H
+#define P7_HMM_READER_BINARY_CURSOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+
+//bounds checked read position in a binary file that's been loaded or mapped into memory.
+struct P7BinaryCursor{
+  const char *position;
+  const char *end;
+  bool swapBytes;     //true if the file was written with the other byte order
+};
+
+
+static inline uint32_t p7SwapUint32(const uint32_t value){
+  return (value >> 24) | ((value >> 8) & 0xFF00u) | ((value << 8) & 0xFF0000u) | (value << 24);
+}
+
+static inline size_t p7BinaryRemaining(const struct P7BinaryCursor *cursor){
+  return cursor->end - cursor->position;
+}
+
+//copies length bytes to data, returning false (without reading anything) if the file is too short.
+static inline bool p7BinaryRead(struct P7BinaryCursor *cursor, void *data, const size_t length){
+  if(p7BinaryRemaining(cursor) < length){
+    return false;
+  }
+  memcpy(data, cursor->position, length);
+  cursor->position += length;
+  return true;
+}
+
+static inline bool p7BinarySkip(struct P7BinaryCursor *cursor, const size_t length){
+  if(p7BinaryRemaining(cursor) < length){
+    return false;
+  }
+  cursor->position += length;
+  return true;
+}
+
+//reads an array of 32 bit values (uint32_t, int32_t, or float), swapping them to the native byte order if needed.
+static inline bool p7BinaryReadWords(struct P7BinaryCursor *cursor, void *data, const size_t numWords){
+  if(numWords > p7BinaryRemaining(cursor) / sizeof(uint32_t) || !p7BinaryRead(cursor, data, numWords * sizeof(uint32_t))){
+    return false;
+  }
+  if(cursor->swapBytes){
+    uint32_t *words = data;
+    for(size_t i = 0; i < numWords; i++){
+      words[i] = p7SwapUint32(words[i]);
+    }
+  }
+  return true;
+}
+
+#endif
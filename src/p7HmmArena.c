@@ -0,0 +1,70 @@
+#include <stdlib.h>
+#include "p7HmmArena.h"
+#include "p7ProfileHmm.h"
+
+
+//large enough to hold dozens of typical Pfam models, so slabs are rarely allocated
+#define P7_ARENA_SLAB_LENGTH (1 << 22)
+//the slab header is padded, so the first allocation in every slab is aligned
+#define P7_ARENA_SLAB_HEADER_LENGTH P7_MODEL_DATA_ALIGNMENT
+
+
+static inline size_t p7ArenaAlign(const size_t length, const size_t alignment){
+  return (length + alignment - 1) & ~(alignment - 1);
+}
+
+struct P7HmmArena *p7HmmArenaCreate(void){
+  return calloc(1, sizeof(struct P7HmmArena));
+}
+
+//alignment must be a power of two, no larger than P7_MODEL_DATA_ALIGNMENT
+static void *p7ArenaAllocAligned(struct P7HmmArena *arena, size_t length, const size_t alignment){
+  length = length == 0? 1: length;
+  struct P7HmmArenaSlab *slab = arena->slabs;
+  size_t start = slab == NULL? 0: p7ArenaAlign(slab->used, alignment);
+  if(slab == NULL || start > slab->length || slab->length - start < length){
+    const size_t slabLength = length > P7_ARENA_SLAB_LENGTH? p7ArenaAlign(length, P7_MODEL_DATA_ALIGNMENT):
+      P7_ARENA_SLAB_LENGTH;
+    struct P7HmmArenaSlab *newSlab = aligned_alloc(P7_MODEL_DATA_ALIGNMENT, P7_ARENA_SLAB_HEADER_LENGTH + slabLength);
+    if(newSlab == NULL){
+      return NULL;
+    }
+    newSlab->length = slabLength;
+    newSlab->used = 0;
+    //an oversized request doesn't take the place of a slab that still has room
+    if(slab != NULL && slabLength > P7_ARENA_SLAB_LENGTH){
+      newSlab->next = slab->next;
+      slab->next = newSlab;
+    }
+    else{
+      newSlab->next = slab;
+      arena->slabs = newSlab;
+    }
+    slab = newSlab;
+    start = 0;
+  }
+  void *allocation = (char*)slab + P7_ARENA_SLAB_HEADER_LENGTH + start;
+  slab->used = start + length;
+  return allocation;
+}
+
+void *p7HmmArenaAlloc(struct P7HmmArena *arena, const size_t length){
+  return p7ArenaAllocAligned(arena, length, P7_MODEL_DATA_ALIGNMENT);
+}
+
+char *p7HmmArenaAllocString(struct P7HmmArena *arena, const size_t length){
+  return p7ArenaAllocAligned(arena, length, 1);
+}
+
+void p7HmmArenaDestroy(struct P7HmmArena *arena){
+  if(arena == NULL){
+    return;
+  }
+  struct P7HmmArenaSlab *slab = arena->slabs;
+  while(slab != NULL){
+    struct P7HmmArenaSlab *nextSlab = slab->next;
+    free(slab);
+    slab = nextSlab;
+  }
+  free(arena);
+}
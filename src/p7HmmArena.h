@@ -0,0 +1,72 @@
+#ifndef P7_HMM_READER_ARENA_H
+#define P7_HMM_READER_ARENA_H
+
+#include <stddef.h>
+#include "p7HmmReader.h"
+
+
+//one large allocation that model data and strings are carved out of, in order.
+struct P7HmmArenaSlab{
+  struct P7HmmArenaSlab *next;
+  size_t length;      //usable bytes after the slab header
+  size_t used;
+};
+
+struct P7HmmArena{
+  struct P7HmmArenaSlab *slabs;   //most recently added slab first, the only one still being filled
+};
+
+
+/*
+ * Function:  p7HmmArenaCreate
+ * --------------------
+ * Allocates an empty arena. No slab is allocated until the first p7HmmArenaAlloc call.
+ *
+ *  Returns:
+ *    the new arena, or NULL if it could not be allocated.
+ */
+struct P7HmmArena *p7HmmArenaCreate(void);
+
+/*
+ * Function:  p7HmmArenaAlloc
+ * --------------------
+ * Carves the requested number of bytes out of the arena's current slab, starting a new
+ *  slab when it's full. Requests larger than a slab get a slab of their own. Every allocation
+ *  is aligned to P7_MODEL_DATA_ALIGNMENT bytes. Memory can't be freed individually, only
+ *  all at once with p7HmmArenaDestroy.
+ *
+ *  Inputs:
+ *    arena: arena to allocate from.
+ *    length: number of bytes to allocate.
+ *
+ *  Returns:
+ *    pointer to the allocated bytes, or NULL if a new slab could not be allocated.
+ */
+void *p7HmmArenaAlloc(struct P7HmmArena *arena, const size_t length);
+
+/*
+ * Function:  p7HmmArenaAllocString
+ * --------------------
+ * Carves space for a string out of the arena like p7HmmArenaAlloc, but without any alignment,
+ *  so short header strings are packed together instead of each taking a cache line.
+ *
+ *  Inputs:
+ *    arena: arena to allocate from.
+ *    length: number of bytes to allocate, including the terminator.
+ *
+ *  Returns:
+ *    pointer to the allocated bytes, or NULL if a new slab could not be allocated.
+ */
+char *p7HmmArenaAllocString(struct P7HmmArena *arena, const size_t length);
+
+/*
+ * Function:  p7HmmArenaDestroy
+ * --------------------
+ * Frees every slab in the arena, and the arena itself.
+ *
+ *  Inputs:
+ *    arena: arena to free, or NULL.
+ */
+void p7HmmArenaDestroy(struct P7HmmArena *arena);
+
+#endif
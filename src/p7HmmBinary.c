@@ -0,0 +1,348 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "p7HmmReader.h"
+#include "p7HmmFileMap.h"
+#include "p7BinaryCursor.h"
+#include "p7ProfileHmm.h"
+#include "p7HmmReaderLog.h"
+
+
+#define P7_BINARY_MAGIC         "P7HMMBIN"
+#define P7_BINARY_MAGIC_LENGTH  8
+#define P7_BINARY_VERSION       2
+//written in the writer's native byte order, so readers can tell if they need to swap
+#define P7_BINARY_ENDIAN_TAG    0x01020304u
+#define P7_BINARY_ALIGNMENT     4
+
+#define P7_BINARY_HAS_REFERENCE_ANNOTATION  (1u << 0)
+#define P7_BINARY_HAS_MODEL_MASK            (1u << 1)
+#define P7_BINARY_HAS_CONSENSUS_RESIDUE     (1u << 2)
+#define P7_BINARY_HAS_CONSENSUS_STRUCTURE   (1u << 3)
+#define P7_BINARY_HAS_MAP_ANNOTATION        (1u << 4)
+#define P7_BINARY_HAS_COMPO                 (1u << 5)
+
+_Static_assert(sizeof(float) == sizeof(uint32_t), "binary format requires 32 bit floats");
+_Static_assert(sizeof(bool) == 1, "binary format stores the model mask as one byte per node");
+
+
+static bool p7BinaryWrite(FILE *file, const void *data, const size_t length){
+  return length == 0 || fwrite(data, 1, length, file) == length;
+}
+
+//writes zeros up to the next multiple of P7_BINARY_ALIGNMENT, so the arrays after strings stay 4 byte aligned.
+static bool p7BinaryWritePadding(FILE *file, const size_t length){
+  static const char padding[P7_BINARY_ALIGNMENT] = {0};
+  const size_t paddingLength = (P7_BINARY_ALIGNMENT - (length % P7_BINARY_ALIGNMENT)) % P7_BINARY_ALIGNMENT;
+  return p7BinaryWrite(file, padding, paddingLength);
+}
+
+static bool p7BinaryWriteUint32(FILE *file, const uint32_t value){
+  return p7BinaryWrite(file, &value, sizeof(uint32_t));
+}
+
+//strings are written as their length plus one (0 for NULL), followed by the characters without the terminator.
+static bool p7BinaryWriteString(FILE *file, const char *string){
+  if(string == NULL){
+    return p7BinaryWriteUint32(file, 0);
+  }
+  const size_t stringLength = strlen(string);
+  return p7BinaryWriteUint32(file, stringLength + 1) && p7BinaryWrite(file, string, stringLength) &&
+    p7BinaryWritePadding(file, stringLength);
+}
+
+static bool p7BinaryWriteHmm(FILE *file, const struct P7Hmm *phmm){
+  const struct P7Header *header = &phmm->header;
+  const struct P7Model *model = &phmm->model;
+  const uint32_t alphabetCardinality = p7HmmGetAlphabetCardinality(phmm);
+  const uint32_t modelLength = header->modelLength;
+
+  uint32_t flags = 0;
+  flags |= header->hasReferenceAnnotation? P7_BINARY_HAS_REFERENCE_ANNOTATION: 0;
+  flags |= header->hasModelMask?           P7_BINARY_HAS_MODEL_MASK: 0;
+  flags |= header->hasConsensusResidue?    P7_BINARY_HAS_CONSENSUS_RESIDUE: 0;
+  flags |= header->hasConsensusStructure?  P7_BINARY_HAS_CONSENSUS_STRUCTURE: 0;
+  flags |= header->hasMapAnnotation?       P7_BINARY_HAS_MAP_ANNOTATION: 0;
+  flags |= model->compo != NULL?           P7_BINARY_HAS_COMPO: 0;
+
+  const float headerFloats[7] = {header->effectiveNumSequences,
+    header->gatheringThresholds[0], header->gatheringThresholds[1], header->trustedCutoffs[0],
+    header->trustedCutoffs[1], header->noiseCutoffs[0], header->noiseCutoffs[1]};
+  const float statsFloats[6] = {phmm->stats.msvGumbelMu, phmm->stats.msvGumbelLambda, phmm->stats.viterbiGumbelMu,
+    phmm->stats.viterbiGumbelLambda, phmm->stats.forwardTau, phmm->stats.forwardLambda};
+  const float initialTransitions[5] = {model->initialTransitions.beginToM1, model->initialTransitions.beginToInsert0,
+    model->initialTransitions.beginToDelete1, model->initialTransitions.insert0ToMatch1,
+    model->initialTransitions.insert0ToInsert0};
+  const float *const transitions[7] = {model->stateTransitions.matchToMatch, model->stateTransitions.matchToInsert,
+    model->stateTransitions.matchToDelete, model->stateTransitions.insertToMatch, model->stateTransitions.insertToInsert,
+    model->stateTransitions.deleteToMatch, model->stateTransitions.deleteToDelete};
+
+  bool writeSucceeded = p7BinaryWriteUint32(file, flags) && p7BinaryWriteUint32(file, header->alphabet) &&
+    p7BinaryWriteUint32(file, modelLength) && p7BinaryWriteUint32(file, header->maxLength) &&
+    p7BinaryWriteUint32(file, header->checksum) && p7BinaryWriteUint32(file, header->numSequences) &&
+    p7BinaryWrite(file, headerFloats, sizeof(headerFloats)) && p7BinaryWrite(file, statsFloats, sizeof(statsFloats)) &&
+    p7BinaryWrite(file, initialTransitions, sizeof(initialTransitions)) &&
+    p7BinaryWriteString(file, header->name) && p7BinaryWriteString(file, header->version) &&
+    p7BinaryWriteString(file, header->accessionNumber) && p7BinaryWriteString(file, header->description) &&
+    p7BinaryWriteString(file, header->date) && p7BinaryWriteString(file, header->commandLineHistory) &&
+    p7BinaryWriteString(file, header->buildCommand) && p7BinaryWriteString(file, header->searchCommand);
+
+  if(writeSucceeded && (flags & P7_BINARY_HAS_COMPO)){
+    writeSucceeded = p7BinaryWrite(file, model->compo, alphabetCardinality * sizeof(float));
+  }
+  writeSucceeded = writeSucceeded &&
+    p7BinaryWrite(file, model->insert0Emissions, alphabetCardinality * sizeof(float)) &&
+    p7BinaryWrite(file, model->matchEmissionScores, (size_t)alphabetCardinality * modelLength * sizeof(float));
+  //written a row at a time, so models with compacted insert emissions are stored in full
+  for(uint32_t node = 0; node < modelLength && writeSucceeded; node++){
+    writeSucceeded = p7BinaryWrite(file, p7HmmGetInsertEmissionRow(phmm, node), alphabetCardinality * sizeof(float));
+  }
+  for(uint32_t i = 0; i < 7 && writeSucceeded; i++){
+    writeSucceeded = p7BinaryWrite(file, transitions[i], modelLength * sizeof(float));
+  }
+  if(writeSucceeded && header->hasMapAnnotation){
+    writeSucceeded = p7BinaryWrite(file, model->mapAnnotations, modelLength * sizeof(uint32_t));
+  }
+  //the one byte per node annotations come last, so a single padding keeps the next model aligned
+  if(writeSucceeded && header->hasConsensusResidue){
+    writeSucceeded = p7BinaryWrite(file, model->consensusResidues, modelLength);
+  }
+  if(writeSucceeded && header->hasReferenceAnnotation){
+    writeSucceeded = p7BinaryWrite(file, model->referenceAnnotation, modelLength);
+  }
+  if(writeSucceeded && header->hasModelMask){
+    writeSucceeded = p7BinaryWrite(file, model->modelMask, modelLength);
+  }
+  if(writeSucceeded && header->hasConsensusStructure){
+    writeSucceeded = p7BinaryWrite(file, model->consensusStructure, modelLength);
+  }
+  const uint32_t numByteAnnotations = header->hasConsensusResidue + header->hasReferenceAnnotation +
+    header->hasModelMask + header->hasConsensusStructure;
+  return writeSucceeded && p7BinaryWritePadding(file, (size_t)numByteAnnotations * modelLength);
+}
+
+
+enum P7HmmReturnCode p7HmmListWriteBinary(const struct P7HmmList *phmmList, const char *const fileSrc){
+  //every model is stored with its float scores and insert emissions, so models without them can't be written
+  for(uint32_t i = 0; i < phmmList->count; i++){
+    const struct P7Model *model = &phmmList->phmms[i].model;
+    if(model->matchEmissionScores == NULL || (model->insertEmissionScores == NULL && model->insertRowIndices == NULL)){
+      printFormatError(fileSrc, 0, "can't write a quantized model, or one loaded without its insert emissions.");
+      return p7HmmFormatError;
+    }
+  }
+  FILE *file = fopen(fileSrc, "wb");
+  if(file == NULL){
+    return p7HmmFileNotFound;
+  }
+  bool writeSucceeded = p7BinaryWrite(file, P7_BINARY_MAGIC, P7_BINARY_MAGIC_LENGTH) &&
+    p7BinaryWriteUint32(file, P7_BINARY_ENDIAN_TAG) && p7BinaryWriteUint32(file, P7_BINARY_VERSION) &&
+    p7BinaryWriteUint32(file, phmmList->count) && p7BinaryWriteUint32(file, 0);
+  for(uint32_t i = 0; i < phmmList->count && writeSucceeded; i++){
+    writeSucceeded = p7BinaryWriteHmm(file, &phmmList->phmms[i]);
+  }
+  if(fclose(file) != 0){
+    writeSucceeded = false;
+  }
+  return writeSucceeded? p7HmmSuccess: p7HmmFileNotFound;
+}
+
+
+static bool p7BinarySkipPadding(struct P7BinaryCursor *cursor, const size_t length){
+  const size_t paddingLength = (P7_BINARY_ALIGNMENT - (length % P7_BINARY_ALIGNMENT)) % P7_BINARY_ALIGNMENT;
+  return p7BinarySkip(cursor, paddingLength);
+}
+
+//returns false if the string was truncated or couldn't be allocated. NULL strings are read back as NULL.
+static bool p7BinaryReadString(struct P7BinaryCursor *cursor, char **string){
+  uint32_t stringLengthWithTerminator;
+  if(!p7BinaryReadWords(cursor, &stringLengthWithTerminator, 1)){
+    return false;
+  }
+  if(stringLengthWithTerminator == 0){
+    *string = NULL;
+    return true;
+  }
+  const size_t stringLength = stringLengthWithTerminator - 1;
+  if(p7BinaryRemaining(cursor) < stringLength){
+    return false;
+  }
+  *string = malloc(stringLength + 1);
+  if(*string == NULL){
+    return false;
+  }
+  memcpy(*string, cursor->position, stringLength);
+  (*string)[stringLength] = 0;
+  cursor->position += stringLength;
+  return p7BinarySkipPadding(cursor, stringLength);
+}
+
+static enum P7HmmReturnCode p7BinaryReadHmm(struct P7BinaryCursor *cursor, struct P7Hmm *phmm){
+  struct P7Header *header = &phmm->header;
+  struct P7Model *model = &phmm->model;
+
+  uint32_t fixedWords[6];
+  float headerFloats[7];
+  float statsFloats[6];
+  float initialTransitions[5];
+  if(!p7BinaryReadWords(cursor, fixedWords, 6) || !p7BinaryReadWords(cursor, headerFloats, 7) ||
+    !p7BinaryReadWords(cursor, statsFloats, 6) || !p7BinaryReadWords(cursor, initialTransitions, 5)){
+    return p7HmmFormatError;
+  }
+  const uint32_t flags = fixedWords[0];
+  if(fixedWords[1] >= P7HmmReaderAlphabetNotSet){
+    return p7HmmFormatError;
+  }
+  header->alphabet = fixedWords[1];
+  header->modelLength = fixedWords[2];
+  header->maxLength = fixedWords[3];
+  header->checksum = fixedWords[4];
+  header->numSequences = fixedWords[5];
+  header->hasReferenceAnnotation = flags & P7_BINARY_HAS_REFERENCE_ANNOTATION;
+  header->hasModelMask = flags & P7_BINARY_HAS_MODEL_MASK;
+  header->hasConsensusResidue = flags & P7_BINARY_HAS_CONSENSUS_RESIDUE;
+  header->hasConsensusStructure = flags & P7_BINARY_HAS_CONSENSUS_STRUCTURE;
+  header->hasMapAnnotation = flags & P7_BINARY_HAS_MAP_ANNOTATION;
+  header->effectiveNumSequences = headerFloats[0];
+  header->gatheringThresholds[0] = headerFloats[1];
+  header->gatheringThresholds[1] = headerFloats[2];
+  header->trustedCutoffs[0] = headerFloats[3];
+  header->trustedCutoffs[1] = headerFloats[4];
+  header->noiseCutoffs[0] = headerFloats[5];
+  header->noiseCutoffs[1] = headerFloats[6];
+  phmm->stats.msvGumbelMu = statsFloats[0];
+  phmm->stats.msvGumbelLambda = statsFloats[1];
+  phmm->stats.viterbiGumbelMu = statsFloats[2];
+  phmm->stats.viterbiGumbelLambda = statsFloats[3];
+  phmm->stats.forwardTau = statsFloats[4];
+  phmm->stats.forwardLambda = statsFloats[5];
+  model->initialTransitions.beginToM1 = initialTransitions[0];
+  model->initialTransitions.beginToInsert0 = initialTransitions[1];
+  model->initialTransitions.beginToDelete1 = initialTransitions[2];
+  model->initialTransitions.insert0ToMatch1 = initialTransitions[3];
+  model->initialTransitions.insert0ToInsert0 = initialTransitions[4];
+
+  if(!p7BinaryReadString(cursor, &header->name) || !p7BinaryReadString(cursor, &header->version) ||
+    !p7BinaryReadString(cursor, &header->accessionNumber) || !p7BinaryReadString(cursor, &header->description) ||
+    !p7BinaryReadString(cursor, &header->date) || !p7BinaryReadString(cursor, &header->commandLineHistory) ||
+    !p7BinaryReadString(cursor, &header->buildCommand) || !p7BinaryReadString(cursor, &header->searchCommand)){
+    return p7HmmFormatError;
+  }
+
+  const uint32_t alphabetCardinality = p7HmmGetAlphabetCardinality(phmm);
+  const uint32_t modelLength = header->modelLength;
+  //make sure the model fits in what's left of the file before allocating anything for it
+  const size_t numModelWords = (size_t)alphabetCardinality * (2 * (size_t)modelLength + 1) + 7 * (size_t)modelLength;
+  if(numModelWords > p7BinaryRemaining(cursor) / sizeof(uint32_t)){
+    return p7HmmFormatError;
+  }
+  enum P7HmmReturnCode returnCode = p7HmmAllocateModelData(phmm, true, NULL);
+  if(returnCode != p7HmmSuccess){
+    return returnCode;
+  }
+  if(flags & P7_BINARY_HAS_COMPO){
+    if(!p7BinaryReadWords(cursor, p7HmmAttachCompo(phmm), alphabetCardinality)){
+      return p7HmmFormatError;
+    }
+  }
+
+  float *const transitions[7] = {model->stateTransitions.matchToMatch, model->stateTransitions.matchToInsert,
+    model->stateTransitions.matchToDelete, model->stateTransitions.insertToMatch, model->stateTransitions.insertToInsert,
+    model->stateTransitions.deleteToMatch, model->stateTransitions.deleteToDelete};
+  bool readSucceeded = p7BinaryReadWords(cursor, model->insert0Emissions, alphabetCardinality) &&
+    p7BinaryReadWords(cursor, model->matchEmissionScores, (size_t)alphabetCardinality * modelLength) &&
+    p7BinaryReadWords(cursor, model->insertEmissionScores, (size_t)alphabetCardinality * modelLength);
+  for(uint32_t i = 0; i < 7 && readSucceeded; i++){
+    readSucceeded = p7BinaryReadWords(cursor, transitions[i], modelLength);
+  }
+  if(readSucceeded && header->hasMapAnnotation){
+    readSucceeded = p7BinaryReadWords(cursor, model->mapAnnotations, modelLength);
+  }
+  if(readSucceeded && header->hasConsensusResidue){
+    readSucceeded = p7BinaryRead(cursor, model->consensusResidues, modelLength);
+  }
+  if(readSucceeded && header->hasReferenceAnnotation){
+    readSucceeded = p7BinaryRead(cursor, model->referenceAnnotation, modelLength);
+  }
+  if(readSucceeded && header->hasModelMask){
+    readSucceeded = p7BinaryRead(cursor, model->modelMask, modelLength);
+  }
+  if(readSucceeded && header->hasConsensusStructure){
+    readSucceeded = p7BinaryRead(cursor, model->consensusStructure, modelLength);
+  }
+  const uint32_t numByteAnnotations = header->hasConsensusResidue + header->hasReferenceAnnotation +
+    header->hasModelMask + header->hasConsensusStructure;
+  if(!readSucceeded || !p7BinarySkipPadding(cursor, (size_t)numByteAnnotations * modelLength)){
+    return p7HmmFormatError;
+  }
+  return p7HmmSuccess;
+}
+
+enum P7HmmReturnCode p7HmmListReadBinary(const char *const fileSrc, struct P7HmmList *phmmList){
+  p7HmmListInit(phmmList);
+
+  struct P7HmmFileMap fileMap;
+  enum P7HmmReturnCode returnCode = p7HmmFileMapOpen(fileSrc, &fileMap);
+  if(returnCode != p7HmmSuccess){
+    return returnCode;
+  }
+  struct P7BinaryCursor cursor = {.position = fileMap.data, .end = fileMap.data + fileMap.length, .swapBytes = false};
+
+  char magic[P7_BINARY_MAGIC_LENGTH];
+  uint32_t endianTag, version, numModels, reserved;
+  if(!p7BinaryRead(&cursor, magic, P7_BINARY_MAGIC_LENGTH) || memcmp(magic, P7_BINARY_MAGIC, P7_BINARY_MAGIC_LENGTH) != 0 ||
+    !p7BinaryRead(&cursor, &endianTag, sizeof(uint32_t))){
+    printFormatError(fileSrc, 0, "file is not a binary P7Hmm list (missing 'P7HMMBIN' magic number).");
+    p7HmmFileMapClose(&fileMap);
+    return p7HmmFormatError;
+  }
+  if(endianTag == p7SwapUint32(P7_BINARY_ENDIAN_TAG)){
+    cursor.swapBytes = true;
+  }
+  else if(endianTag != P7_BINARY_ENDIAN_TAG){
+    printFormatError(fileSrc, 0, "binary P7Hmm list has an unrecognized byte order tag.");
+    p7HmmFileMapClose(&fileMap);
+    return p7HmmFormatError;
+  }
+  if(!p7BinaryReadWords(&cursor, &version, 1) || !p7BinaryReadWords(&cursor, &numModels, 1) ||
+    !p7BinaryReadWords(&cursor, &reserved, 1) || version != P7_BINARY_VERSION){
+    printFormatError(fileSrc, 0, "binary P7Hmm list is truncated, or was written with an unsupported version.");
+    p7HmmFileMapClose(&fileMap);
+    return p7HmmFormatError;
+  }
+
+  //every model takes at least this many bytes, so a corrupt count can't cause a huge allocation
+  const size_t minModelLength = 24 * sizeof(uint32_t) + 6 * sizeof(uint32_t);
+  if(numModels > p7BinaryRemaining(&cursor) / minModelLength){
+    printFormatError(fileSrc, 0, "binary P7Hmm list is truncated.");
+    p7HmmFileMapClose(&fileMap);
+    return p7HmmFormatError;
+  }
+  if(numModels != 0){
+    phmmList->phmms = malloc(numModels * sizeof(struct P7Hmm));
+    if(phmmList->phmms == NULL){
+      printAllocationError(fileSrc, 0, "could not allocate memory for the P7ProfileHmmList list.");
+      p7HmmFileMapClose(&fileMap);
+      return p7HmmAllocationFailure;
+    }
+    phmmList->capacity = numModels;
+  }
+  for(uint32_t i = 0; i < numModels && returnCode == p7HmmSuccess; i++){
+    //count the model before reading it, so a partially read model is still deallocated on failure
+    p7HmmInit(&phmmList->phmms[i]);
+    phmmList->count++;
+    returnCode = p7BinaryReadHmm(&cursor, &phmmList->phmms[i]);
+    if(returnCode == p7HmmAllocationFailure){
+      printAllocationError(fileSrc, 0, "could not allocate memory for model data.");
+    }
+    else if(returnCode != p7HmmSuccess){
+      printFormatError(fileSrc, 0, "binary P7Hmm list is truncated or corrupt.");
+    }
+  }
+
+  p7HmmFileMapClose(&fileMap);
+  if(returnCode != p7HmmSuccess){
+    p7HmmListDealloc(phmmList);
+  }
+  return returnCode;
+}
@@ -0,0 +1,475 @@
+#define  _POSIX_C_SOURCE 200809L     //required for fseeko
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <zlib.h>
+#include "p7HmmReader.h"
+#include "p7HmmParser.h"
+#include "p7HmmParallel.h"
+#include "p7HmmFileMap.h"
+#include "p7HmmLineSource.h"
+#include "p7ProfileHmm.h"
+#include "p7HmmReaderLog.h"
+
+
+#define P7_BLOCK_INDEX_EXTENSION    ".p7bi"
+#define P7_BLOCK_INDEX_MAGIC        "P7HMM_BLOCK_INDEX"
+#define P7_BLOCK_INDEX_VERSION      1
+#define P7_BLOCK_DEFAULT_LENGTH     (1 << 18)
+//each block is written as a complete gzip member, so the container is still a valid gzip file
+#define P7_GZIP_WINDOW_BITS         (15 + 16)
+
+
+struct P7HmmBlock{
+  uint64_t compressedOffset;
+  uint64_t compressedLength;
+  uint64_t uncompressedLength;
+  uint64_t numLines;
+  uint32_t numModels;
+};
+
+struct P7HmmBlockIndex{
+  struct P7HmmBlock *blocks;
+  uint32_t numBlocks;
+};
+
+struct P7HmmBlockWork{
+  const char *fileSrc;
+  const char *containerData;
+  const struct P7HmmBlockIndex *index;
+  uint64_t *firstLineNumbers;
+  struct P7HmmList *blockLists;
+  enum P7HmmReturnCode *blockReturnCodes;
+  atomic_uint_fast32_t nextBlockIndex;
+};
+
+
+//returns a newly allocated string holding the location of the container's index file.
+static char *p7BlockIndexSrc(const char *const fileSrc){
+  const size_t fileSrcLength = strlen(fileSrc);
+  char *indexSrc = malloc(fileSrcLength + sizeof(P7_BLOCK_INDEX_EXTENSION));
+  if(indexSrc != NULL){
+    memcpy(indexSrc, fileSrc, fileSrcLength);
+    memcpy(indexSrc + fileSrcLength, P7_BLOCK_INDEX_EXTENSION, sizeof(P7_BLOCK_INDEX_EXTENSION));
+  }
+  return indexSrc;
+}
+
+static enum P7HmmReturnCode p7BlockIndexRead(const char *const fileSrc, struct P7HmmBlockIndex *index){
+  index->blocks = NULL;
+  index->numBlocks = 0;
+  char *indexSrc = p7BlockIndexSrc(fileSrc);
+  if(indexSrc == NULL){
+    printAllocationError(fileSrc, 0, "failed to allocate memory for the block index file name.");
+    return p7HmmAllocationFailure;
+  }
+  FILE *indexFile = fopen(indexSrc, "r");
+  if(indexFile == NULL){
+    free(indexSrc);
+    return p7HmmFileNotFound;
+  }
+
+  enum P7HmmReturnCode returnCode = p7HmmSuccess;
+  char magic[sizeof(P7_BLOCK_INDEX_MAGIC)];
+  unsigned int version;
+  uint32_t numBlocks;
+  if(fscanf(indexFile, "%17s %u %" SCNu32, magic, &version, &numBlocks) != 3 ||
+    strcmp(magic, P7_BLOCK_INDEX_MAGIC) != 0 || version != P7_BLOCK_INDEX_VERSION){
+    printFormatError(indexSrc, 1, "block index does not start with a supported block index header.");
+    returnCode = p7HmmFormatError;
+  }
+  else{
+    index->blocks = malloc((numBlocks > 0? numBlocks: 1) * sizeof(struct P7HmmBlock));
+    if(index->blocks == NULL){
+      printAllocationError(indexSrc, 1, "failed to allocate memory for the block index.");
+      returnCode = p7HmmAllocationFailure;
+    }
+  }
+  for(uint32_t i = 0; returnCode == p7HmmSuccess && i < numBlocks; i++){
+    struct P7HmmBlock *block = &index->blocks[i];
+    if(fscanf(indexFile, "%" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu32, &block->compressedOffset,
+      &block->compressedLength, &block->uncompressedLength, &block->numLines, &block->numModels) != 5){
+      printFormatError(indexSrc, i + 2, "could not read block index entry.");
+      returnCode = p7HmmFormatError;
+    }
+    index->numBlocks = i + 1;
+  }
+
+  fclose(indexFile);
+  free(indexSrc);
+  if(returnCode != p7HmmSuccess){
+    free(index->blocks);
+    index->blocks = NULL;
+    index->numBlocks = 0;
+  }
+  return returnCode;
+}
+
+static enum P7HmmReturnCode p7BlockIndexWrite(const char *const fileSrc, const struct P7HmmBlockIndex *index){
+  char *indexSrc = p7BlockIndexSrc(fileSrc);
+  if(indexSrc == NULL){
+    printAllocationError(fileSrc, 0, "failed to allocate memory for the block index file name.");
+    return p7HmmAllocationFailure;
+  }
+  FILE *indexFile = fopen(indexSrc, "w");
+  free(indexSrc);
+  if(indexFile == NULL){
+    return p7HmmFileNotFound;
+  }
+  fprintf(indexFile, "%s %u %" PRIu32 "\n", P7_BLOCK_INDEX_MAGIC, P7_BLOCK_INDEX_VERSION, index->numBlocks);
+  for(uint32_t i = 0; i < index->numBlocks; i++){
+    const struct P7HmmBlock *block = &index->blocks[i];
+    fprintf(indexFile, "%" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu32 "\n", block->compressedOffset,
+      block->compressedLength, block->uncompressedLength, block->numLines, block->numModels);
+  }
+  return fclose(indexFile) == 0? p7HmmSuccess: p7HmmFileNotFound;
+}
+
+//checks that every block lies within the container, so blocks can be read without further bounds checks.
+static bool p7BlockIndexFitsContainer(const struct P7HmmBlockIndex *index, const uint64_t containerLength){
+  for(uint32_t i = 0; i < index->numBlocks; i++){
+    const struct P7HmmBlock *block = &index->blocks[i];
+    if(block->compressedOffset > containerLength || block->compressedLength > containerLength - block->compressedOffset ||
+      block->compressedLength > UINT32_MAX || block->uncompressedLength > UINT32_MAX){
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool p7InflateBlock(const char *compressedData, const struct P7HmmBlock *block, char *uncompressedData){
+  z_stream stream;
+  memset(&stream, 0, sizeof(z_stream));
+  if(inflateInit2(&stream, P7_GZIP_WINDOW_BITS) != Z_OK){
+    return false;
+  }
+  stream.next_in = (Bytef*)compressedData;
+  stream.avail_in = block->compressedLength;
+  stream.next_out = (Bytef*)uncompressedData;
+  stream.avail_out = block->uncompressedLength;
+  const int inflateResult = inflate(&stream, Z_FINISH);
+  const bool inflatedBlock = inflateResult == Z_STREAM_END && stream.total_out == block->uncompressedLength;
+  inflateEnd(&stream);
+  return inflatedBlock;
+}
+
+//decompresses the block into the buffer (growing it if needed), and parses it into blockList.
+static enum P7HmmReturnCode p7ParseBlock(const char *const fileSrc, const char *compressedData,
+  const struct P7HmmBlock *block, const uint64_t firstLineNumber, char **buffer, size_t *bufferLength,
+  struct P7HmmList *blockList){
+  p7HmmListInit(blockList);
+  if(block->uncompressedLength > *bufferLength){
+    char *grownBuffer = realloc(*buffer, block->uncompressedLength);
+    if(grownBuffer == NULL){
+      printAllocationError(fileSrc, firstLineNumber, "failed to allocate buffer for decompressed block.");
+      return p7HmmAllocationFailure;
+    }
+    *buffer = grownBuffer;
+    *bufferLength = block->uncompressedLength;
+  }
+  if(!p7InflateBlock(compressedData, block, *buffer)){
+    printFormatError(fileSrc, firstLineNumber, "failed to decompress block, the container or its index may be corrupt.");
+    return p7HmmFormatError;
+  }
+
+  struct P7HmmParser parser;
+  p7HmmParserInit(&parser, fileSrc, blockList);
+  parser.lineNumber = firstLineNumber;
+  enum P7HmmReturnCode returnCode = p7HmmParserConsumeBuffer(&parser, *buffer, block->uncompressedLength);
+  if(returnCode == p7HmmSuccess && parser.parserState != parsingHmmIdle){
+    returnCode = p7HmmParserFinish(&parser);
+  }
+  if(returnCode == p7HmmSuccess && blockList->count != block->numModels){
+    printFormatError(fileSrc, parser.lineNumber, "block does not contain the number of models listed in the block index.");
+    returnCode = p7HmmFormatError;
+  }
+  if(returnCode != p7HmmSuccess){
+    p7HmmListDealloc(blockList);
+  }
+  return returnCode;
+}
+
+static void *p7ParseBlocks(void *argument){
+  struct P7HmmBlockWork *work = argument;
+  //each worker keeps its decompression buffer across blocks
+  char *buffer = NULL;
+  size_t bufferLength = 0;
+  uint_fast32_t blockIndex;
+  while((blockIndex = atomic_fetch_add(&work->nextBlockIndex, 1)) < work->index->numBlocks){
+    const struct P7HmmBlock *block = &work->index->blocks[blockIndex];
+    work->blockReturnCodes[blockIndex] = p7ParseBlock(work->fileSrc, work->containerData + block->compressedOffset,
+      block, work->firstLineNumbers[blockIndex], &buffer, &bufferLength, &work->blockLists[blockIndex]);
+  }
+  free(buffer);
+  return NULL;
+}
+
+
+enum P7HmmReturnCode readP7HmmBlockCompressed(const char *const fileSrc, const uint32_t numThreads, struct P7HmmList *phmmList){
+  p7HmmListInit(phmmList);
+
+  struct P7HmmBlockIndex index;
+  enum P7HmmReturnCode returnCode = p7BlockIndexRead(fileSrc, &index);
+  if(returnCode != p7HmmSuccess){
+    return returnCode;
+  }
+  struct P7HmmFileMap fileMap;
+  returnCode = p7HmmFileMapOpen(fileSrc, &fileMap);
+  if(returnCode != p7HmmSuccess){
+    free(index.blocks);
+    return returnCode;
+  }
+  if(!p7BlockIndexFitsContainer(&index, fileMap.length)){
+    printFormatError(fileSrc, 0, "block index describes blocks outside of the container.");
+    free(index.blocks);
+    p7HmmFileMapClose(&fileMap);
+    return p7HmmFormatError;
+  }
+
+  const uint32_t numBlocks = index.numBlocks;
+  uint64_t *firstLineNumbers = malloc((numBlocks > 0? numBlocks: 1) * sizeof(uint64_t));
+  struct P7HmmList *blockLists = malloc((numBlocks > 0? numBlocks: 1) * sizeof(struct P7HmmList));
+  enum P7HmmReturnCode *blockReturnCodes = malloc((numBlocks > 0? numBlocks: 1) * sizeof(enum P7HmmReturnCode));
+  if(firstLineNumbers == NULL || blockLists == NULL || blockReturnCodes == NULL){
+    printAllocationError(fileSrc, 0, "failed to allocate memory for parallel block parsing.");
+    returnCode = p7HmmAllocationFailure;
+  }
+  else{
+    uint64_t numLines = 0;
+    for(uint32_t i = 0; i < numBlocks; i++){
+      firstLineNumbers[i] = numLines;
+      numLines += index.blocks[i].numLines;
+      p7HmmListInit(&blockLists[i]);
+      blockReturnCodes[i] = p7HmmSuccess;
+    }
+
+    struct P7HmmBlockWork work = {.fileSrc = fileSrc, .containerData = fileMap.data, .index = &index,
+      .firstLineNumbers = firstLineNumbers, .blockLists = blockLists, .blockReturnCodes = blockReturnCodes};
+    atomic_init(&work.nextBlockIndex, 0);
+    uint32_t numWorkers = p7HmmResolveThreadCount(numThreads);
+    if(numWorkers > numBlocks){
+      numWorkers = numBlocks > 0? numBlocks: 1;
+    }
+    if(!p7HmmRunWorkers(p7ParseBlocks, &work, numWorkers)){
+      p7ParseBlocks(&work);
+    }
+
+    for(uint32_t i = 0; i < numBlocks && returnCode == p7HmmSuccess; i++){
+      returnCode = blockReturnCodes[i];
+    }
+    if(returnCode == p7HmmSuccess){
+      returnCode = p7HmmListConcatenate(phmmList, blockLists, numBlocks);
+      if(returnCode != p7HmmSuccess){
+        printAllocationError(fileSrc, 0, "could not allocate memory for the merged P7ProfileHmmList list.");
+      }
+    }
+    if(returnCode == p7HmmSuccess && phmmList->count == 0){
+      printFormatError(fileSrc, numLines,
+        "reached the end of the file without finding a profile hmm (expected a 'HMMER3' format tag).");
+      returnCode = p7HmmFormatError;
+    }
+    if(returnCode != p7HmmSuccess){
+      for(uint32_t i = 0; i < numBlocks; i++){
+        p7HmmListDealloc(&blockLists[i]);
+      }
+      p7HmmListDealloc(phmmList);
+    }
+  }
+
+  free(firstLineNumbers);
+  free(blockLists);
+  free(blockReturnCodes);
+  free(index.blocks);
+  p7HmmFileMapClose(&fileMap);
+  return returnCode;
+}
+
+enum P7HmmReturnCode readP7HmmBlockCompressedModel(const char *const fileSrc, const uint32_t modelIndex,
+  struct P7HmmList *phmmList){
+  p7HmmListInit(phmmList);
+
+  struct P7HmmBlockIndex index;
+  enum P7HmmReturnCode returnCode = p7BlockIndexRead(fileSrc, &index);
+  if(returnCode != p7HmmSuccess){
+    return returnCode;
+  }
+
+  //find the block that holds the requested model
+  uint32_t blockIndex = 0;
+  uint32_t firstModelInBlock = 0;
+  uint64_t firstLineNumber = 0;
+  while(blockIndex < index.numBlocks && modelIndex - firstModelInBlock >= index.blocks[blockIndex].numModels){
+    firstModelInBlock += index.blocks[blockIndex].numModels;
+    firstLineNumber += index.blocks[blockIndex].numLines;
+    blockIndex++;
+  }
+  if(blockIndex == index.numBlocks){
+    free(index.blocks);
+    return p7HmmModelNotFound;
+  }
+  const struct P7HmmBlock *block = &index.blocks[blockIndex];
+
+  //only the requested block is read from the container
+  FILE *containerFile = fopen(fileSrc, "rb");
+  if(containerFile == NULL){
+    free(index.blocks);
+    return p7HmmFileNotFound;
+  }
+  char *compressedData = NULL;
+  if(block->compressedLength > UINT32_MAX || block->uncompressedLength > UINT32_MAX){
+    printFormatError(fileSrc, firstLineNumber, "block index entry is larger than the maximum block size.");
+    returnCode = p7HmmFormatError;
+  }
+  else if((compressedData = malloc(block->compressedLength > 0? block->compressedLength: 1)) == NULL){
+    printAllocationError(fileSrc, firstLineNumber, "failed to allocate buffer for compressed block.");
+    returnCode = p7HmmAllocationFailure;
+  }
+  else if(fseeko(containerFile, block->compressedOffset, SEEK_SET) != 0 ||
+    fread(compressedData, 1, block->compressedLength, containerFile) != block->compressedLength){
+    printFormatError(fileSrc, firstLineNumber, "block index describes a block outside of the container.");
+    returnCode = p7HmmFormatError;
+  }
+  fclose(containerFile);
+
+  if(returnCode == p7HmmSuccess){
+    char *buffer = NULL;
+    size_t bufferLength = 0;
+    struct P7HmmList blockList;
+    returnCode = p7ParseBlock(fileSrc, compressedData, block, firstLineNumber, &buffer, &bufferLength, &blockList);
+    free(buffer);
+    if(returnCode == p7HmmSuccess){
+      struct P7Hmm *phmm = p7HmmListAppendHmm(phmmList);
+      if(phmm == NULL){
+        printAllocationError(fileSrc, firstLineNumber, "could not allocate memory for the P7ProfileHmmList list.");
+        returnCode = p7HmmAllocationFailure;
+      }
+      else{
+        //move the requested model out of the block's list before releasing the rest
+        *phmm = blockList.phmms[modelIndex - firstModelInBlock];
+        p7HmmInit(&blockList.phmms[modelIndex - firstModelInBlock]);
+      }
+      p7HmmListDealloc(&blockList);
+    }
+  }
+
+  free(compressedData);
+  free(index.blocks);
+  return returnCode;
+}
+
+enum P7HmmReturnCode p7HmmBlockCompressFile(const char *const hmmFileSrc, const char *const blockFileSrc,
+  const size_t blockLength){
+  const size_t targetBlockLength = blockLength != 0? blockLength: P7_BLOCK_DEFAULT_LENGTH;
+
+  struct P7HmmFileMap fileMap;
+  enum P7HmmReturnCode returnCode = p7HmmFileMapOpen(hmmFileSrc, &fileMap);
+  if(returnCode != p7HmmSuccess){
+    return returnCode;
+  }
+  if(p7HmmHasGzipMagic(fileMap.data, fileMap.length)){
+    printFormatError(hmmFileSrc, 0, "file to block compress must not already be gzip compressed.");
+    p7HmmFileMapClose(&fileMap);
+    return p7HmmFormatError;
+  }
+  FILE *blockFile = fopen(blockFileSrc, "wb");
+  if(blockFile == NULL){
+    p7HmmFileMapClose(&fileMap);
+    return p7HmmFileNotFound;
+  }
+
+  struct P7HmmBlockIndex index = {.blocks = NULL, .numBlocks = 0};
+  char *compressedData = NULL;
+  size_t compressedDataLength = 0;
+  uint64_t compressedOffset = 0;
+  size_t blockStart = 0;
+  while(returnCode == p7HmmSuccess && blockStart < fileMap.length){
+    //blocks hold whole models, so that every block can be parsed on its own
+    size_t targetEnd = blockStart + targetBlockLength - 1;
+    if(targetEnd > fileMap.length){
+      targetEnd = fileMap.length;
+    }
+    const size_t blockEnd = p7HmmNextRecordBoundary(fileMap.data, fileMap.length, targetEnd);
+    const char *const blockData = fileMap.data + blockStart;
+    const size_t blockDataLength = blockEnd - blockStart;
+    if(blockDataLength > UINT32_MAX){
+      printFormatError(hmmFileSrc, 0, "model is too large to fit in a single block.");
+      returnCode = p7HmmFormatError;
+      break;
+    }
+
+    struct P7HmmBlock *grownBlocks = realloc(index.blocks, (index.numBlocks + 1) * sizeof(struct P7HmmBlock));
+    if(grownBlocks == NULL){
+      printAllocationError(hmmFileSrc, 0, "failed to allocate memory for the block index.");
+      returnCode = p7HmmAllocationFailure;
+      break;
+    }
+    index.blocks = grownBlocks;
+    struct P7HmmBlock *block = &index.blocks[index.numBlocks++];
+    block->compressedOffset = compressedOffset;
+    block->uncompressedLength = blockDataLength;
+    block->numLines = 0;
+    block->numModels = 0;
+    for(const char *lineStart = blockData; lineStart < blockData + blockDataLength;){
+      const char *newline = memchr(lineStart, '\n', blockData + blockDataLength - lineStart);
+      if(p7HmmIsRecordEndLine(lineStart, newline == NULL? blockData + blockDataLength: newline)){
+        block->numModels++;
+      }
+      if(newline == NULL){
+        break;
+      }
+      block->numLines++;
+      lineStart = newline + 1;
+    }
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(z_stream));
+    if(deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, P7_GZIP_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) != Z_OK){
+      printAllocationError(hmmFileSrc, 0, "failed to initialize block compression.");
+      returnCode = p7HmmAllocationFailure;
+      break;
+    }
+    const size_t compressedBound = deflateBound(&stream, blockDataLength);
+    if(compressedBound > compressedDataLength){
+      char *grownCompressedData = realloc(compressedData, compressedBound);
+      if(grownCompressedData == NULL){
+        deflateEnd(&stream);
+        printAllocationError(hmmFileSrc, 0, "failed to allocate buffer for compressed block.");
+        returnCode = p7HmmAllocationFailure;
+        break;
+      }
+      compressedData = grownCompressedData;
+      compressedDataLength = compressedBound;
+    }
+    stream.next_in = (Bytef*)blockData;
+    stream.avail_in = blockDataLength;
+    stream.next_out = (Bytef*)compressedData;
+    stream.avail_out = compressedBound;
+    const int deflateResult = deflate(&stream, Z_FINISH);
+    block->compressedLength = stream.total_out;
+    deflateEnd(&stream);
+    if(deflateResult != Z_STREAM_END){
+      printAllocationError(hmmFileSrc, 0, "failed to compress block.");
+      returnCode = p7HmmAllocationFailure;
+      break;
+    }
+    if(fwrite(compressedData, 1, block->compressedLength, blockFile) != block->compressedLength){
+      returnCode = p7HmmFileNotFound;
+      break;
+    }
+    compressedOffset += block->compressedLength;
+    blockStart = blockEnd;
+  }
+
+  if(fclose(blockFile) != 0 && returnCode == p7HmmSuccess){
+    returnCode = p7HmmFileNotFound;
+  }
+  if(returnCode == p7HmmSuccess){
+    returnCode = p7BlockIndexWrite(blockFileSrc, &index);
+  }
+  free(compressedData);
+  free(index.blocks);
+  p7HmmFileMapClose(&fileMap);
+  return returnCode;
+}
@@ -0,0 +1,46 @@
+#define  _POSIX_C_SOURCE 200809L     //required for posix_madvise
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "p7HmmFileMap.h"
+
+
+enum P7HmmReturnCode p7HmmFileMapOpen(const char *const fileSrc, struct P7HmmFileMap *fileMap){
+  fileMap->data = NULL;
+  fileMap->length = 0;
+
+  int fileDescriptor = open(fileSrc, O_RDONLY);
+  if(fileDescriptor == -1){
+    return p7HmmFileNotFound;
+  }
+  struct stat fileStats;
+  if(fstat(fileDescriptor, &fileStats) == -1){
+    close(fileDescriptor);
+    return p7HmmFileNotFound;
+  }
+
+  const size_t fileLength = fileStats.st_size;
+  if(fileLength != 0){
+    void *fileData = mmap(NULL, fileLength, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    if(fileData == MAP_FAILED){
+      close(fileDescriptor);
+      return p7HmmFileNotFound;
+    }
+    //the file is read front to back once, so let the kernel read ahead aggressively
+    posix_madvise(fileData, fileLength, POSIX_MADV_SEQUENTIAL);
+    fileMap->data = fileData;
+    fileMap->length = fileLength;
+  }
+  //the mapping stays valid after the descriptor is closed
+  close(fileDescriptor);
+  return p7HmmSuccess;
+}
+
+void p7HmmFileMapClose(struct P7HmmFileMap *fileMap){
+  if(fileMap->data != NULL){
+    munmap((void*)fileMap->data, fileMap->length);
+  }
+  fileMap->data = NULL;
+  fileMap->length = 0;
+}
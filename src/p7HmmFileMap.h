@@ -0,0 +1,40 @@
+#ifndef P7_HMM_READER_FILE_MAP_H
+#define P7_HMM_READER_FILE_MAP_H
+
+#include <stddef.h>
+#include "p7HmmReader.h"
+
+
+struct P7HmmFileMap{
+  const char *data;   //NULL if the file is empty
+  size_t length;
+};
+
+
+/*
+ * Function:  p7HmmFileMapOpen
+ * --------------------
+ * Memory maps the given file read-only, and advises the kernel that it will be
+ *  read sequentially.
+ *
+ *  Inputs:
+ *    fileSrc: Location of the file to map.
+ *    fileMap: pointer to the struct to fill with the mapping.
+ *
+ *  Returns:
+ *    p7HmmSuccess if the file was mapped (or is empty),
+ *    p7HmmFileNotFound if the file could not be opened or mapped.
+ */
+enum P7HmmReturnCode p7HmmFileMapOpen(const char *const fileSrc, struct P7HmmFileMap *fileMap);
+
+/*
+ * Function:  p7HmmFileMapClose
+ * --------------------
+ * Unmaps a file mapped with p7HmmFileMapOpen.
+ *
+ *  Inputs:
+ *    fileMap: pointer to the mapping to release.
+ */
+void p7HmmFileMapClose(struct P7HmmFileMap *fileMap);
+
+#endif
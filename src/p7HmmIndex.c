@@ -0,0 +1,395 @@
+#define  _POSIX_C_SOURCE 200809L     //required for fscanf's %ms and posix_madvise
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "p7HmmReader.h"
+#include "p7HmmParser.h"
+#include "p7HmmParallel.h"
+#include "p7HmmFileMap.h"
+#include "p7HmmLineSource.h"
+#include "p7ScoreDecoder.h"
+#include "p7ProfileHmm.h"
+#include "p7HmmReaderLog.h"
+
+
+#define P7_INDEX_EXTENSION    ".p7i"
+#define P7_INDEX_MAGIC        "P7HMM_INDEX"
+#define P7_INDEX_VERSION      2
+//written in place of a missing NAME or ACC, never matched by a fetch
+#define P7_INDEX_MISSING_KEY  "-"
+
+
+struct P7HmmIndexEntry{
+  uint64_t offset;
+  uint64_t length;
+  uint64_t lineNumber;    //number of lines in the file before the model, for labeling errors
+  char *name;
+  char *accession;
+};
+
+//identifies the version of the hmm file an index was built from
+struct P7HmmIndexedFile{
+  uint64_t length;
+  int64_t modificationSeconds;
+  int64_t modificationNanoseconds;
+};
+
+struct P7HmmIndexKey{
+  const char *key;
+  uint32_t entryIndex;
+};
+
+struct P7HmmIndex{
+  char *fileSrc;
+  struct P7HmmFileMap fileMap;
+  struct P7HmmIndexEntry *entries;
+  uint32_t numEntries;
+  //every name and accession, sorted so keys can be found with a binary search
+  struct P7HmmIndexKey *keys;
+  uint32_t numKeys;
+};
+
+
+static bool p7IndexedFileStat(const char *const fileSrc, struct P7HmmIndexedFile *indexedFile){
+  struct stat fileStat;
+  if(stat(fileSrc, &fileStat) != 0){
+    return false;
+  }
+  indexedFile->length = fileStat.st_size;
+  indexedFile->modificationSeconds = fileStat.st_mtim.tv_sec;
+  indexedFile->modificationNanoseconds = fileStat.st_mtim.tv_nsec;
+  return true;
+}
+
+//returns a newly allocated string holding the location of the hmm file's index.
+static char *p7IndexSrc(const char *const fileSrc){
+  const size_t fileSrcLength = strlen(fileSrc);
+  char *indexSrc = malloc(fileSrcLength + sizeof(P7_INDEX_EXTENSION));
+  if(indexSrc != NULL){
+    memcpy(indexSrc, fileSrc, fileSrcLength);
+    memcpy(indexSrc + fileSrcLength, P7_INDEX_EXTENSION, sizeof(P7_INDEX_EXTENSION));
+  }
+  return indexSrc;
+}
+
+static bool p7LineStartsWithTag(const char *line, const char *lineEnd, const char *const tag){
+  const size_t tagLength = strlen(tag);
+  return (size_t)(lineEnd - line) >= tagLength && memcmp(line, tag, tagLength) == 0 &&
+    ((size_t)(lineEnd - line) == tagLength || p7IsBlank(line[tagLength]));
+}
+
+//finds the first token after the line's tag, or the missing key if the line has no token.
+static void p7TagValue(const char *line, const char *lineEnd, const size_t tagLength, const char **value,
+  int *valueLength){
+  const char *token = line + tagLength;
+  while(token < lineEnd && p7IsBlank(*token)){
+    token++;
+  }
+  const char *tokenEnd = token;
+  while(tokenEnd < lineEnd && !p7IsBlank(*tokenEnd)){
+    tokenEnd++;
+  }
+  if(token == tokenEnd){
+    *value = P7_INDEX_MISSING_KEY;
+    *valueLength = strlen(P7_INDEX_MISSING_KEY);
+  }
+  else{
+    *value = token;
+    *valueLength = tokenEnd - token;
+  }
+}
+
+/*
+ * scans the file for the start of each model and its NAME and ACC lines, and writes one index line per model.
+ *  Each model's node lines are skipped over with p7HmmNextRecordBoundary rather than being read line by line.
+ */
+static enum P7HmmReturnCode p7IndexWriteEntries(const char *const fileSrc, const struct P7HmmFileMap *fileMap,
+  FILE *indexFile, uint32_t *numEntries){
+  const char *data = fileMap->data;
+  const char *const dataEnd = data + fileMap->length;
+  *numEntries = 0;
+  const char *line = data;
+  size_t lineNumber = 0;
+  while(line < dataEnd){
+    const char *newline = memchr(line, '\n', dataEnd - line);
+    const char *lineEnd = newline == NULL? dataEnd: newline;
+    if(lineEnd - line < 6 || memcmp(line, "HMMER3", 6) != 0){
+      //blank lines between models are allowed, anything else means the file isn't a set of hmm models
+      for(const char *c = line; c < lineEnd; c++){
+        if(!p7IsBlank(*c)){
+          printFormatError(fileSrc, lineNumber + 1, "expected a 'HMMER3' format tag at the start of the model.");
+          return p7HmmFormatError;
+        }
+      }
+      line = lineEnd + 1;
+      lineNumber++;
+      continue;
+    }
+
+    const char *const modelStart = line;
+    const char *name = P7_INDEX_MISSING_KEY;
+    const char *accession = P7_INDEX_MISSING_KEY;
+    int nameLength = strlen(P7_INDEX_MISSING_KEY);
+    int accessionLength = strlen(P7_INDEX_MISSING_KEY);
+    //read header lines until the start of the model body
+    while(line < dataEnd){
+      newline = memchr(line, '\n', dataEnd - line);
+      lineEnd = newline == NULL? dataEnd: newline;
+      if(p7LineStartsWithTag(line, lineEnd, "NAME")){
+        p7TagValue(line, lineEnd, 4, &name, &nameLength);
+      }
+      else if(p7LineStartsWithTag(line, lineEnd, "ACC")){
+        p7TagValue(line, lineEnd, 3, &accession, &accessionLength);
+      }
+      else if(p7LineStartsWithTag(line, lineEnd, "HMM") || p7HmmIsRecordEndLine(line, lineEnd)){
+        break;
+      }
+      line = lineEnd + 1;
+    }
+    if(line > dataEnd){
+      line = dataEnd;
+    }
+
+    const size_t modelEnd = p7HmmNextRecordBoundary(data, fileMap->length, line - data);
+    const size_t modelLength = data + modelEnd - modelStart;
+    fprintf(indexFile, "%zu %zu %zu %.*s %.*s\n", (size_t)(modelStart - data), modelLength, lineNumber,
+      nameLength, name, accessionLength, accession);
+    lineNumber += p7HmmCountLines(modelStart, modelLength);
+    line = data + modelEnd;
+    (*numEntries)++;
+  }
+  return p7HmmSuccess;
+}
+
+static int p7IndexKeyCompare(const void *a, const void *b){
+  const struct P7HmmIndexKey *keyA = a;
+  const struct P7HmmIndexKey *keyB = b;
+  const int keyComparison = strcmp(keyA->key, keyB->key);
+  if(keyComparison != 0){
+    return keyComparison;
+  }
+  //keep models that share a name in file order, so fetches return the first one
+  return (keyA->entryIndex > keyB->entryIndex) - (keyA->entryIndex < keyB->entryIndex);
+}
+
+static int p7IndexKeySearch(const void *key, const void *element){
+  return strcmp(key, ((const struct P7HmmIndexKey*)element)->key);
+}
+
+static enum P7HmmReturnCode p7IndexReadEntries(const char *const indexSrc, struct P7HmmIndex *index,
+  struct P7HmmIndexedFile *indexedFile){
+  FILE *indexFile = fopen(indexSrc, "r");
+  if(indexFile == NULL){
+    return p7HmmFileNotFound;
+  }
+  enum P7HmmReturnCode returnCode = p7HmmSuccess;
+  char magic[sizeof(P7_INDEX_MAGIC)];
+  unsigned int version;
+  uint32_t numEntries;
+  if(fscanf(indexFile, "%11s %u %" SCNu32 " %" SCNu64 " %" SCNd64 " %" SCNd64, magic, &version, &numEntries,
+      &indexedFile->length, &indexedFile->modificationSeconds, &indexedFile->modificationNanoseconds) != 6 ||
+    strcmp(magic, P7_INDEX_MAGIC) != 0 || version != P7_INDEX_VERSION){
+    printFormatError(indexSrc, 1, "index does not start with a supported hmm index header.");
+    returnCode = p7HmmFormatError;
+  }
+  else{
+    index->entries = calloc(numEntries > 0? numEntries: 1, sizeof(struct P7HmmIndexEntry));
+    index->keys = malloc((numEntries > 0? (size_t)numEntries: 1) * 2 * sizeof(struct P7HmmIndexKey));
+    if(index->entries == NULL || index->keys == NULL){
+      printAllocationError(indexSrc, 1, "failed to allocate memory for the hmm index.");
+      returnCode = p7HmmAllocationFailure;
+    }
+  }
+  for(uint32_t i = 0; returnCode == p7HmmSuccess && i < numEntries; i++){
+    struct P7HmmIndexEntry *entry = &index->entries[i];
+    index->numEntries = i + 1;
+    if(fscanf(indexFile, "%" SCNu64 " %" SCNu64 " %" SCNu64 " %ms %ms", &entry->offset, &entry->length,
+      &entry->lineNumber, &entry->name, &entry->accession) != 5){
+      printFormatError(indexSrc, i + 2, "could not read hmm index entry.");
+      returnCode = p7HmmFormatError;
+      break;
+    }
+    if(strcmp(entry->name, P7_INDEX_MISSING_KEY) != 0){
+      index->keys[index->numKeys++] = (struct P7HmmIndexKey){.key = entry->name, .entryIndex = i};
+    }
+    if(strcmp(entry->accession, P7_INDEX_MISSING_KEY) != 0){
+      index->keys[index->numKeys++] = (struct P7HmmIndexKey){.key = entry->accession, .entryIndex = i};
+    }
+  }
+  fclose(indexFile);
+  return returnCode;
+}
+
+
+enum P7HmmReturnCode p7HmmIndexBuild(const char *const fileSrc){
+  struct P7HmmFileMap fileMap;
+  enum P7HmmReturnCode returnCode = p7HmmFileMapOpen(fileSrc, &fileMap);
+  if(returnCode != p7HmmSuccess){
+    return returnCode;
+  }
+  //offsets into a gzip stream can't be seeked to, so only plain files can be indexed
+  if(p7HmmHasGzipMagic(fileMap.data, fileMap.length)){
+    printFormatError(fileSrc, 0, "compressed hmm files can't be indexed, decompress the file first.");
+    p7HmmFileMapClose(&fileMap);
+    return p7HmmFormatError;
+  }
+  char *indexSrc = p7IndexSrc(fileSrc);
+  if(indexSrc == NULL){
+    printAllocationError(fileSrc, 0, "failed to allocate memory for the index file name.");
+    p7HmmFileMapClose(&fileMap);
+    return p7HmmAllocationFailure;
+  }
+  struct P7HmmIndexedFile indexedFile;
+  if(!p7IndexedFileStat(fileSrc, &indexedFile)){
+    free(indexSrc);
+    p7HmmFileMapClose(&fileMap);
+    return p7HmmFileNotFound;
+  }
+  //entries are written to a temporary file first, since the header needs the number of models
+  FILE *entriesFile = tmpfile();
+  FILE *indexFile = fopen(indexSrc, "w");
+  if(entriesFile == NULL || indexFile == NULL){
+    returnCode = p7HmmFileNotFound;
+  }
+  uint32_t numEntries = 0;
+  if(returnCode == p7HmmSuccess){
+    returnCode = p7IndexWriteEntries(fileSrc, &fileMap, entriesFile, &numEntries);
+  }
+  if(returnCode == p7HmmSuccess){
+    fprintf(indexFile, "%s %u %" PRIu32 " %" PRIu64 " %" PRId64 " %" PRId64 "\n", P7_INDEX_MAGIC, P7_INDEX_VERSION,
+      numEntries, indexedFile.length, indexedFile.modificationSeconds, indexedFile.modificationNanoseconds);
+    rewind(entriesFile);
+    char copyBuffer[1 << 14];
+    size_t copyLength;
+    while((copyLength = fread(copyBuffer, 1, sizeof(copyBuffer), entriesFile)) != 0){
+      if(fwrite(copyBuffer, 1, copyLength, indexFile) != copyLength){
+        returnCode = p7HmmFileNotFound;
+        break;
+      }
+    }
+  }
+  if(entriesFile != NULL){
+    fclose(entriesFile);
+  }
+  if(indexFile != NULL && fclose(indexFile) != 0 && returnCode == p7HmmSuccess){
+    returnCode = p7HmmFileNotFound;
+  }
+  if(returnCode != p7HmmSuccess){
+    remove(indexSrc);
+  }
+  free(indexSrc);
+  p7HmmFileMapClose(&fileMap);
+  return returnCode;
+}
+
+enum P7HmmReturnCode p7HmmIndexOpen(const char *const fileSrc, struct P7HmmIndex **index){
+  *index = NULL;
+  struct P7HmmIndex *newIndex = calloc(1, sizeof(struct P7HmmIndex));
+  char *indexSrc = p7IndexSrc(fileSrc);
+  if(newIndex != NULL){
+    newIndex->fileSrc = malloc(strlen(fileSrc) + 1);
+  }
+  if(newIndex == NULL || indexSrc == NULL || newIndex->fileSrc == NULL){
+    printAllocationError(fileSrc, 0, "failed to allocate memory for the hmm index.");
+    free(indexSrc);
+    p7HmmIndexClose(newIndex);
+    return p7HmmAllocationFailure;
+  }
+  strcpy(newIndex->fileSrc, fileSrc);
+
+  struct P7HmmIndexedFile indexedFile;
+  struct P7HmmIndexedFile currentFile;
+  enum P7HmmReturnCode returnCode = p7IndexReadEntries(indexSrc, newIndex, &indexedFile);
+  if(returnCode == p7HmmSuccess){
+    returnCode = p7HmmFileMapOpen(fileSrc, &newIndex->fileMap);
+  }
+  if(returnCode == p7HmmSuccess && !p7IndexedFileStat(fileSrc, &currentFile)){
+    returnCode = p7HmmFileNotFound;
+  }
+  if(returnCode == p7HmmSuccess){
+    //the index stores the length and modification time of the file it was built from, to catch files that changed since
+    if(newIndex->fileMap.length != indexedFile.length || currentFile.length != indexedFile.length ||
+      currentFile.modificationSeconds != indexedFile.modificationSeconds ||
+      currentFile.modificationNanoseconds != indexedFile.modificationNanoseconds){
+      printFormatError(indexSrc, 1, "the hmm file has changed since the index was built, rebuild it with p7HmmIndexBuild.");
+      returnCode = p7HmmFormatError;
+    }
+    for(uint32_t i = 0; returnCode == p7HmmSuccess && i < newIndex->numEntries; i++){
+      const struct P7HmmIndexEntry *entry = &newIndex->entries[i];
+      if(entry->offset > indexedFile.length || entry->length > indexedFile.length - entry->offset){
+        printFormatError(indexSrc, i + 2, "index entry describes a model outside of the hmm file.");
+        returnCode = p7HmmFormatError;
+      }
+    }
+  }
+  free(indexSrc);
+  if(returnCode != p7HmmSuccess){
+    p7HmmIndexClose(newIndex);
+    return returnCode;
+  }
+  //fetches jump around the file, so reading ahead of each model would only waste work
+  if(newIndex->fileMap.data != NULL){
+    posix_madvise((void*)newIndex->fileMap.data, newIndex->fileMap.length, POSIX_MADV_RANDOM);
+  }
+  qsort(newIndex->keys, newIndex->numKeys, sizeof(struct P7HmmIndexKey), p7IndexKeyCompare);
+  *index = newIndex;
+  return p7HmmSuccess;
+}
+
+enum P7HmmReturnCode p7HmmIndexFetch(const struct P7HmmIndex *index, const char *const key, struct P7HmmList *phmmList){
+  p7HmmListInit(phmmList);
+  const struct P7HmmIndexKey *foundKey = bsearch(key, index->keys, index->numKeys,
+    sizeof(struct P7HmmIndexKey), p7IndexKeySearch);
+  if(foundKey == NULL){
+    return p7HmmModelNotFound;
+  }
+  //step back to the first model in the file with this key
+  while(foundKey > index->keys && strcmp(foundKey[-1].key, key) == 0){
+    foundKey--;
+  }
+  const struct P7HmmIndexEntry *entry = &index->entries[foundKey->entryIndex];
+
+  struct P7HmmParser parser;
+  p7HmmParserInit(&parser, index->fileSrc, phmmList);
+  parser.lineNumber = entry->lineNumber;
+  enum P7HmmReturnCode returnCode = p7HmmParserConsumeBuffer(&parser, index->fileMap.data + entry->offset, entry->length);
+  if(returnCode == p7HmmSuccess){
+    returnCode = p7HmmParserFinish(&parser);
+  }
+  if(returnCode == p7HmmSuccess && phmmList->count != 1){
+    printFormatError(index->fileSrc, entry->lineNumber + 1, "index entry does not hold exactly one model, rebuild the index.");
+    returnCode = p7HmmFormatError;
+  }
+  //an edit that kept the file's length and time would leave the offsets pointing at a different model
+  if(returnCode == p7HmmSuccess){
+    const struct P7Header *header = &phmmList->phmms[0].header;
+    if((header->name == NULL || strcmp(header->name, key) != 0) &&
+      (header->accessionNumber == NULL || strcmp(header->accessionNumber, key) != 0)){
+      printFormatError(index->fileSrc, entry->lineNumber + 1,
+        "indexed model does not have the requested name or accession, the hmm file has changed since it was indexed.");
+      returnCode = p7HmmFormatError;
+    }
+  }
+  if(returnCode != p7HmmSuccess){
+    p7HmmListDealloc(phmmList);
+  }
+  return returnCode;
+}
+
+void p7HmmIndexClose(struct P7HmmIndex *index){
+  if(index == NULL){
+    return;
+  }
+  for(uint32_t i = 0; i < index->numEntries; i++){
+    free(index->entries[i].name);
+    free(index->entries[i].accession);
+  }
+  p7HmmFileMapClose(&index->fileMap);
+  free(index->entries);
+  free(index->keys);
+  free(index->fileSrc);
+  free(index);
+}
@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "p7HmmReader.h"
+#include "p7HmmParser.h"
+#include "p7HmmParallel.h"
+#include "p7HmmFileMap.h"
+#include "p7HmmLineSource.h"
+#include "p7ScoreDecoder.h"
+#include "p7ProfileHmm.h"
+#include "p7HmmReaderLog.h"
+
+
+//where a model's body (from its 'HMM' line through its '//' line) is in the mapped file
+struct P7HmmLazyBody{
+  size_t offset;
+  size_t length;
+  size_t lineNumber;    //number of lines in the file before the 'HMM' line, for labeling errors
+  bool loaded;
+};
+
+struct P7HmmLazyList{
+  char *fileSrc;
+  struct P7HmmFileMap fileMap;
+  struct P7HmmList phmmList;
+  struct P7HmmLazyBody *bodies;
+  uint32_t bodiesCapacity;
+};
+
+
+//checks if the line's first token is the 'HMM' tag that starts the model body.
+static bool p7IsModelStartLine(const char *line, const char *lineEnd){
+  while(line < lineEnd && p7IsBlank(*line)){
+    line++;
+  }
+  return lineEnd - line >= 3 && memcmp(line, "HMM", 3) == 0 && (lineEnd - line == 3 || p7IsBlank(line[3]));
+}
+
+//checks that the last non-blank line of the body is the '//' terminator.
+static bool p7BodyIsTerminated(const char *body, size_t bodyLength){
+  while(bodyLength > 0 && (p7IsBlank(body[bodyLength - 1]) || body[bodyLength - 1] == '\n')){
+    bodyLength--;
+  }
+  size_t lastLineStart = bodyLength;
+  while(lastLineStart > 0 && body[lastLineStart - 1] != '\n'){
+    lastLineStart--;
+  }
+  return p7HmmIsRecordEndLine(body + lastLineStart, body + bodyLength);
+}
+
+//frees a body list that failed to parse. Its first model shares its header strings with the lazy list,
+//so only that model's data is freed, while any models the parser appended after it are freed entirely.
+static void p7LazyDiscardBodyList(struct P7HmmList *bodyList){
+  p7HmmDeallocModelData(&bodyList->phmms[0]);
+  for(uint32_t i = 1; i < bodyList->count; i++){
+    p7HmmDealloc(&bodyList->phmms[i]);
+  }
+  free(bodyList->phmms);
+}
+
+static enum P7HmmReturnCode p7LazyAddBody(struct P7HmmLazyList *lazyList, const struct P7HmmLazyBody *body){
+  const uint32_t bodyIndex = lazyList->phmmList.count - 1;
+  if(bodyIndex >= lazyList->bodiesCapacity){
+    const uint32_t grownCapacity = lazyList->bodiesCapacity == 0? 64: lazyList->bodiesCapacity * 2;
+    struct P7HmmLazyBody *grownBodies = realloc(lazyList->bodies, grownCapacity * sizeof(struct P7HmmLazyBody));
+    if(grownBodies == NULL){
+      return p7HmmAllocationFailure;
+    }
+    lazyList->bodies = grownBodies;
+    lazyList->bodiesCapacity = grownCapacity;
+  }
+  lazyList->bodies[bodyIndex] = *body;
+  return p7HmmSuccess;
+}
+
+/*
+ * parses every model's header lines into the list, and records where each body starts. When a model's 'HMM'
+ *  line is reached, the rest of the model is skipped with a scan for its '//' terminator, without tokenizing anything.
+ */
+static enum P7HmmReturnCode p7LazyScanHeaders(struct P7HmmLazyList *lazyList){
+  const char *const data = lazyList->fileMap.data;
+  const size_t dataLength = lazyList->fileMap.length;
+  struct P7HmmParser parser;
+  p7HmmParserInit(&parser, lazyList->fileSrc, &lazyList->phmmList);
+
+  size_t position = 0;
+  while(position < dataLength){
+    const char *line = data + position;
+    const char *newline = memchr(line, '\n', dataLength - position);
+    const char *lineEnd = newline == NULL? data + dataLength: newline;
+    if(parser.parserState == parsingHmmHeader && p7IsModelStartLine(line, lineEnd)){
+      const size_t bodyEnd = p7HmmNextRecordBoundary(data, dataLength, position);
+      const struct P7HmmLazyBody body = {.offset = position, .length = bodyEnd - position,
+        .lineNumber = parser.lineNumber, .loaded = false};
+      if(p7LazyAddBody(lazyList, &body) != p7HmmSuccess){
+        printAllocationError(lazyList->fileSrc, parser.lineNumber, "failed to allocate memory for the model body locations.");
+        return p7HmmAllocationFailure;
+      }
+      parser.lineNumber += p7HmmCountLines(line, bodyEnd - position) + (data[bodyEnd - 1] != '\n');
+      //the body is checked for a '//' terminator here, since it won't be parsed until it's needed
+      if(!p7BodyIsTerminated(line, bodyEnd - position)){
+        return p7HmmParserFinish(&parser);
+      }
+      parser.parserState = parsingHmmIdle;
+      parser.completedParsingHmm = true;
+      position = bodyEnd;
+      continue;
+    }
+    enum P7HmmReturnCode returnCode = p7HmmParserConsumeLine(&parser, line, lineEnd - line);
+    if(returnCode != p7HmmSuccess){
+      return returnCode;
+    }
+    position = lineEnd - data + 1;
+  }
+  return p7HmmParserFinish(&parser);
+}
+
+
+enum P7HmmReturnCode p7HmmLazyOpen(const char *const fileSrc, struct P7HmmLazyList **lazyList){
+  *lazyList = NULL;
+  struct P7HmmLazyList *newLazyList = calloc(1, sizeof(struct P7HmmLazyList));
+  if(newLazyList != NULL){
+    newLazyList->fileSrc = malloc(strlen(fileSrc) + 1);
+  }
+  if(newLazyList == NULL || newLazyList->fileSrc == NULL){
+    printAllocationError(fileSrc, 0, "failed to allocate memory for the lazy model list.");
+    free(newLazyList);
+    return p7HmmAllocationFailure;
+  }
+  strcpy(newLazyList->fileSrc, fileSrc);
+  p7HmmListInit(&newLazyList->phmmList);
+
+  enum P7HmmReturnCode returnCode = p7HmmFileMapOpen(fileSrc, &newLazyList->fileMap);
+  //bodies are parsed straight out of the mapping later on, so a compressed file can't be loaded lazily
+  if(returnCode == p7HmmSuccess && p7HmmHasGzipMagic(newLazyList->fileMap.data, newLazyList->fileMap.length)){
+    printFormatError(fileSrc, 0, "compressed hmm files can't be loaded lazily, decompress the file first.");
+    returnCode = p7HmmFormatError;
+  }
+  if(returnCode == p7HmmSuccess){
+    returnCode = p7LazyScanHeaders(newLazyList);
+  }
+  if(returnCode != p7HmmSuccess){
+    p7HmmLazyClose(newLazyList);
+    return returnCode;
+  }
+  *lazyList = newLazyList;
+  return p7HmmSuccess;
+}
+
+const struct P7HmmList *p7HmmLazyHeaders(const struct P7HmmLazyList *lazyList){
+  return &lazyList->phmmList;
+}
+
+enum P7HmmReturnCode p7HmmLazyGetModel(struct P7HmmLazyList *lazyList, const uint32_t modelIndex, struct P7Hmm **phmm){
+  *phmm = NULL;
+  if(modelIndex >= lazyList->phmmList.count){
+    return p7HmmModelNotFound;
+  }
+  struct P7Hmm *lazyPhmm = &lazyList->phmmList.phmms[modelIndex];
+  struct P7HmmLazyBody *body = &lazyList->bodies[modelIndex];
+  if(!body->loaded){
+    //the body is parsed into a list of its own, so a malformed body can never add models to the lazy list
+    struct P7HmmList bodyList;
+    p7HmmListInit(&bodyList);
+    struct P7Hmm *bodyPhmm = p7HmmListAppendHmm(&bodyList);
+    if(bodyPhmm == NULL){
+      printAllocationError(lazyList->fileSrc, body->lineNumber + 1, "failed to allocate memory for the model body.");
+      return p7HmmAllocationFailure;
+    }
+    *bodyPhmm = *lazyPhmm;
+    struct P7HmmParser parser;
+    p7HmmParserResumeModel(&parser, lazyList->fileSrc, &bodyList, bodyPhmm, body->lineNumber);
+    enum P7HmmReturnCode returnCode = p7HmmParserConsumeBuffer(&parser, lazyList->fileMap.data + body->offset, body->length);
+    if(returnCode == p7HmmSuccess){
+      returnCode = p7HmmParserFinish(&parser);
+    }
+    if(returnCode == p7HmmSuccess && bodyList.count != 1){
+      printFormatError(lazyList->fileSrc, body->lineNumber + 1, "lazy model body does not hold exactly one model.");
+      returnCode = p7HmmFormatError;
+    }
+    if(returnCode != p7HmmSuccess){
+      //leave the header in place, so the list stays usable even if this body is malformed
+      p7LazyDiscardBodyList(&bodyList);
+      return returnCode;
+    }
+    *lazyPhmm = bodyList.phmms[0];
+    free(bodyList.phmms);
+    body->loaded = true;
+  }
+  *phmm = lazyPhmm;
+  return p7HmmSuccess;
+}
+
+void p7HmmLazyClose(struct P7HmmLazyList *lazyList){
+  if(lazyList == NULL){
+    return;
+  }
+  p7HmmListDealloc(&lazyList->phmmList);
+  p7HmmFileMapClose(&lazyList->fileMap);
+  free(lazyList->bodies);
+  free(lazyList->fileSrc);
+  free(lazyList);
+}
@@ -0,0 +1,160 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "p7HmmLineSource.h"
+#include "p7HmmReaderLog.h"
+
+
+//files are read (or decompressed) in large blocks, and split into lines in place
+#define P7_LINE_BUFFER_LENGTH (1 << 18)
+
+
+enum P7HmmReturnCode p7HmmLineSourceOpen(struct P7HmmLineSource *source, const char *const fileSrc){
+  enum P7HmmReturnCode returnCode = p7HmmLineSourceOpenWithBuffer(source, fileSrc, NULL, 0);
+  if(returnCode != p7HmmSuccess){
+    p7HmmLineSourceClose(source);
+  }
+  return returnCode;
+}
+
+enum P7HmmReturnCode p7HmmLineSourceOpenWithBuffer(struct P7HmmLineSource *source, const char *const fileSrc,
+  char *buffer, const size_t bufferLength){
+  memset(source, 0, sizeof(struct P7HmmLineSource));
+  source->buffer = buffer;
+  source->bufferLength = buffer == NULL? 0: bufferLength;
+
+  FILE *openedFile = fopen(fileSrc, "r");
+  if(openedFile == NULL){
+    return p7HmmFileNotFound;
+  }
+  char magic[2];
+  const size_t magicLength = fread(magic, 1, 2, openedFile);
+  const bool isCompressed = p7HmmHasGzipMagic(magic, magicLength);
+  if(isCompressed){
+    fclose(openedFile);
+    source->compressedFile = gzopen(fileSrc, "rb");
+    if(source->compressedFile == NULL){
+      return p7HmmFileNotFound;
+    }
+    gzbuffer(source->compressedFile, P7_LINE_BUFFER_LENGTH);
+  }
+  else{
+    rewind(openedFile);
+    source->plainFile = openedFile;
+  }
+
+  //a reused buffer is only replaced if it's too small
+  if(source->bufferLength < P7_LINE_BUFFER_LENGTH){
+    char *grownBuffer = realloc(source->buffer, P7_LINE_BUFFER_LENGTH * sizeof(char));
+    if(grownBuffer == NULL){
+      return p7HmmAllocationFailure;
+    }
+    source->buffer = grownBuffer;
+    source->bufferLength = P7_LINE_BUFFER_LENGTH;
+  }
+  return p7HmmSuccess;
+}
+
+//reads the next block of the file into the buffer after dataEnd, setting reachedEnd once the file is exhausted.
+static bool p7HmmLineSourceFill(struct P7HmmLineSource *source){
+  size_t readLength = source->bufferLength - source->dataEnd;
+  if(source->plainFile != NULL){
+    const size_t numBytesRead = fread(source->buffer + source->dataEnd, 1, readLength, source->plainFile);
+    if(ferror(source->plainFile)){
+      source->errorCode = p7HmmFileNotFound;
+      source->errorMessage = "failed to read from the file.";
+      return false;
+    }
+    source->reachedEnd = numBytesRead == 0;
+    source->dataEnd += numBytesRead;
+    return true;
+  }
+  if(readLength > INT_MAX){
+    readLength = INT_MAX;
+  }
+  const int numBytesRead = gzread(source->compressedFile, source->buffer + source->dataEnd, readLength);
+  if(numBytesRead < 0){
+    source->errorCode = p7HmmFormatError;
+    source->errorMessage = "failed to decompress gzip data, the file may be truncated or corrupt.";
+    return false;
+  }
+  source->reachedEnd = numBytesRead == 0;
+  source->dataEnd += numBytesRead;
+  return true;
+}
+
+bool p7HmmLineSourceNext(struct P7HmmLineSource *source, const char **line, size_t *lineLength){
+  size_t searchStart = source->lineStart;
+  while(true){
+    const char *newline = memchr(source->buffer + searchStart, '\n', source->dataEnd - searchStart);
+    if(newline != NULL){
+      *line = source->buffer + source->lineStart;
+      *lineLength = newline - *line;
+      source->lineStart = newline - source->buffer + 1;
+      return true;
+    }
+    if(source->reachedEnd){
+      //the last line of the file may not end in a newline
+      if(source->lineStart == source->dataEnd){
+        return false;
+      }
+      *line = source->buffer + source->lineStart;
+      *lineLength = source->dataEnd - source->lineStart;
+      source->lineStart = source->dataEnd;
+      return true;
+    }
+
+    //move the partial line to the front of the buffer, and read more of the file after it
+    const size_t partialLength = source->dataEnd - source->lineStart;
+    memmove(source->buffer, source->buffer + source->lineStart, partialLength);
+    source->lineStart = 0;
+    source->dataEnd = partialLength;
+    searchStart = partialLength;
+    if(source->dataEnd == source->bufferLength){
+      char *grownBuffer = realloc(source->buffer, source->bufferLength * 2);
+      if(grownBuffer == NULL){
+        source->errorCode = p7HmmAllocationFailure;
+        source->errorMessage = "failed to grow buffer for a long line.";
+        return false;
+      }
+      source->buffer = grownBuffer;
+      source->bufferLength *= 2;
+    }
+    if(!p7HmmLineSourceFill(source)){
+      return false;
+    }
+  }
+}
+
+enum P7HmmReturnCode p7HmmLineSourceReportError(const struct P7HmmLineSource *source,
+  const char *const fileSrc, const size_t lineNumber){
+  if(source->errorCode == p7HmmAllocationFailure){
+    printAllocationError(fileSrc, lineNumber, source->errorMessage);
+  }
+  else if(source->errorCode == p7HmmFileNotFound){
+    printFileError(fileSrc, lineNumber, source->errorMessage);
+  }
+  else if(source->errorCode != p7HmmSuccess){
+    printFormatError(fileSrc, lineNumber, source->errorMessage);
+  }
+  return source->errorCode;
+}
+
+void p7HmmLineSourceRelease(struct P7HmmLineSource *source, char **buffer, size_t *bufferLength){
+  if(source->plainFile != NULL){
+    fclose(source->plainFile);
+  }
+  if(source->compressedFile != NULL){
+    gzclose(source->compressedFile);
+  }
+  *buffer = source->buffer;
+  *bufferLength = source->bufferLength;
+  memset(source, 0, sizeof(struct P7HmmLineSource));
+}
+
+void p7HmmLineSourceClose(struct P7HmmLineSource *source){
+  char *buffer;
+  size_t bufferLength;
+  p7HmmLineSourceRelease(source, &buffer, &bufferLength);
+  free(buffer);
+}
@@ -0,0 +1,141 @@
+#ifndef P7_HMM_READER_LINE_SOURCE_H
+#define P7_HMM_READER_LINE_SOURCE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <zlib.h>
+#include "p7HmmReader.h"
+
+
+//the first two bytes of every gzip member
+#define P7_GZIP_MAGIC_0 0x1f
+#define P7_GZIP_MAGIC_1 0x8b
+
+//reads a plain or gzip compressed file one line at a time.
+struct P7HmmLineSource{
+  FILE *plainFile;            //NULL if the file is gzip compressed
+  gzFile compressedFile;      //NULL if the file is plain text
+  char *buffer;
+  size_t bufferLength;
+  size_t lineStart;           //offset of the next unread character in the buffer
+  size_t dataEnd;             //offset one past the last character read into the buffer
+  bool reachedEnd;
+  enum P7HmmReturnCode errorCode;   //p7HmmSuccess unless reading failed
+  char *errorMessage;
+};
+
+
+/*
+ * Function:  p7HmmHasGzipMagic
+ * --------------------
+ * Checks if the given data begins with the gzip magic bytes.
+ *
+ *  Inputs:
+ *    data: pointer to the start of the data.
+ *    dataLength: number of bytes available at data.
+ *
+ *  Returns:
+ *    true if the data looks like a gzip stream.
+ */
+static inline bool p7HmmHasGzipMagic(const char *const data, const size_t dataLength){
+  return dataLength >= 2 && (unsigned char)data[0] == P7_GZIP_MAGIC_0 && (unsigned char)data[1] == P7_GZIP_MAGIC_1;
+}
+
+/*
+ * Function:  p7HmmLineSourceOpen
+ * --------------------
+ * Opens the given file for reading line by line. The file is read in large blocks that are split
+ *  into lines in place. If the file starts with the gzip magic bytes, it is decompressed as it is read.
+ *
+ *  Inputs:
+ *    source: pointer to the line source to initialize.
+ *    fileSrc: Location of the file to open.
+ *
+ *  Returns:
+ *    p7HmmSuccess if the file was opened,
+ *    p7HmmFileNotFound if the file could not be opened,
+ *    p7HmmAllocationFailure if the line buffer could not be allocated.
+ */
+enum P7HmmReturnCode p7HmmLineSourceOpen(struct P7HmmLineSource *source, const char *const fileSrc);
+
+/*
+ * Function:  p7HmmLineSourceOpenWithBuffer
+ * --------------------
+ * Opens the given file like p7HmmLineSourceOpen, but reads lines into the given buffer, e.g., one
+ *  left over from a previous file, instead of allocating a new one. The buffer is only reallocated
+ *  if it is too small for the file. Whether or not the open succeeds, the source holds the buffer
+ *  until p7HmmLineSourceRelease hands it back, so that must always be called afterwards.
+ *
+ *  Inputs:
+ *    source: pointer to the line source to initialize.
+ *    fileSrc: Location of the file to open.
+ *    buffer: malloc'd buffer to read lines into, or NULL.
+ *    bufferLength: size of the buffer, in bytes.
+ *
+ *  Returns:
+ *    the same return codes as p7HmmLineSourceOpen.
+ */
+enum P7HmmReturnCode p7HmmLineSourceOpenWithBuffer(struct P7HmmLineSource *source, const char *const fileSrc,
+  char *buffer, const size_t bufferLength);
+
+/*
+ * Function:  p7HmmLineSourceNext
+ * --------------------
+ * Reads the next line from the source. The line is returned as a slice into the
+ *  source's buffer, without the trailing newline, and is only valid until the next call.
+ *
+ *  Inputs:
+ *    source: pointer to the opened line source.
+ *    line: set to the first character of the line.
+ *    lineLength: set to the number of characters in the line.
+ *
+ *  Returns:
+ *    true if a line was read, or false at the end of the file, or if reading failed.
+ *      Failures are distinguished by source->errorCode being set, see p7HmmLineSourceReportError.
+ */
+bool p7HmmLineSourceNext(struct P7HmmLineSource *source, const char **line, size_t *lineLength);
+
+/*
+ * Function:  p7HmmLineSourceReportError
+ * --------------------
+ * Prints the error that stopped p7HmmLineSourceNext, if there was one.
+ *
+ *  Inputs:
+ *    source: pointer to the line source.
+ *    fileSrc: Location of the file, for labeling the error message.
+ *    lineNumber: line number where reading failed.
+ *
+ *  Returns:
+ *    p7HmmSuccess if reading stopped at the end of the file,
+ *    p7HmmAllocationFailure if the line buffer could not be grown,
+ *    p7HmmFormatError if the compressed data was corrupt or truncated,
+ *    p7HmmFileNotFound if reading the file failed.
+ */
+enum P7HmmReturnCode p7HmmLineSourceReportError(const struct P7HmmLineSource *source,
+  const char *const fileSrc, const size_t lineNumber);
+
+/*
+ * Function:  p7HmmLineSourceRelease
+ * --------------------
+ * Closes the source's file, but hands its buffer back to the caller instead of freeing it.
+ *
+ *  Inputs:
+ *    source: pointer to the line source to close.
+ *    buffer: set to the source's buffer (possibly NULL), which the caller must eventually free.
+ *    bufferLength: set to the size of the buffer.
+ */
+void p7HmmLineSourceRelease(struct P7HmmLineSource *source, char **buffer, size_t *bufferLength);
+
+/*
+ * Function:  p7HmmLineSourceClose
+ * --------------------
+ * Closes the source's file and frees its buffer.
+ *
+ *  Inputs:
+ *    source: pointer to the line source to close.
+ */
+void p7HmmLineSourceClose(struct P7HmmLineSource *source);
+
+#endif
@@ -0,0 +1,103 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "p7HmmReader.h"
+#include "p7ProfileHmm.h"
+
+
+#define P7_PACKED_NUM_TRANSITIONS 7
+#define P7_PACKED_FLOATS_PER_LINE (P7_MODEL_DATA_ALIGNMENT / sizeof(float))
+
+
+enum P7HmmReturnCode p7HmmPackModel(const struct P7Hmm *const phmm, struct P7HmmPackedModel *packedModel){
+  memset(packedModel, 0, sizeof(struct P7HmmPackedModel));
+  const uint32_t alphabetCardinality = p7HmmGetAlphabetCardinality(phmm);
+  const uint32_t modelLength = phmm->header.modelLength;
+  const struct P7Model *model = &phmm->model;
+  if(alphabetCardinality == 0 || modelLength == 0 || model->matchEmissionScores == NULL){
+    return p7HmmFormatError;
+  }
+
+  //round each record up to whole cache lines, so every record starts on its own line
+  const uint32_t recordLength = P7_HMM_PACKED_MATCH_OFFSET + 2 * alphabetCardinality;
+  const uint32_t nodeStride = (recordLength + P7_PACKED_FLOATS_PER_LINE - 1) & ~(uint32_t)(P7_PACKED_FLOATS_PER_LINE - 1);
+  float *nodes = aligned_alloc(P7_MODEL_DATA_ALIGNMENT, (size_t)nodeStride * modelLength * sizeof(float));
+  if(nodes == NULL){
+    return p7HmmAllocationFailure;
+  }
+
+  const float *const transitions[P7_PACKED_NUM_TRANSITIONS] = {
+    [p7HmmMatchToMatch] = model->stateTransitions.matchToMatch,
+    [p7HmmMatchToInsert] = model->stateTransitions.matchToInsert,
+    [p7HmmMatchToDelete] = model->stateTransitions.matchToDelete,
+    [p7HmmInsertToMatch] = model->stateTransitions.insertToMatch,
+    [p7HmmInsertToInsert] = model->stateTransitions.insertToInsert,
+    [p7HmmDeleteToMatch] = model->stateTransitions.deleteToMatch,
+    [p7HmmDeleteToDelete] = model->stateTransitions.deleteToDelete};
+  const uint32_t insertOffset = P7_HMM_PACKED_MATCH_OFFSET + alphabetCardinality;
+  for(uint32_t nodeIndex = 0; nodeIndex < modelLength; nodeIndex++){
+    float *record = nodes + (size_t)nodeIndex * nodeStride;
+    for(uint32_t i = 0; i < P7_PACKED_NUM_TRANSITIONS; i++){
+      record[i] = transitions[i][nodeIndex];
+    }
+    //the padding is zeroed, so records can be compared or hashed whole
+    for(uint32_t i = P7_PACKED_NUM_TRANSITIONS; i < P7_HMM_PACKED_MATCH_OFFSET; i++){
+      record[i] = 0;
+    }
+    memcpy(record + P7_HMM_PACKED_MATCH_OFFSET, model->matchEmissionScores + (size_t)nodeIndex * alphabetCardinality,
+      alphabetCardinality * sizeof(float));
+    const float *insertRow = p7HmmGetInsertEmissionRow(phmm, nodeIndex);
+    for(uint32_t i = 0; i < alphabetCardinality; i++){
+      record[insertOffset + i] = insertRow == NULL? NAN: insertRow[i];
+    }
+    for(uint32_t i = recordLength; i < nodeStride; i++){
+      record[i] = 0;
+    }
+  }
+
+  packedModel->nodes = nodes;
+  packedModel->modelLength = modelLength;
+  packedModel->alphabetCardinality = alphabetCardinality;
+  packedModel->nodeStride = nodeStride;
+  packedModel->insertOffset = insertOffset;
+  return p7HmmSuccess;
+}
+
+const float *p7HmmPackedGetNode(const struct P7HmmPackedModel *const packedModel, const uint32_t nodeIndex){
+  if(nodeIndex >= packedModel->modelLength){
+    return NULL;
+  }
+  return packedModel->nodes + (size_t)nodeIndex * packedModel->nodeStride;
+}
+
+float p7HmmPackedGetMatchEmissionScore(const struct P7HmmPackedModel *const packedModel, const uint32_t nodeIndex,
+  const uint32_t symbolIndex){
+  const float *record = p7HmmPackedGetNode(packedModel, nodeIndex);
+  if(record == NULL || symbolIndex >= packedModel->alphabetCardinality){
+    return NAN;
+  }
+  return record[P7_HMM_PACKED_MATCH_OFFSET + symbolIndex];
+}
+
+float p7HmmPackedGetInsertEmissionScore(const struct P7HmmPackedModel *const packedModel, const uint32_t nodeIndex,
+  const uint32_t symbolIndex){
+  const float *record = p7HmmPackedGetNode(packedModel, nodeIndex);
+  if(record == NULL || symbolIndex >= packedModel->alphabetCardinality){
+    return NAN;
+  }
+  return record[packedModel->insertOffset + symbolIndex];
+}
+
+float p7HmmPackedGetTransition(const struct P7HmmPackedModel *const packedModel, const uint32_t nodeIndex,
+  const enum P7HmmTransition transition){
+  const float *record = p7HmmPackedGetNode(packedModel, nodeIndex);
+  if(record == NULL || (uint32_t)transition >= P7_PACKED_NUM_TRANSITIONS){
+    return NAN;
+  }
+  return record[transition];
+}
+
+void p7HmmPackedModelDealloc(struct P7HmmPackedModel *packedModel){
+  free(packedModel->nodes);
+  memset(packedModel, 0, sizeof(struct P7HmmPackedModel));
+}
@@ -0,0 +1,85 @@
+#ifndef P7_HMM_READER_PARALLEL_H
+#define P7_HMM_READER_PARALLEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+
+/*
+ * Function:  p7HmmResolveThreadCount
+ * --------------------
+ * Converts a user supplied thread count into the number of threads to use.
+ *
+ *  Inputs:
+ *    numThreads: requested number of threads, or 0 for one thread per online processor.
+ *
+ *  Returns:
+ *    The number of threads to use, at least 1.
+ */
+uint32_t p7HmmResolveThreadCount(const uint32_t numThreads);
+
+/*
+ * Function:  p7HmmIsRecordEndLine
+ * --------------------
+ * Checks if the line is a model's '//' terminator. Leading blanks are skipped, as the parser does.
+ *
+ *  Inputs:
+ *    line: start of the line.
+ *    lineEnd: end of the line, not including the newline.
+ *
+ *  Returns:
+ *    true if the line's first non-blank characters are '//'.
+ */
+bool p7HmmIsRecordEndLine(const char *line, const char *const lineEnd);
+
+/*
+ * Function:  p7HmmCountLines
+ * --------------------
+ * Counts the newlines in the given text.
+ *
+ *  Inputs:
+ *    data: text to count the lines of.
+ *    length: number of characters in data.
+ *
+ *  Returns:
+ *    The number of newline characters in data.
+ */
+size_t p7HmmCountLines(const char *const data, const size_t length);
+
+/*
+ * Function:  p7HmmNextRecordBoundary
+ * --------------------
+ * Finds the end of the first model that ends at or after the given position, i.e.,
+ *  the position just past the first '//' terminator line whose '//' is at or after position.
+ *  Terminators may be indented with blanks, as with p7HmmIsRecordEndLine.
+ *
+ *  Inputs:
+ *    data: hmm file text.
+ *    length: number of characters in data.
+ *    position: offset to begin searching from.
+ *
+ *  Returns:
+ *    Offset one past the terminator line's newline, or length if no more terminators were found.
+ */
+size_t p7HmmNextRecordBoundary(const char *const data, const size_t length, size_t position);
+
+/*
+ * Function:  p7HmmRunWorkers
+ * --------------------
+ * Runs the worker function on numWorkers threads, all given the same argument, and waits
+ *  for them to finish. One of the workers runs on the calling thread, so the work is
+ *  still done if no threads could be started. Workers are expected to claim their own
+ *  work from the shared argument, e.g., with an atomic counter.
+ *
+ *  Inputs:
+ *    worker: function to run.
+ *    argument: argument passed to every worker.
+ *    numWorkers: number of workers to run, including the calling thread.
+ *
+ *  Returns:
+ *    true if the workers ran, or false if memory for the thread handles could not be allocated.
+ */
+bool p7HmmRunWorkers(void *(*worker)(void*), void *argument, const uint32_t numWorkers);
+
+#endif
@@ -0,0 +1,308 @@
+#define  _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "p7HmmReader.h"
+#include "p7HmmParser.h"
+#include "p7HmmFileMap.h"
+#include "p7HmmLineSource.h"
+#include "p7HmmParallel.h"
+#include "p7ScoreDecoder.h"
+#include "p7ProfileHmm.h"
+#include "p7HmmReaderLog.h"
+
+
+//files smaller than this per thread aren't worth the cost of starting more threads
+#define P7_PARALLEL_MIN_CHUNK_LENGTH (1 << 16)
+
+
+struct P7HmmParseChunk{
+  const char *fileSrc;
+  const char *start;
+  size_t length;
+  size_t firstLineNumber;       //number of lines in the file before this chunk, for labeling errors
+  size_t numLines;
+  struct P7HmmList phmmList;
+  enum P7HmmReturnCode returnCode;
+};
+
+struct P7HmmBatchWork{
+  const char *const *fileSrcs;
+  uint32_t numFiles;
+  atomic_uint_fast32_t nextFileIndex;
+  struct P7HmmList *fileLists;
+  enum P7HmmReturnCode *fileReturnCodes;
+};
+
+
+uint32_t p7HmmResolveThreadCount(const uint32_t numThreads){
+  if(numThreads != 0){
+    return numThreads;
+  }
+  long numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+  return numProcessors > 0? numProcessors: 1;
+}
+
+bool p7HmmIsRecordEndLine(const char *line, const char *const lineEnd){
+  while(line < lineEnd && p7IsBlank(*line)){
+    line++;
+  }
+  return lineEnd - line >= 2 && line[0] == '/' && line[1] == '/';
+}
+
+size_t p7HmmCountLines(const char *const data, const size_t length){
+  size_t numLines = 0;
+  //simple enough for the compiler to vectorize
+  for(size_t i = 0; i < length; i++){
+    numLines += data[i] == '\n';
+  }
+  return numLines;
+}
+
+size_t p7HmmNextRecordBoundary(const char *const data, const size_t length, size_t position){
+  while(position < length){
+    const char *slash = memchr(data + position, '/', length - position);
+    if(slash == NULL){
+      return length;
+    }
+    const size_t slashPosition = slash - data;
+    //the terminator may be indented, so look back over any blanks for the start of the line
+    size_t lineStart = slashPosition;
+    while(lineStart > 0 && p7IsBlank(data[lineStart - 1])){
+      lineStart--;
+    }
+    const bool startsLine = lineStart == 0 || data[lineStart - 1] == '\n';
+    if(startsLine && slashPosition + 1 < length && data[slashPosition + 1] == '/'){
+      const char *newline = memchr(slash, '\n', length - slashPosition);
+      return newline == NULL? length: (size_t)(newline - data) + 1;
+    }
+    position = slashPosition + 1;
+  }
+  return length;
+}
+
+static void *p7CountChunkLines(void *argument){
+  struct P7HmmParseChunk *chunk = argument;
+  chunk->numLines = p7HmmCountLines(chunk->start, chunk->length);
+  return NULL;
+}
+
+static void *p7ParseChunk(void *argument){
+  struct P7HmmParseChunk *chunk = argument;
+  struct P7HmmParser parser;
+  p7HmmParserInit(&parser, chunk->fileSrc, &chunk->phmmList);
+  parser.lineNumber = chunk->firstLineNumber;
+
+  chunk->returnCode = p7HmmParserConsumeBuffer(&parser, chunk->start, chunk->length);
+  //a chunk may legitimately hold no models (e.g., trailing whitespace), but must not end mid-model
+  if(chunk->returnCode == p7HmmSuccess && parser.parserState != parsingHmmIdle){
+    chunk->returnCode = p7HmmParserFinish(&parser);
+  }
+  return NULL;
+}
+
+//runs the worker function over every chunk, with chunk 0 on the calling thread.
+static void p7RunOnChunks(void *(*worker)(void*), struct P7HmmParseChunk *chunks,
+  pthread_t *threads, bool *threadStarted, const uint32_t numChunks){
+  for(uint32_t i = 1; i < numChunks; i++){
+    threadStarted[i] = pthread_create(&threads[i], NULL, worker, &chunks[i]) == 0;
+  }
+  worker(&chunks[0]);
+  for(uint32_t i = 1; i < numChunks; i++){
+    if(threadStarted[i]){
+      pthread_join(threads[i], NULL);
+    }
+    else{
+      //couldn't get a thread, so do the work here instead
+      worker(&chunks[i]);
+    }
+  }
+}
+
+//each worker claims the next unread file until none are left, so threads that draw small files
+//simply load more of them instead of waiting on a fixed share of the list.
+//each worker has its own parser context, so its line buffer is reused for every file it loads.
+static void *p7LoadBatchFiles(void *argument){
+  struct P7HmmBatchWork *work = argument;
+  struct P7HmmContext *context;
+  const bool hasContext = p7HmmContextCreate(&context) == p7HmmSuccess;
+  uint_fast32_t fileIndex;
+  while((fileIndex = atomic_fetch_add(&work->nextFileIndex, 1)) < work->numFiles){
+    work->fileReturnCodes[fileIndex] = hasContext?
+      readP7HmmWithContext(context, work->fileSrcs[fileIndex], &work->fileLists[fileIndex]):
+      readP7Hmm(work->fileSrcs[fileIndex], &work->fileLists[fileIndex]);
+  }
+  p7HmmContextDestroy(context);
+  return NULL;
+}
+
+bool p7HmmRunWorkers(void *(*worker)(void*), void *argument, const uint32_t numWorkers){
+  pthread_t *threads = malloc(numWorkers * sizeof(pthread_t));
+  bool *threadStarted = malloc(numWorkers * sizeof(bool));
+  if(threads == NULL || threadStarted == NULL){
+    free(threads);
+    free(threadStarted);
+    return false;
+  }
+  for(uint32_t i = 1; i < numWorkers; i++){
+    threadStarted[i] = pthread_create(&threads[i], NULL, worker, argument) == 0;
+  }
+  worker(argument);
+  for(uint32_t i = 1; i < numWorkers; i++){
+    if(threadStarted[i]){
+      pthread_join(threads[i], NULL);
+    }
+  }
+  free(threads);
+  free(threadStarted);
+  return true;
+}
+
+
+enum P7HmmReturnCode readP7HmmParallel(const char *const fileSrc, const uint32_t numThreads, struct P7HmmList *phmmList){
+  p7HmmListInit(phmmList);
+
+  struct P7HmmFileMap fileMap;
+  enum P7HmmReturnCode returnCode = p7HmmFileMapOpen(fileSrc, &fileMap);
+  if(returnCode != p7HmmSuccess){
+    return returnCode;
+  }
+  //a gzip stream can only be decompressed from the start, so compressed files are read serially
+  if(p7HmmHasGzipMagic(fileMap.data, fileMap.length)){
+    p7HmmFileMapClose(&fileMap);
+    return readP7Hmm(fileSrc, phmmList);
+  }
+
+  uint32_t numChunks = p7HmmResolveThreadCount(numThreads);
+  const size_t maxChunksForLength = fileMap.length / P7_PARALLEL_MIN_CHUNK_LENGTH + 1;
+  if(numChunks > maxChunksForLength){
+    numChunks = maxChunksForLength;
+  }
+
+  struct P7HmmParseChunk *chunks = malloc(numChunks * sizeof(struct P7HmmParseChunk));
+  pthread_t *threads = malloc(numChunks * sizeof(pthread_t));
+  bool *threadStarted = malloc(numChunks * sizeof(bool));
+  if(chunks == NULL || threads == NULL || threadStarted == NULL){
+    free(chunks);
+    free(threads);
+    free(threadStarted);
+    p7HmmFileMapClose(&fileMap);
+    printAllocationError(fileSrc, 0, "failed to allocate memory for parallel parsing chunks.");
+    return p7HmmAllocationFailure;
+  }
+
+  //split the file into roughly equal byte ranges, each moved forward to end on a record boundary
+  size_t chunkStart = 0;
+  uint32_t numUsedChunks = 0;
+  for(uint32_t i = 0; i < numChunks && chunkStart < fileMap.length; i++){
+    size_t chunkEnd = fileMap.length;
+    if(i + 1 < numChunks){
+      size_t targetEnd = (fileMap.length / numChunks) * (i + 1);
+      if(targetEnd < chunkStart){
+        targetEnd = chunkStart;
+      }
+      chunkEnd = p7HmmNextRecordBoundary(fileMap.data, fileMap.length, targetEnd);
+    }
+    struct P7HmmParseChunk *chunk = &chunks[numUsedChunks++];
+    chunk->fileSrc = fileSrc;
+    chunk->start = fileMap.data + chunkStart;
+    chunk->length = chunkEnd - chunkStart;
+    chunk->returnCode = p7HmmSuccess;
+    p7HmmListInit(&chunk->phmmList);
+    chunkStart = chunkEnd;
+  }
+
+  size_t numLines = 0;
+  if(numUsedChunks > 1){
+    //line numbers are only needed to label errors, but each chunk must know where it starts before parsing
+    p7RunOnChunks(p7CountChunkLines, chunks, threads, threadStarted, numUsedChunks);
+    for(uint32_t i = 0; i < numUsedChunks; i++){
+      chunks[i].firstLineNumber = numLines;
+      numLines += chunks[i].numLines;
+    }
+  }
+  else if(numUsedChunks == 1){
+    chunks[0].firstLineNumber = 0;
+  }
+  if(numUsedChunks > 0){
+    p7RunOnChunks(p7ParseChunk, chunks, threads, threadStarted, numUsedChunks);
+  }
+
+  //merge the chunk lists in file order
+  uint32_t totalModels = 0;
+  for(uint32_t i = 0; i < numUsedChunks; i++){
+    if(returnCode == p7HmmSuccess){
+      returnCode = chunks[i].returnCode;
+    }
+    totalModels += chunks[i].phmmList.count;
+  }
+  if(returnCode == p7HmmSuccess && totalModels == 0){
+    printFormatError(fileSrc, numLines,
+      "reached the end of the file without finding a profile hmm (expected a 'HMMER3' format tag).");
+    returnCode = p7HmmFormatError;
+  }
+  for(uint32_t i = 0; i < numUsedChunks && returnCode == p7HmmSuccess; i++){
+    returnCode = p7HmmListConcatenate(phmmList, &chunks[i].phmmList, 1);
+    if(returnCode != p7HmmSuccess){
+      printAllocationError(fileSrc, 0, "could not allocate memory for the merged P7ProfileHmmList list.");
+    }
+  }
+  if(returnCode != p7HmmSuccess){
+    p7HmmListDealloc(phmmList);
+    for(uint32_t i = 0; i < numUsedChunks; i++){
+      p7HmmListDealloc(&chunks[i].phmmList);
+    }
+  }
+
+  free(chunks);
+  free(threads);
+  free(threadStarted);
+  p7HmmFileMapClose(&fileMap);
+  return returnCode;
+}
+
+enum P7HmmReturnCode readP7HmmBatch(const char *const *fileSrcs, const uint32_t numFiles, const uint32_t numThreads,
+  struct P7HmmList *phmmList, enum P7HmmReturnCode *fileReturnCodes){
+  p7HmmListInit(phmmList);
+
+  uint32_t numWorkers = p7HmmResolveThreadCount(numThreads);
+  if(numWorkers > numFiles){
+    numWorkers = numFiles > 0? numFiles: 1;
+  }
+
+  struct P7HmmList *fileLists = malloc(numFiles * sizeof(struct P7HmmList));
+  if(numFiles != 0 && fileLists == NULL){
+    printAllocationError("(batch)", 0, "failed to allocate memory for batch loading.");
+    return p7HmmAllocationFailure;
+  }
+  for(uint32_t i = 0; i < numFiles; i++){
+    p7HmmListInit(&fileLists[i]);
+    fileReturnCodes[i] = p7HmmSuccess;
+  }
+
+  struct P7HmmBatchWork work = {.fileSrcs = fileSrcs, .numFiles = numFiles,
+    .fileLists = fileLists, .fileReturnCodes = fileReturnCodes};
+  atomic_init(&work.nextFileIndex, 0);
+  if(!p7HmmRunWorkers(p7LoadBatchFiles, &work, numWorkers)){
+    //couldn't allocate the thread handles, so load everything on this thread instead
+    p7LoadBatchFiles(&work);
+  }
+
+  //merge the successfully loaded files in the order they were given
+  enum P7HmmReturnCode returnCode = p7HmmSuccess;
+  for(uint32_t i = 0; i < numFiles && returnCode == p7HmmSuccess; i++){
+    returnCode = fileReturnCodes[i];
+  }
+  if(p7HmmListConcatenate(phmmList, fileLists, numFiles) != p7HmmSuccess){
+    for(uint32_t i = 0; i < numFiles; i++){
+      p7HmmListDealloc(&fileLists[i]);
+    }
+    printAllocationError("(batch)", 0, "could not allocate memory for the merged P7ProfileHmmList list.");
+    returnCode = p7HmmAllocationFailure;
+  }
+
+  free(fileLists);
+  return returnCode;
+}
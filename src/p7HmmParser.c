@@ -0,0 +1,1072 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "p7HmmParser.h"
+#include "p7ScoreDecoder.h"
+#include "p7ProfileHmm.h"
+#include "p7HmmArena.h"
+#include "p7HmmReaderLog.h"
+
+
+#define P7_HEADER_FORMAT_FLAG "HMMER3"
+#define P7_HEADER_NAME_FLAG "NAME"
+#define P7_HEADER_ACCESSION_FLAG "ACC"
+#define P7_HEADER_DESCRIPTION_FLAG "DESC"
+#define P7_HEADER_LENGTH_FLAG "LENG"
+#define P7_HEADER_MAXL_FLAG "MAXL"
+#define P7_HEADER_ALPHABET_FLAG "ALPH"
+#define P7_HEADER_REFERENCE_FLAG "RF"
+#define P7_HEADER_MASK_FLAG "MM"
+#define P7_HEADER_CONSENSUS_RESIDUE_FLAG "CONS"
+#define P7_HEADER_CONSENSUS_STRUCTURE_FLAG "CS"
+#define P7_HEADER_MAP_FLAG "MAP"
+#define P7_HEADER_DATE_FLAG "DATE"
+#define P7_HEADER_COMMAND_FLAG "COM"
+#define P7_HEADER_NSEQ_FLAG "NSEQ"
+#define P7_HEADER_EFFN_FLAG "EFFN"
+#define P7_HEADER_CHECKSUM_FLAG "CKSUM"
+#define P7_HEADER_GATHERING_FLAG "GA"
+#define P7_HEADER_TRUSTED_FLAG "TC"
+#define P7_HEADER_NOISE_FLAG "NC"
+#define P7_HEADER_STATS_FLAG "STATS"
+#define P7_HEADER_BUILD_COMMAND_FLAG "BM"
+#define P7_HEADER_SEARCH_COMMAND_FLAG "SM"
+
+#define P7_BODY_HMM_MODEL_START_FLAG "HMM"
+#define P7_BODY_COMPO_FLAG "COMPO"
+#define P7_BODY_END_FLAG "//"
+
+//most models use a single insert emission row, so the unique rows start small and double as needed
+#define P7_PARSER_INITIAL_UNIQUE_INSERT_ROWS 4
+
+
+enum P7HeaderTag{
+  p7TagUnknown, p7TagName, p7TagAccession, p7TagDescription, p7TagLength, p7TagMaxLength,
+  p7TagAlphabet, p7TagReference, p7TagMask, p7TagConsensusResidue, p7TagConsensusStructure,
+  p7TagMap, p7TagDate, p7TagCommand, p7TagNumSequences, p7TagEffectiveNumSequences,
+  p7TagChecksum, p7TagGathering, p7TagTrusted, p7TagNoise, p7TagBuildCommand, p7TagSearchCommand,
+  p7TagStats, p7TagModelStart
+};
+
+//finds the next whitespace delimited token, starting at *cursor. On success, the cursor is
+//advanced to the end of the token. Returns false if there are no more tokens on the line.
+static inline bool p7NextToken(const char **cursor, const char *const lineEnd, const char **token, size_t *tokenLength){
+  const char *position = *cursor;
+  while(position < lineEnd && p7IsBlank(*position)){
+    position++;
+  }
+  if(position == lineEnd){
+    *cursor = position;
+    return false;
+  }
+  const char *tokenStart = position;
+  while(position < lineEnd && !p7IsBlank(*position)){
+    position++;
+  }
+  *token = tokenStart;
+  *tokenLength = position - tokenStart;
+  *cursor = position;
+  return true;
+}
+
+//returns the remainder of the line after the cursor, with surrounding whitespace trimmed.
+//Returns false if the remainder of the line is blank.
+static inline bool p7RemainingText(const char *cursor, const char *lineEnd, const char **text, size_t *textLength){
+  while(cursor < lineEnd && p7IsBlank(*cursor)){
+    cursor++;
+  }
+  while(lineEnd > cursor && p7IsBlank(lineEnd[-1])){
+    lineEnd--;
+  }
+  *text = cursor;
+  *textLength = lineEnd - cursor;
+  return *textLength != 0;
+}
+
+static inline bool p7TokenEquals(const char *token, const size_t tokenLength, const char *const flag){
+  const size_t flagLength = strlen(flag);
+  return tokenLength == flagLength && memcmp(token, flag, flagLength) == 0;
+}
+
+//dispatches a header token to its tag by switching on the token length and leading character,
+//so each line costs at most one comparison against a keyword.
+static enum P7HeaderTag p7HeaderTagLookup(const char *token, const size_t tokenLength){
+  switch(tokenLength){
+    case 2:
+      switch(token[0]){
+        case 'R': return p7TokenEquals(token, tokenLength, P7_HEADER_REFERENCE_FLAG)?           p7TagReference: p7TagUnknown;
+        case 'M': return p7TokenEquals(token, tokenLength, P7_HEADER_MASK_FLAG)?                p7TagMask: p7TagUnknown;
+        case 'C': return p7TokenEquals(token, tokenLength, P7_HEADER_CONSENSUS_STRUCTURE_FLAG)? p7TagConsensusStructure: p7TagUnknown;
+        case 'G': return p7TokenEquals(token, tokenLength, P7_HEADER_GATHERING_FLAG)?           p7TagGathering: p7TagUnknown;
+        case 'T': return p7TokenEquals(token, tokenLength, P7_HEADER_TRUSTED_FLAG)?             p7TagTrusted: p7TagUnknown;
+        case 'N': return p7TokenEquals(token, tokenLength, P7_HEADER_NOISE_FLAG)?               p7TagNoise: p7TagUnknown;
+        case 'B': return p7TokenEquals(token, tokenLength, P7_HEADER_BUILD_COMMAND_FLAG)?       p7TagBuildCommand: p7TagUnknown;
+        case 'S': return p7TokenEquals(token, tokenLength, P7_HEADER_SEARCH_COMMAND_FLAG)?      p7TagSearchCommand: p7TagUnknown;
+        default: return p7TagUnknown;
+      }
+    case 3:
+      switch(token[0]){
+        case 'A': return p7TokenEquals(token, tokenLength, P7_HEADER_ACCESSION_FLAG)?     p7TagAccession: p7TagUnknown;
+        case 'M': return p7TokenEquals(token, tokenLength, P7_HEADER_MAP_FLAG)?           p7TagMap: p7TagUnknown;
+        case 'C': return p7TokenEquals(token, tokenLength, P7_HEADER_COMMAND_FLAG)?       p7TagCommand: p7TagUnknown;
+        case 'H': return p7TokenEquals(token, tokenLength, P7_BODY_HMM_MODEL_START_FLAG)? p7TagModelStart: p7TagUnknown;
+        default: return p7TagUnknown;
+      }
+    case 4:
+      switch(token[0]){
+        case 'N':
+          if(p7TokenEquals(token, tokenLength, P7_HEADER_NAME_FLAG)) return p7TagName;
+          return p7TokenEquals(token, tokenLength, P7_HEADER_NSEQ_FLAG)? p7TagNumSequences: p7TagUnknown;
+        case 'D':
+          if(p7TokenEquals(token, tokenLength, P7_HEADER_DESCRIPTION_FLAG)) return p7TagDescription;
+          return p7TokenEquals(token, tokenLength, P7_HEADER_DATE_FLAG)? p7TagDate: p7TagUnknown;
+        case 'L': return p7TokenEquals(token, tokenLength, P7_HEADER_LENGTH_FLAG)?             p7TagLength: p7TagUnknown;
+        case 'M': return p7TokenEquals(token, tokenLength, P7_HEADER_MAXL_FLAG)?               p7TagMaxLength: p7TagUnknown;
+        case 'A': return p7TokenEquals(token, tokenLength, P7_HEADER_ALPHABET_FLAG)?           p7TagAlphabet: p7TagUnknown;
+        case 'C': return p7TokenEquals(token, tokenLength, P7_HEADER_CONSENSUS_RESIDUE_FLAG)?  p7TagConsensusResidue: p7TagUnknown;
+        case 'E': return p7TokenEquals(token, tokenLength, P7_HEADER_EFFN_FLAG)?               p7TagEffectiveNumSequences: p7TagUnknown;
+        default: return p7TagUnknown;
+      }
+    case 5:
+      switch(token[0]){
+        case 'C': return p7TokenEquals(token, tokenLength, P7_HEADER_CHECKSUM_FLAG)? p7TagChecksum: p7TagUnknown;
+        case 'S': return p7TokenEquals(token, tokenLength, P7_HEADER_STATS_FLAG)?    p7TagStats: p7TagUnknown;
+        default: return p7TagUnknown;
+      }
+    default: return p7TagUnknown;
+  }
+}
+
+//parses an unsigned integer from the start of the token, like sscanf's "%u".
+static bool p7ParseUint32(const char *token, const size_t tokenLength, uint32_t *value){
+  const char *position = token;
+  const char *const tokenEnd = token + tokenLength;
+  if(position < tokenEnd && *position == '+'){
+    position++;
+  }
+  if(position == tokenEnd || !p7IsDigit(*position)){
+    return false;
+  }
+  uint64_t accumulator = 0;
+  while(position < tokenEnd && p7IsDigit(*position)){
+    accumulator = (accumulator * 10) + (*position - '0');
+    if(accumulator > UINT32_MAX){
+      return false;
+    }
+    position++;
+  }
+  *value = (uint32_t)accumulator;
+  return true;
+}
+
+//header strings come out of the list's arena when it has one, so they're freed along with it.
+static char *p7ParserAllocString(struct P7HmmParser *parser, const size_t length){
+  struct P7HmmArena *arena = parser->phmmList->arena;
+  return arena != NULL? p7HmmArenaAllocString(arena, length): malloc(length);
+}
+
+static char *p7CopySlice(struct P7HmmParser *parser, const char *text, const size_t textLength){
+  char *copy = p7ParserAllocString(parser, textLength + 1);
+  if(copy != NULL){
+    memcpy(copy, text, textLength);
+    copy[textLength] = 0;
+  }
+  return copy;
+}
+
+//parses the 'yes' or 'no' value that follows the annotation tags in the header.
+static enum P7HmmReturnCode p7ParseYesNo(struct P7HmmParser *parser, const char **cursor, const char *lineEnd,
+  bool *flag, char *missingMessage, char *invalidMessage){
+  const char *token;
+  size_t tokenLength;
+  if(!p7NextToken(cursor, lineEnd, &token, &tokenLength)){
+    printFormatError(parser->fileSrc, parser->lineNumber, missingMessage);
+    return p7HmmFormatError;
+  }
+  if(p7TokenEquals(token, tokenLength, "yes")){
+    *flag = true;
+  }
+  else if(p7TokenEquals(token, tokenLength, "no")){
+    *flag = false;
+  }
+  else{
+    printFormatError(parser->fileSrc, parser->lineNumber, invalidMessage);
+    return p7HmmFormatError;
+  }
+  return p7HmmSuccess;
+}
+
+//parses a line of exactly numValues float values into the given array.
+static enum P7HmmReturnCode p7ParseFloatRow(struct P7HmmParser *parser, const char **cursor, const char *line,
+  const char *lineEnd, float *values, const uint32_t numValues, const char *const rowDescription){
+  uint32_t starMask;
+  const uint32_t numDecoded = p7DecodeScoreRow(cursor, line, lineEnd, values, numValues, &starMask);
+  if(numDecoded < numValues){
+    char printBuffer[256];
+    sprintf(printBuffer, "Error reading value #%u from %s line.", numDecoded+1, rowDescription);
+    printFormatError(parser->fileSrc, parser->lineNumber, printBuffer);
+    return p7HmmFormatError;
+  }
+  if(starMask != 0){
+    char printBuffer[256];
+    sprintf(printBuffer, "Error parsing float value #%u from %s line ('*' is not allowed here).",
+      __builtin_ctz(starMask)+1, rowDescription);
+    printFormatError(parser->fileSrc, parser->lineNumber, printBuffer);
+    return p7HmmFormatError;
+  }
+  return p7HmmSuccess;
+}
+
+static enum P7HmmReturnCode p7AllocateCompactInsertRows(struct P7HmmParser *parser, struct P7Hmm *phmm){
+  const uint32_t alphabetCardinality = p7HmmGetAlphabetCardinality(phmm);
+  parser->uniqueInsertRowCapacity = P7_PARSER_INITIAL_UNIQUE_INSERT_ROWS;
+  phmm->model.insertRowIndices = malloc(phmm->header.modelLength * sizeof(uint32_t));
+  phmm->model.uniqueInsertEmissions = malloc(parser->uniqueInsertRowCapacity * alphabetCardinality * sizeof(float));
+  phmm->model.numUniqueInsertRows = 0;
+  if(phmm->model.insertRowIndices == NULL || phmm->model.uniqueInsertEmissions == NULL){
+    return p7HmmAllocationFailure;
+  }
+  return p7HmmSuccess;
+}
+
+//parses the insert emissions line into the scratch row, then points the node at an identical stored row,
+//adding the row if none is found. Rows usually repeat the previous node's, so that's checked first.
+static enum P7HmmReturnCode p7ParseCompactInsertEmissions(struct P7HmmParser *parser, const char **cursor,
+  const char *line, const char *lineEnd){
+  enum P7HmmReturnCode returnCode = p7ParseFloatRow(parser, cursor, line, lineEnd, parser->scratchRow,
+    parser->alphabetCardinality, "insert emissions");
+  if(returnCode != p7HmmSuccess){
+    return returnCode;
+  }
+  struct P7Model *model = &parser->currentPhmm->model;
+  const uint32_t alphabetCardinality = parser->alphabetCardinality;
+  const size_t rowSize = alphabetCardinality * sizeof(float);
+  const uint32_t nodePosition = parser->nodeIndex - 1;
+  const uint32_t numRows = model->numUniqueInsertRows;
+  uint32_t rowIndex = numRows;
+  if(nodePosition != 0 && memcmp(&model->uniqueInsertEmissions[model->insertRowIndices[nodePosition - 1] * alphabetCardinality],
+      parser->scratchRow, rowSize) == 0){
+    rowIndex = model->insertRowIndices[nodePosition - 1];
+  }
+  else{
+    for(uint32_t i = 0; i < numRows; i++){
+      const float *row = &model->uniqueInsertEmissions[i * alphabetCardinality];
+      if(row[0] == parser->scratchRow[0] && memcmp(row, parser->scratchRow, rowSize) == 0){
+        rowIndex = i;
+        break;
+      }
+    }
+  }
+
+  if(rowIndex == numRows){
+    if(numRows == parser->uniqueInsertRowCapacity){
+      const uint32_t grownCapacity = parser->uniqueInsertRowCapacity * 2;
+      float *grownRows = realloc(model->uniqueInsertEmissions, (size_t)grownCapacity * rowSize);
+      if(grownRows == NULL){
+        printAllocationError(parser->fileSrc, parser->lineNumber, "failed to grow the unique insert emission rows.");
+        return p7HmmAllocationFailure;
+      }
+      model->uniqueInsertEmissions = grownRows;
+      parser->uniqueInsertRowCapacity = grownCapacity;
+    }
+    memcpy(&model->uniqueInsertEmissions[numRows * alphabetCardinality], parser->scratchRow, rowSize);
+    model->numUniqueInsertRows++;
+  }
+  model->insertRowIndices[nodePosition] = rowIndex;
+  return p7HmmSuccess;
+}
+
+//gives back the unused capacity of a finished model's unique insert rows
+static void p7ShrinkCompactInsertRows(struct P7HmmParser *parser){
+  struct P7Model *model = &parser->currentPhmm->model;
+  if(model->insertRowIndices == NULL || model->numUniqueInsertRows == 0 ||
+    model->numUniqueInsertRows == parser->uniqueInsertRowCapacity){
+    return;
+  }
+  float *shrunkRows = realloc(model->uniqueInsertEmissions,
+    (size_t)model->numUniqueInsertRows * parser->alphabetCardinality * sizeof(float));
+  //if the shrink fails, the larger buffer is still valid
+  if(shrunkRows != NULL){
+    model->uniqueInsertEmissions = shrunkRows;
+    parser->uniqueInsertRowCapacity = model->numUniqueInsertRows;
+  }
+}
+
+static enum P7HmmReturnCode p7ParseFormatLine(struct P7HmmParser *parser, const char *line, const char *lineEnd){
+  parser->expectedNodeIndex = 1;
+  parser->completedParsingHmm = false;
+  //we've found another header, so append a new hmm to the list
+  parser->currentPhmm = p7HmmListAppendHmm(parser->phmmList);
+  if(parser->currentPhmm == NULL){
+    printAllocationError(parser->fileSrc, parser->lineNumber, "could not allocate memory to grow the P7ProfileHmmList list.");
+    return p7HmmAllocationFailure;
+  }
+  char *version = p7ParserAllocString(parser, (lineEnd - line) + 1);
+  if(version == NULL){
+    printAllocationError(parser->fileSrc, parser->lineNumber, "couldn't allocate buffer for format tag.");
+    return p7HmmAllocationFailure;
+  }
+  //copy each word of the format tag, separated by single spaces
+  size_t versionLength = 0;
+  const char *cursor = line;
+  const char *token;
+  size_t tokenLength;
+  while(p7NextToken(&cursor, lineEnd, &token, &tokenLength)){
+    if(versionLength != 0){
+      version[versionLength++] = ' ';
+    }
+    memcpy(version + versionLength, token, tokenLength);
+    versionLength += tokenLength;
+  }
+  version[versionLength] = 0;
+  parser->currentPhmm->header.version = version;
+
+  //now switch modes to parsing the header
+  parser->parserState = parsingHmmHeader;
+  return p7HmmSuccess;
+}
+
+static uint32_t p7DeclaredAnnotations(const struct P7Header *header){
+  return (header->hasMapAnnotation?       p7HmmSkipMapAnnotations: 0) |
+    (header->hasConsensusResidue?         p7HmmSkipConsensusResidues: 0) |
+    (header->hasReferenceAnnotation?      p7HmmSkipReferenceAnnotation: 0) |
+    (header->hasModelMask?                p7HmmSkipModelMask: 0) |
+    (header->hasConsensusStructure?       p7HmmSkipConsensusStructure: 0);
+}
+
+//turns off the header flags of skipped annotations, so they're neither allocated nor reported as present.
+static void p7ClearSkippedAnnotations(struct P7Header *header, const uint32_t skipFields){
+  header->hasMapAnnotation       &= !(skipFields & p7HmmSkipMapAnnotations);
+  header->hasConsensusResidue    &= !(skipFields & p7HmmSkipConsensusResidues);
+  header->hasReferenceAnnotation &= !(skipFields & p7HmmSkipReferenceAnnotation);
+  header->hasModelMask           &= !(skipFields & p7HmmSkipModelMask);
+  header->hasConsensusStructure  &= !(skipFields & p7HmmSkipConsensusStructure);
+}
+
+static enum P7HmmReturnCode p7ParseHeaderLine(struct P7HmmParser *parser, const char *firstToken,
+  const size_t firstTokenLength, const char *cursor, const char *lineEnd){
+  struct P7Hmm *currentPhmm = parser->currentPhmm;
+  const char *token;
+  size_t tokenLength;
+
+  switch(p7HeaderTagLookup(firstToken, firstTokenLength)){
+    case p7TagName:
+      //set a default name if this field is missing
+      if(!p7NextToken(&cursor, lineEnd, &token, &tokenLength)){
+        token = "none_given";
+        tokenLength = strlen(token);
+      }
+      currentPhmm->header.name = p7CopySlice(parser, token, tokenLength);
+      if(currentPhmm->header.name == NULL){
+        printAllocationError(parser->fileSrc, parser->lineNumber, "unalble to allocate memory for name.");
+        return p7HmmAllocationFailure;
+      }
+      return p7HmmSuccess;
+
+    case p7TagAccession:
+      if(!p7NextToken(&cursor, lineEnd, &token, &tokenLength)){
+        printFormatError(parser->fileSrc, parser->lineNumber, "couldn't parse accession number tag (ACC).");
+        return p7HmmFormatError;
+      }
+      currentPhmm->header.accessionNumber = p7CopySlice(parser, token, tokenLength);
+      if(currentPhmm->header.accessionNumber == NULL){
+        printAllocationError(parser->fileSrc, parser->lineNumber, "couldn't allocate buffer for accession number tag (ACC).");
+        return p7HmmAllocationFailure;
+      }
+      return p7HmmSuccess;
+
+    case p7TagDescription:
+      if(!p7RemainingText(cursor, lineEnd, &token, &tokenLength)){
+        printFormatError(parser->fileSrc, parser->lineNumber, "couldn't parse description tag (DESC).");
+        return p7HmmFormatError;
+      }
+      currentPhmm->header.description = p7CopySlice(parser, token, tokenLength);
+      if(currentPhmm->header.description == NULL){
+        printAllocationError(parser->fileSrc, parser->lineNumber, "couldn't allocate buffer for description tag (DESC).");
+        return p7HmmAllocationFailure;
+      }
+      return p7HmmSuccess;
+
+    case p7TagLength:
+      if(!p7NextToken(&cursor, lineEnd, &token, &tokenLength)){
+        printFormatError(parser->fileSrc, parser->lineNumber, "couldn't parse model length tag (LENG).");
+        return p7HmmFormatError;
+      }
+      if(!p7ParseUint32(token, tokenLength, &currentPhmm->header.modelLength)){
+        printFormatError(parser->fileSrc, parser->lineNumber, "expected positive nonzero integer after model length tag (LENG).");
+        return p7HmmFormatError;
+      }
+      return p7HmmSuccess;
+
+    case p7TagMaxLength:
+      if(!p7NextToken(&cursor, lineEnd, &token, &tokenLength)){
+        printFormatError(parser->fileSrc, parser->lineNumber, "couldn't parse max length tag (MAXL).");
+        return p7HmmFormatError;
+      }
+      if(!p7ParseUint32(token, tokenLength, &currentPhmm->header.maxLength) || currentPhmm->header.maxLength == 0){
+        printFormatError(parser->fileSrc, parser->lineNumber, "expected positive nonzero integer after max length tag (MAXL).");
+        return p7HmmFormatError;
+      }
+      return p7HmmSuccess;
+
+    case p7TagAlphabet:
+      if(!p7NextToken(&cursor, lineEnd, &token, &tokenLength)){
+        printFormatError(parser->fileSrc, parser->lineNumber, "couldn't parse alphabet tag (ALPH).");
+        return p7HmmFormatError;
+      }
+      if(p7TokenEquals(token, tokenLength, P7_HMM_READER_ALPHABET_AMINO)){
+        currentPhmm->header.alphabet = P7HmmReaderAlphabetAmino;
+      }
+      else if(p7TokenEquals(token, tokenLength, P7_HMM_READER_ALPHABET_DNA)){
+        currentPhmm->header.alphabet = P7HmmReaderAlphabetDna;
+      }
+      else if(p7TokenEquals(token, tokenLength, P7_HMM_READER_ALPHABET_RNA)){
+        currentPhmm->header.alphabet = P7HmmReaderAlphabetRna;
+      }
+      else if(p7TokenEquals(token, tokenLength, P7_HMM_READER_ALPHABET_COINS)){
+        currentPhmm->header.alphabet = P7HmmReaderAlphabetCoins;
+      }
+      else if(p7TokenEquals(token, tokenLength, P7_HMM_READER_ALPHABET_DICE)){
+        currentPhmm->header.alphabet = P7HmmReaderAlphabetDice;
+      }
+      else{
+        currentPhmm->header.alphabet = P7HmmReaderAlphabetNotSet;
+        printFormatError(parser->fileSrc, parser->lineNumber, "expected 'amino', 'DNA', 'RNA', 'coins', or 'dice' after alphabet tag (ALPH).");
+        return p7HmmFormatError;
+      }
+      return p7HmmSuccess;
+
+    case p7TagReference:
+      return p7ParseYesNo(parser, &cursor, lineEnd, &currentPhmm->header.hasReferenceAnnotation,
+        "couldn't parse reference annotation tag (RF).", "expected 'yes' or 'no' after reference annotation tag (RF).");
+    case p7TagMask:
+      return p7ParseYesNo(parser, &cursor, lineEnd, &currentPhmm->header.hasModelMask,
+        "couldn't parse model mask tag (MM).", "expected 'yes' or 'no' after model mask tag (MM).");
+    case p7TagConsensusResidue:
+      return p7ParseYesNo(parser, &cursor, lineEnd, &currentPhmm->header.hasConsensusResidue,
+        "couldn't parse consensus residue tag (CONS).", "expected 'yes' or 'no' after consensus residue tag (CONS).");
+    case p7TagConsensusStructure:
+      return p7ParseYesNo(parser, &cursor, lineEnd, &currentPhmm->header.hasConsensusStructure,
+        "couldn't parse consensus structure tag (CS).", "expected 'yes' or 'no' after consensus structure tag (CS).");
+    case p7TagMap:
+      return p7ParseYesNo(parser, &cursor, lineEnd, &currentPhmm->header.hasMapAnnotation,
+        "couldn't parse map annotation tag (MAP).", "expected 'yes' or 'no' after map annotation tag (MAP).");
+
+    case p7TagDate:
+      if(!p7RemainingText(cursor, lineEnd, &token, &tokenLength)){
+        printFormatError(parser->fileSrc, parser->lineNumber, "couldn't parse date tag (DATE).");
+        return p7HmmFormatError;
+      }
+      currentPhmm->header.date = p7CopySlice(parser, token, tokenLength);
+      if(currentPhmm->header.date == NULL){
+        printAllocationError(parser->fileSrc, parser->lineNumber, "couldn't allocate memory for date buffer.");
+        return p7HmmAllocationFailure;
+      }
+      return p7HmmSuccess;
+
+    case p7TagCommand:{
+      if(parser->skipFields & p7HmmSkipCommandHistory){
+        return p7HmmSuccess;
+      }
+      p7RemainingText(cursor, lineEnd, &token, &tokenLength);
+      size_t currentCmdHistoryLength = currentPhmm->header.commandLineHistory == NULL?
+        0:  strlen(currentPhmm->header.commandLineHistory);
+      //+2 to the new length is for the null terminator and a separating newline
+      size_t expandedCmdHistoryLength = currentCmdHistoryLength + tokenLength + 2;
+      char *expandedCmdHistory;
+      if(parser->phmmList->arena == NULL){
+        expandedCmdHistory = realloc(currentPhmm->header.commandLineHistory, expandedCmdHistoryLength * sizeof(char));
+      }
+      else{
+        //arena memory can't be resized, so the history is copied into a new, larger buffer
+        expandedCmdHistory = p7ParserAllocString(parser, expandedCmdHistoryLength * sizeof(char));
+        if(expandedCmdHistory != NULL && currentCmdHistoryLength != 0){
+          memcpy(expandedCmdHistory, currentPhmm->header.commandLineHistory, currentCmdHistoryLength);
+        }
+      }
+      if(expandedCmdHistory == NULL){
+        printAllocationError(parser->fileSrc, parser->lineNumber, "failed to allocate memory for command line history buffer.");
+        return p7HmmAllocationFailure;
+      }
+      //add a newline separating the current history from the newly added line
+      //if there was already a line in the history
+      if(currentCmdHistoryLength != 0){
+        expandedCmdHistory[currentCmdHistoryLength++] = '\n';
+      }
+      memcpy(expandedCmdHistory + currentCmdHistoryLength, token, tokenLength);
+      expandedCmdHistory[currentCmdHistoryLength + tokenLength] = 0;
+      currentPhmm->header.commandLineHistory = expandedCmdHistory;
+      return p7HmmSuccess;
+    }
+
+    case p7TagNumSequences:
+      if(!p7NextToken(&cursor, lineEnd, &token, &tokenLength)){
+        printFormatError(parser->fileSrc, parser->lineNumber, "couldn't parse sequence number tag (NSEQ).");
+        return p7HmmFormatError;
+      }
+      if(!p7ParseUint32(token, tokenLength, &currentPhmm->header.numSequences)){
+        printFormatError(parser->fileSrc, parser->lineNumber, "expected 1 float value after sequence number tag (NSEQ).");
+        return p7HmmFormatError;
+      }
+      return p7HmmSuccess;
+
+    case p7TagEffectiveNumSequences:
+      if(!p7NextToken(&cursor, lineEnd, &token, &tokenLength)){
+        printFormatError(parser->fileSrc, parser->lineNumber, "couldn't parse effective sequence number tag (EFFN).");
+        return p7HmmFormatError;
+      }
+      if(!p7ParseFloat(token, tokenLength, &currentPhmm->header.effectiveNumSequences)){
+        printFormatError(parser->fileSrc, parser->lineNumber, "expected 1 float value after effective sequence number tag (EFFN).");
+        return p7HmmFormatError;
+      }
+      return p7HmmSuccess;
+
+    case p7TagChecksum:
+      if(!p7NextToken(&cursor, lineEnd, &token, &tokenLength)){
+        printFormatError(parser->fileSrc, parser->lineNumber, "couldn't parse checksum tag (CKSUM).");
+        return p7HmmFormatError;
+      }
+      if(!p7ParseUint32(token, tokenLength, &currentPhmm->header.checksum)){
+        printFormatError(parser->fileSrc, parser->lineNumber, " unsigned 32-bit int value is required after checksum tag.");
+        return p7HmmFormatError;
+      }
+      return p7HmmSuccess;
+
+    case p7TagGathering:
+    case p7TagTrusted:
+    case p7TagNoise:{
+      float *cutoffs = currentPhmm->header.gatheringThresholds;
+      char *missingMessage = "couldn't parse GA tag.";
+      if(firstToken[0] == 'T'){
+        cutoffs = currentPhmm->header.trustedCutoffs;
+        missingMessage = "couldn't parse TC tag.";
+      }
+      else if(firstToken[0] == 'N'){
+        cutoffs = currentPhmm->header.noiseCutoffs;
+        missingMessage = "couldn't parse NC flag.";
+      }
+      if(!p7RemainingText(cursor, lineEnd, &token, &tokenLength)){
+        printFormatError(parser->fileSrc, parser->lineNumber, missingMessage);
+        return p7HmmFormatError;
+      }
+      //set the default values for the cutoffs to NAN, these will be overwritten if the line contained values
+      cutoffs[0] = NAN;
+      cutoffs[1] = NAN;
+      if(p7NextToken(&cursor, lineEnd, &token, &tokenLength) && p7ParseFloat(token, tokenLength, &cutoffs[0])){
+        if(p7NextToken(&cursor, lineEnd, &token, &tokenLength)){
+          p7ParseFloat(token, tokenLength, &cutoffs[1]);
+        }
+      }
+      return p7HmmSuccess;
+    }
+
+    case p7TagBuildCommand:
+    case p7TagSearchCommand:{
+      //Pfam annotation lines, kept verbatim so models can be written back out unchanged
+      char **command = firstToken[0] == 'B'? &currentPhmm->header.buildCommand: &currentPhmm->header.searchCommand;
+      if(!p7RemainingText(cursor, lineEnd, &token, &tokenLength)){
+        printFormatError(parser->fileSrc, parser->lineNumber,
+          firstToken[0] == 'B'? "couldn't parse build method tag (BM).": "couldn't parse search method tag (SM).");
+        return p7HmmFormatError;
+      }
+      if(parser->phmmList->arena == NULL){
+        free(*command);
+      }
+      *command = p7CopySlice(parser, token, tokenLength);
+      if(*command == NULL){
+        printAllocationError(parser->fileSrc, parser->lineNumber, "couldn't allocate buffer for method tag (BM/SM).");
+        return p7HmmAllocationFailure;
+      }
+      return p7HmmSuccess;
+    }
+
+    case p7TagStats:{
+      const char *distributionName;
+      size_t distributionNameLength;
+      float mu; //first value
+      float lambda; //second value
+      bool statsParsed = p7NextToken(&cursor, lineEnd, &token, &tokenLength) && p7TokenEquals(token, tokenLength, "LOCAL") &&
+        p7NextToken(&cursor, lineEnd, &distributionName, &distributionNameLength) &&
+        p7NextToken(&cursor, lineEnd, &token, &tokenLength) && p7ParseFloat(token, tokenLength, &mu) &&
+        p7NextToken(&cursor, lineEnd, &token, &tokenLength) && p7ParseFloat(token, tokenLength, &lambda);
+      if(!statsParsed){
+        printFormatError(parser->fileSrc, parser->lineNumber,
+          "expected distribution name and 2 float values after STATS.");
+        return p7HmmFormatError;
+      }
+      if(p7TokenEquals(distributionName, distributionNameLength, "MSV")){
+        currentPhmm->stats.msvGumbelMu = mu;
+        currentPhmm->stats.msvGumbelLambda = lambda;
+      }
+      else if(p7TokenEquals(distributionName, distributionNameLength, "VITERBI")){
+        currentPhmm->stats.viterbiGumbelMu = mu;
+        currentPhmm->stats.viterbiGumbelLambda = lambda;
+      }
+      else if(p7TokenEquals(distributionName, distributionNameLength, "FORWARD")){
+        currentPhmm->stats.forwardTau = mu;
+        currentPhmm->stats.forwardLambda = lambda;
+      }
+      else{
+        printFormatError(parser->fileSrc, parser->lineNumber,
+          "couldn't parse distribution name. exected distribution name of MSV, VITERBI, or FORWARD.");
+        return p7HmmFormatError;
+      }
+      return p7HmmSuccess;
+    }
+
+    case p7TagModelStart:{
+      //the header is complete, so this is the last point a model can be rejected before its data is allocated
+      if(parser->filter != NULL && !parser->filter(currentPhmm, parser->filterData)){
+        //a rejected model's strings stay in the arena until the whole list is freed
+        if(parser->phmmList->arena == NULL){
+          p7HmmDealloc(currentPhmm);
+        }
+        else{
+          p7HmmInit(currentPhmm);
+        }
+        parser->phmmList->count--;
+        parser->currentPhmm = NULL;
+        parser->numRejectedHmms++;
+        parser->parserState = parsingHmmRejectedBody;
+        return p7HmmSuccess;
+      }
+      //the match lines are still checked against what the header declared, even for annotations that are skipped
+      parser->declaredAnnotations = p7DeclaredAnnotations(&currentPhmm->header);
+      p7ClearSkippedAnnotations(&currentPhmm->header, parser->skipFields);
+      enum P7HmmReturnCode returnCode = p7HmmSuccess;
+      const bool storeInsertEmissions = !(parser->skipFields & p7HmmSkipInsertEmissions);
+      if(!parser->validateOnly){
+        returnCode = p7HmmAllocateModelData(currentPhmm, storeInsertEmissions && !parser->compactInsertEmissions,
+          parser->phmmList->arena);
+        if(returnCode == p7HmmSuccess && storeInsertEmissions && parser->compactInsertEmissions){
+          returnCode = p7AllocateCompactInsertRows(parser, currentPhmm);
+        }
+      }
+      else if(p7HmmGetAlphabetCardinality(currentPhmm) == 0 || currentPhmm->header.modelLength == 0){
+        returnCode = p7HmmFormatError;
+      }
+      if(returnCode == p7HmmFormatError){
+        printFormatError(parser->fileSrc, parser->lineNumber, "model alphabet and/or model length was not set.");
+        return p7HmmFormatError;
+      }
+      else if(returnCode == p7HmmAllocationFailure){
+        printAllocationError(parser->fileSrc, parser->lineNumber, "failed to allocate memory for all buffers for P7 model.");
+        return p7HmmAllocationFailure;
+      }
+      parser->alphabetCardinality = p7HmmGetAlphabetCardinality(currentPhmm);
+      //the next line is the set of labels for the transition characters
+      parser->parserState = parsingHmmTransitionLabels;
+      return p7HmmSuccess;
+    }
+
+    //unrecognized tags (BM, SM, etc.) are ignored
+    default:
+      return p7HmmSuccess;
+  }
+}
+
+static enum P7HmmReturnCode p7ParseInitialTransitionsLine(struct P7HmmParser *parser, const char *line, const char *lineEnd){
+  //there are 7 values on this line, but the last 2 are always 0.0 and *, so only the first 5 are read
+  float transitions[5];
+  uint32_t starMask;
+  const char *cursor = line;
+  const uint32_t numDecoded = p7DecodeScoreRow(&cursor, line, lineEnd, transitions, 5, &starMask);
+  if(numDecoded != 5 || starMask != 0){
+    char errorMessageBuffer[256];
+    sprintf(errorMessageBuffer,
+      "expected 5 values from initial transitions line, but only got %u (there should be 7, but the last 2 are always 0.0 and *).",
+      starMask != 0? (uint32_t)__builtin_ctz(starMask): numDecoded);
+    printFormatError(parser->fileSrc, parser->lineNumber, errorMessageBuffer);
+    return p7HmmFormatError;
+  }
+  struct P7InitialTransitions *initialTransitions = &parser->currentPhmm->model.initialTransitions;
+  initialTransitions->beginToM1        = transitions[0];
+  initialTransitions->beginToInsert0   = transitions[1];
+  initialTransitions->beginToDelete1   = transitions[2];
+  initialTransitions->insert0ToMatch1  = transitions[3];
+  initialTransitions->insert0ToInsert0 = transitions[4];
+  parser->parserState = parsingHmmModelBody;
+  return p7HmmSuccess;
+}
+
+//reads one of the optional annotation characters that follow the match emissions.
+static enum P7HmmReturnCode p7NextAnnotationToken(struct P7HmmParser *parser, const char **cursor, const char *lineEnd,
+  const char **token, size_t *tokenLength, char *annotationName){
+  if(!p7NextToken(cursor, lineEnd, token, tokenLength)){
+    char errorMessageBuffer[256];
+    sprintf(errorMessageBuffer, "Error: could not tokenize %s value", annotationName);
+    printFormatError(parser->fileSrc, parser->lineNumber, errorMessageBuffer);
+    return p7HmmFormatError;
+  }
+  return p7HmmSuccess;
+}
+
+static enum P7HmmReturnCode p7ParseMatchEmissionsLine(struct P7HmmParser *parser, const char *line,
+  const char *firstToken, const size_t firstTokenLength, const char *cursor, const char *lineEnd){
+  struct P7Hmm *currentPhmm = parser->currentPhmm;
+  const uint32_t alphabetCardinality = parser->alphabetCardinality;
+
+  //parse the node index
+  uint32_t nodeIndex = 0;
+  if(!p7ParseUint32(firstToken, firstTokenLength, &nodeIndex)){
+    printFormatError(parser->fileSrc, parser->lineNumber,
+      "Error: could not parse node index from match emissions line.");
+    return p7HmmFormatError;
+  }
+  //check to make sure that the node index agrees with what we'd expect
+  if(nodeIndex != parser->expectedNodeIndex){
+    char errorMessageBuffer[256];
+    sprintf(errorMessageBuffer,
+      "expected node index value of %u, but received node index value %u.",
+      parser->expectedNodeIndex, nodeIndex);
+    printFormatError(parser->fileSrc, parser->lineNumber, errorMessageBuffer);
+    return p7HmmFormatError;
+  }
+  if(nodeIndex > currentPhmm->header.modelLength){
+    char errorMessageBuffer[256];
+    sprintf(errorMessageBuffer,
+      "node index %u is greater than the model length (LENG) of %u.",
+      nodeIndex, currentPhmm->header.modelLength);
+    printFormatError(parser->fileSrc, parser->lineNumber, errorMessageBuffer);
+    return p7HmmFormatError;
+  }
+  parser->expectedNodeIndex++;
+  parser->nodeIndex = nodeIndex;
+
+  float *matchEmissions = parser->validateOnly? parser->scratchRow:
+    &currentPhmm->model.matchEmissionScores[(nodeIndex - 1) * alphabetCardinality];
+  enum P7HmmReturnCode returnCode = p7ParseFloatRow(parser, &cursor, line, lineEnd, matchEmissions,
+    alphabetCardinality, "match emissions");
+  if(returnCode != p7HmmSuccess){
+    return returnCode;
+  }
+
+  //with every annotation skipped, there's nothing on the rest of the line to store
+  if((parser->skipFields & p7HmmSkipAnnotations) == p7HmmSkipAnnotations){
+    parser->parserState = parsingHmmInsertEmissions;
+    return p7HmmSuccess;
+  }
+  const uint32_t declaredAnnotations = parser->declaredAnnotations;
+
+  //tokenize the optional character data
+  //read map annotation value
+  const char *token;
+  size_t tokenLength;
+  if(p7NextAnnotationToken(parser, &cursor, lineEnd, &token, &tokenLength, "map annotation") != p7HmmSuccess){
+    return p7HmmFormatError;
+  }
+  //check to see if the map annotation value's existance agrees with what we'd expect from hasMapAnnotation
+  if(token[0] != '-' && !(declaredAnnotations & p7HmmSkipMapAnnotations)){
+    printFormatError(parser->fileSrc, parser->lineNumber,
+      "Error: header declared the file does not have map annotations, but integer value given on match line.");
+    return p7HmmFormatError;
+  }
+  else if(declaredAnnotations & p7HmmSkipMapAnnotations){
+    uint32_t mapAnnotation;
+    if(!p7ParseUint32(token, tokenLength, &mapAnnotation)){
+      printFormatError(parser->fileSrc, parser->lineNumber,
+        "Error: could not parse integer value for map annotation value.");
+      return p7HmmFormatError;
+    }
+    if(currentPhmm->model.mapAnnotations != NULL){
+      currentPhmm->model.mapAnnotations[nodeIndex - 1] = mapAnnotation;
+    }
+  }
+
+  //read consensus residue value
+  if(p7NextAnnotationToken(parser, &cursor, lineEnd, &token, &tokenLength, "consensus residue") != p7HmmSuccess){
+    return p7HmmFormatError;
+  }
+  if(token[0] != '-' && !(declaredAnnotations & p7HmmSkipConsensusResidues)){
+    printFormatError(parser->fileSrc, parser->lineNumber,
+      "Warning: header declared the file does not have consensus residues, but character residue value was given on match line.");
+  }
+  else if(token[0] != '-' && currentPhmm->model.consensusResidues != NULL){
+    currentPhmm->model.consensusResidues[nodeIndex - 1] = token[0];
+  }
+
+  //read reference annotation value
+  if(p7NextAnnotationToken(parser, &cursor, lineEnd, &token, &tokenLength, "reference annotation") != p7HmmSuccess){
+    return p7HmmFormatError;
+  }
+  if(token[0] != '-' && !(declaredAnnotations & p7HmmSkipReferenceAnnotation)){
+    printFormatError(parser->fileSrc, parser->lineNumber,
+      "Error: header declared the file does not have reference annotation, but character residue value was given on match line.");
+    return p7HmmFormatError;
+  }
+  else if(token[0] != '-' && currentPhmm->model.referenceAnnotation != NULL){
+    currentPhmm->model.referenceAnnotation[nodeIndex - 1] = token[0];
+  }
+
+  //read model mask value
+  if(p7NextAnnotationToken(parser, &cursor, lineEnd, &token, &tokenLength, "model mask") != p7HmmSuccess){
+    return p7HmmFormatError;
+  }
+  if(token[0] != '-' && !(declaredAnnotations & p7HmmSkipModelMask)){
+    printFormatError(parser->fileSrc, parser->lineNumber,
+      "Error: header declared the file does not have a model mask, but mask value was given on match line.");
+    return p7HmmFormatError;
+  }
+  else if(token[0] != '-' && currentPhmm->model.modelMask != NULL){
+    currentPhmm->model.modelMask[nodeIndex - 1] = token[0] == 'm';
+  }
+
+  //read consensus structure value
+  if(p7NextAnnotationToken(parser, &cursor, lineEnd, &token, &tokenLength, "consensus structure") != p7HmmSuccess){
+    return p7HmmFormatError;
+  }
+  if(token[0] != '-' && !(declaredAnnotations & p7HmmSkipConsensusStructure)){
+    printFormatError(parser->fileSrc, parser->lineNumber,
+      "Error: header declared the file does not have consensus structure, but structure value was given on match line.");
+    return p7HmmFormatError;
+  }
+  else if(currentPhmm->model.consensusStructure != NULL){
+    currentPhmm->model.consensusStructure[nodeIndex - 1] = token[0];
+  }
+
+  parser->parserState = parsingHmmInsertEmissions;
+  return p7HmmSuccess;
+}
+
+static enum P7HmmReturnCode p7ParseStateTransitionsLine(struct P7HmmParser *parser, const char *line, const char *lineEnd){
+  static const char *const transitionErrorMessages[7] = {
+    "failed to parse match to match state transition score (1st value on state transition line).",
+    "failed to parse match to insert state transition score (2nd value on state transition line).",
+    "failed to parse match to delete state transition score(3rd value on state transition line).",
+    "failed to parse insert to match state transition score (4th value on state transition line).",
+    "failed to parse insert to insert state transition score (5th value on state transition line).",
+    "failed to parse delete to match state transition score (6th value on state transition line).",
+    "failed to parse delete to delete state transition score (7th value on state transition line)."};
+  //bits of the match to delete and delete to delete transitions, the only ones that may be '*' (on the last node)
+  const uint32_t transitionsToDeleteMask = (1 << 2) | (1 << 6);
+  const bool isLastNode = parser->nodeIndex == parser->currentPhmm->header.modelLength;
+
+  float transitions[7];
+  uint32_t starMask;
+  const char *cursor = line;
+  const uint32_t numDecoded = p7DecodeScoreRow(&cursor, line, lineEnd, transitions, 7, &starMask);
+  const uint32_t disallowedStarMask = isLastNode? starMask & ~transitionsToDeleteMask: starMask;
+  if(numDecoded != 7 || disallowedStarMask != 0){
+    const uint32_t failedIndex = disallowedStarMask != 0? (uint32_t)__builtin_ctz(disallowedStarMask): numDecoded;
+    printFormatError(parser->fileSrc, parser->lineNumber, (char*)transitionErrorMessages[failedIndex]);
+    return p7HmmFormatError;
+  }
+  if(isLastNode){
+    //this is the last node, so these will always be '*', for infinity. since -log(INF) is undefined, we set to NAN
+    transitions[2] = NAN;
+    transitions[6] = NAN;
+  }
+
+  parser->parserState = parsingHmmModelBody;
+  if(parser->validateOnly){
+    return p7HmmSuccess;
+  }
+  struct P7StateTransitions *stateTransitions = &parser->currentPhmm->model.stateTransitions;
+  const uint32_t nodePosition = parser->nodeIndex - 1;
+  stateTransitions->matchToMatch[nodePosition]   = transitions[0];
+  stateTransitions->matchToInsert[nodePosition]  = transitions[1];
+  stateTransitions->matchToDelete[nodePosition]  = transitions[2];
+  stateTransitions->insertToMatch[nodePosition]  = transitions[3];
+  stateTransitions->insertToInsert[nodePosition] = transitions[4];
+  stateTransitions->deleteToMatch[nodePosition]  = transitions[5];
+  stateTransitions->deleteToDelete[nodePosition] = transitions[6];
+  return p7HmmSuccess;
+}
+
+
+void p7HmmParserInit(struct P7HmmParser *parser, const char *const fileSrc, struct P7HmmList *phmmList){
+  parser->fileSrc = fileSrc;
+  parser->phmmList = phmmList;
+  parser->currentPhmm = NULL;
+  parser->parserState = parsingHmmIdle;
+  parser->alphabetCardinality = 0;
+  parser->expectedNodeIndex = 1;
+  parser->nodeIndex = 0;
+  parser->lineNumber = 0;
+  parser->completedParsingHmm = false;
+  parser->filter = NULL;
+  parser->filterData = NULL;
+  parser->numRejectedHmms = 0;
+  parser->skipFields = p7HmmSkipNothing;
+  parser->declaredAnnotations = 0;
+  parser->validateOnly = false;
+  parser->precision = p7HmmPrecisionFloat;
+  parser->compactInsertEmissions = false;
+  parser->uniqueInsertRowCapacity = 0;
+}
+
+void p7HmmParserResumeModel(struct P7HmmParser *parser, const char *const fileSrc, struct P7HmmList *phmmList,
+  struct P7Hmm *phmm, const size_t lineNumber){
+  p7HmmParserInit(parser, fileSrc, phmmList);
+  parser->currentPhmm = phmm;
+  parser->parserState = parsingHmmHeader;
+  parser->lineNumber = lineNumber;
+}
+
+enum P7HmmReturnCode p7HmmParserConsumeLine(struct P7HmmParser *parser, const char *line, size_t lineLength){
+  parser->lineNumber++;
+  const char *const lineEnd = line + lineLength;
+  if(parser->parserState == parsingHmmRejectedBody){
+    //the body of a rejected model is only checked for the '//' terminator, without tokenizing or storing anything
+    while(line < lineEnd && p7IsBlank(*line)){
+      line++;
+    }
+    if(lineEnd - line >= 2 && line[0] == '/' && line[1] == '/'){
+      parser->parserState = parsingHmmIdle;
+    }
+    return p7HmmSuccess;
+  }
+  const char *cursor = line;
+  const char *firstToken;
+  size_t firstTokenLength;
+  const bool lineHasToken = p7NextToken(&cursor, lineEnd, &firstToken, &firstTokenLength);
+
+  switch(parser->parserState){
+    case parsingHmmIdle:
+      //when looking for the format tag, only check to see if it starts with 'HMMER3'.
+      //if we're idle and we encounter a line that doesn't start with a "HMMER3" version tag, skip the line until we do.
+      if(lineHasToken && firstTokenLength >= strlen(P7_HEADER_FORMAT_FLAG) &&
+        memcmp(firstToken, P7_HEADER_FORMAT_FLAG, strlen(P7_HEADER_FORMAT_FLAG)) == 0){
+        return p7ParseFormatLine(parser, firstToken, lineEnd);
+      }
+      return p7HmmSuccess;
+
+    case parsingHmmHeader:
+      if(!lineHasToken){
+        //if there's no token, this line only contained whitespace, so we should skip this line
+        return p7HmmSuccess;
+      }
+      return p7ParseHeaderLine(parser, firstToken, firstTokenLength, cursor, lineEnd);
+
+    case parsingHmmTransitionLabels:
+      //this line only contains the labels for the transition characters, so it can be skipped
+      parser->parserState = parsingHmmModelHead;
+      return p7HmmSuccess;
+
+    case parsingHmmModelHead:
+      if(!lineHasToken){
+        return p7HmmSuccess;
+      }
+      if(p7TokenEquals(firstToken, firstTokenLength, P7_BODY_COMPO_FLAG)){
+        if(parser->validateOnly){
+          parser->parserState = parsingHmmInsert0Emissions;
+          return p7ParseFloatRow(parser, &cursor, line, lineEnd, parser->scratchRow, parser->alphabetCardinality, "compo");
+        }
+        if(parser->skipFields & p7HmmSkipCompo){
+          parser->parserState = parsingHmmInsert0Emissions;
+          return p7HmmSuccess;
+        }
+        p7HmmAttachCompo(parser->currentPhmm);
+        parser->parserState = parsingHmmInsert0Emissions;
+        return p7ParseFloatRow(parser, &cursor, line, lineEnd, parser->currentPhmm->model.compo,
+          parser->alphabetCardinality, "compo");
+      }
+      //the COMPO line is optional, so without it this line holds the insert0 emissions.
+      cursor = line;
+      //fall through
+    case parsingHmmInsert0Emissions:
+      if(!lineHasToken){
+        printFormatError(parser->fileSrc, parser->lineNumber,
+          "unexpectedly encountered end of file or blank line after hmm tag.");
+        return p7HmmFormatError;
+      }
+      parser->parserState = parsingHmmInitialTransitions;
+      cursor = line;
+      return p7ParseFloatRow(parser, &cursor, line, lineEnd,
+        parser->validateOnly? parser->scratchRow: parser->currentPhmm->model.insert0Emissions,
+        parser->alphabetCardinality, "insert0 emissions");
+
+    case parsingHmmInitialTransitions:
+      if(!lineHasToken){
+        printFormatError(parser->fileSrc, parser->lineNumber,
+          "unexpectedly encountered end of file or blank line when expecting initial transitions.");
+        return p7HmmFormatError;
+      }
+      return p7ParseInitialTransitionsLine(parser, line, lineEnd);
+
+    case parsingHmmModelBody:
+      if(!lineHasToken){
+        return p7HmmSuccess;
+      }
+      if(p7TokenEquals(firstToken, firstTokenLength, P7_BODY_END_FLAG)){
+        //we've encountered an ending profile hmm body tag, so set the parser state and restart
+        parser->completedParsingHmm = true;
+        parser->parserState = parsingHmmIdle;
+        if(!parser->validateOnly){
+          p7ShrinkCompactInsertRows(parser);
+        }
+        if(parser->precision != p7HmmPrecisionFloat && !parser->validateOnly &&
+          p7HmmQuantizeModel(parser->currentPhmm, parser->precision) != p7HmmSuccess){
+          printAllocationError(parser->fileSrc, parser->lineNumber, "failed to allocate memory for the quantized model data.");
+          return p7HmmAllocationFailure;
+        }
+        return p7HmmSuccess;
+      }
+      return p7ParseMatchEmissionsLine(parser, line, firstToken, firstTokenLength, cursor, lineEnd);
+
+    case parsingHmmInsertEmissions:
+      if(!lineHasToken){
+        printFormatError(parser->fileSrc, parser->lineNumber,
+          "Error: could not tokenize insert emission value.");
+        return p7HmmFormatError;
+      }
+      parser->parserState = parsingHmmStateTransitions;
+      cursor = line;
+      if(parser->validateOnly){
+        return p7ParseFloatRow(parser, &cursor, line, lineEnd, parser->scratchRow,
+          parser->alphabetCardinality, "insert emissions");
+      }
+      if(parser->currentPhmm->model.insertRowIndices != NULL){
+        return p7ParseCompactInsertEmissions(parser, &cursor, line, lineEnd);
+      }
+      if(parser->currentPhmm->model.insertEmissionScores == NULL){
+        //insert emissions are skipped, so the line is left undecoded
+        return p7HmmSuccess;
+      }
+      return p7ParseFloatRow(parser, &cursor, line, lineEnd,
+        &parser->currentPhmm->model.insertEmissionScores[(parser->nodeIndex - 1) * parser->alphabetCardinality],
+        parser->alphabetCardinality, "insert emissions");
+
+    case parsingHmmStateTransitions:
+      return p7ParseStateTransitionsLine(parser, line, lineEnd);
+
+    case parsingHmmRejectedBody:
+      //handled before tokenizing the line
+      return p7HmmSuccess;
+  }
+
+  return p7HmmSuccess;  //fallthrough condition, should not happen in practice.
+}
+
+enum P7HmmReturnCode p7HmmParserConsumeBuffer(struct P7HmmParser *parser, const char *buffer, size_t bufferLength){
+  const char *lineStart = buffer;
+  const char *const bufferEnd = buffer + bufferLength;
+  while(lineStart < bufferEnd){
+    const char *newline = memchr(lineStart, '\n', bufferEnd - lineStart);
+    const char *lineEnd = newline == NULL? bufferEnd: newline;
+    enum P7HmmReturnCode returnCode = p7HmmParserConsumeLine(parser, lineStart, lineEnd - lineStart);
+    if(returnCode != p7HmmSuccess){
+      return returnCode;
+    }
+    lineStart = lineEnd + 1;
+  }
+  return p7HmmSuccess;
+}
+
+enum P7HmmReturnCode p7HmmParserFinish(struct P7HmmParser *parser){
+  //a file whose models were all rejected by the filter is still a valid file
+  if(parser->parserState == parsingHmmIdle && (parser->completedParsingHmm || parser->numRejectedHmms != 0)){
+    return p7HmmSuccess;
+  }
+  else if(parser->parserState == parsingHmmIdle && parser->currentPhmm == NULL){
+    printFormatError(parser->fileSrc, parser->lineNumber,
+      "reached the end of the file without finding a profile hmm (expected a 'HMMER3' format tag).");
+    return p7HmmFormatError;
+  }
+  else{
+    printFormatError(parser->fileSrc, parser->lineNumber,
+      "file ended unexpectedly when still parsing an Hmm. Is the file missing an expected model termination flag ('//')?");
+    return p7HmmFormatError;
+  }
+}
@@ -0,0 +1,133 @@
+#ifndef P7_HMM_READER_PARSER_H
+#define P7_HMM_READER_PARSER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "p7HmmReader.h"
+
+
+//the largest alphabet (amino), which sizes the parser's scratch row
+#define P7_HMM_PARSER_MAX_ALPHABET_CARDINALITY 20
+
+
+enum P7HmmParserState{
+  parsingHmmIdle, parsingHmmHeader, parsingHmmTransitionLabels, parsingHmmModelHead,
+  parsingHmmInsert0Emissions, parsingHmmInitialTransitions, parsingHmmModelBody,
+  parsingHmmInsertEmissions, parsingHmmStateTransitions, parsingHmmRejectedBody
+};
+
+struct P7HmmParser{
+  const char *fileSrc;          //only used to label error messages
+  struct P7HmmList *phmmList;
+  struct P7Hmm *currentPhmm;
+  enum P7HmmParserState parserState;
+  uint32_t alphabetCardinality;
+  uint32_t expectedNodeIndex;   //for counting which node number we're in when we get to the model body
+  uint32_t nodeIndex;           //node whose insert emission and transition lines are still expected
+  size_t lineNumber;            //for printing errors
+  bool completedParsingHmm;     //used to determine if we're valid when we hit EOF
+  P7HmmFilter filter;           //optional, decides whether to keep each model once its header is parsed
+  void *filterData;
+  uint32_t numRejectedHmms;
+  uint32_t skipFields;          //P7HmmSkipField bits for the fields to leave out of every model
+  uint32_t declaredAnnotations; //P7HmmSkipField bits of the annotations the current model's header declared
+  bool validateOnly;            //if set, every line is checked, but no model data is allocated or stored
+  enum P7HmmScorePrecision precision; //format each model's scores are converted to once the model is parsed
+  bool compactInsertEmissions;  //if set, each distinct insert emission row of a model is only stored once
+  uint32_t uniqueInsertRowCapacity; //rows allocated for the current model's uniqueInsertEmissions
+  float scratchRow[P7_HMM_PARSER_MAX_ALPHABET_CARDINALITY];  //destination for rows that are checked but not stored
+};
+
+
+/*
+ * Function:  p7HmmParserInit
+ * --------------------
+ * Initializes the parser to begin reading a new hmm file. No memory is allocated
+ *  by this function, models are appended to the given phmmList as their
+ *  format tags are encountered. To only keep some of the models, set the parser's
+ *  filter and filterData after initializing it, and to leave fields out of the models,
+ *  set its skipFields. Setting validateOnly keeps only the headers, while still checking
+ *  every line of the model bodies, setting precision stores each model's scores at
+ *  reduced precision, and setting compactInsertEmissions stores each distinct insert emission row once.
+ *
+ *  Inputs:
+ *    parser: pointer to the parser struct to initialize.
+ *    fileSrc: name of the source being parsed, used only for error messages.
+ *    phmmList: initialized list that parsed models will be appended to.
+ */
+void p7HmmParserInit(struct P7HmmParser *parser, const char *const fileSrc, struct P7HmmList *phmmList);
+
+/*
+ * Function:  p7HmmParserResumeModel
+ * --------------------
+ * Initializes the parser to parse the body of a model whose header was already parsed,
+ *  e.g., by a header-only scan. The next line given to the parser should be the model's
+ *  'HMM' line, and the model data is allocated and filled into phmm instead of a new model
+ *  being appended to the list.
+ *
+ *  Inputs:
+ *    parser: pointer to the parser struct to initialize.
+ *    fileSrc: name of the source being parsed, used only for error messages.
+ *    phmmList: list that holds phmm.
+ *    phmm: model whose header has been parsed, and whose model data is unallocated.
+ *    lineNumber: number of lines in the source before the 'HMM' line, for labeling errors.
+ */
+void p7HmmParserResumeModel(struct P7HmmParser *parser, const char *const fileSrc, struct P7HmmList *phmmList,
+  struct P7Hmm *phmm, const size_t lineNumber);
+
+/*
+ * Function:  p7HmmParserConsumeLine
+ * --------------------
+ * Parses a single line of a profile hmm file. The line is given as a pointer/length
+ *  slice into the caller's buffer, and is never copied or modified by the parser, so
+ *  the line does not need to be null terminated. The slice should not include the
+ *  trailing newline character.
+ *
+ *  Inputs:
+ *    parser: pointer to the parser state.
+ *    line: pointer to the first character of the line.
+ *    lineLength: number of characters in the line, excluding the newline.
+ *
+ *  Returns:
+ *    p7HmmSuccess if the line was parsed successfully,
+ *    p7HmmFormatError if the line did not meet the format specification,
+ *    p7HmmAllocationFailure if memory for the model could not be allocated.
+ *    On failure, an error message is printed to stderr. Cleaning up the list is left to the caller.
+ */
+enum P7HmmReturnCode p7HmmParserConsumeLine(struct P7HmmParser *parser, const char *line, size_t lineLength);
+
+/*
+ * Function:  p7HmmParserConsumeBuffer
+ * --------------------
+ * Parses every line in the given buffer, handing the parser slices that point
+ *  directly into the buffer. The final line does not need to end in a newline.
+ *
+ *  Inputs:
+ *    parser: pointer to the parser state.
+ *    buffer: pointer to the text to parse. Does not need to be null terminated.
+ *    bufferLength: number of characters in the buffer.
+ *
+ *  Returns:
+ *    p7HmmSuccess if every line was parsed successfully, otherwise the return code
+ *      of the first line that failed to parse.
+ */
+enum P7HmmReturnCode p7HmmParserConsumeBuffer(struct P7HmmParser *parser, const char *buffer, size_t bufferLength);
+
+/*
+ * Function:  p7HmmParserFinish
+ * --------------------
+ * Checks that the parser is in a valid state to stop reading, i.e., that the last
+ *  model was terminated with a '//' line.
+ *
+ *  Inputs:
+ *    parser: pointer to the parser state.
+ *
+ *  Returns:
+ *    p7HmmSuccess if the file ended after a complete model,
+ *    p7HmmFormatError if the file ended before any model was completed, or while
+ *      still parsing a model.
+ */
+enum P7HmmReturnCode p7HmmParserFinish(struct P7HmmParser *parser);
+
+#endif
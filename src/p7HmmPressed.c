@@ -0,0 +1,366 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "p7HmmReader.h"
+#include "p7HmmFileMap.h"
+#include "p7BinaryCursor.h"
+#include "p7ProfileHmm.h"
+#include "p7HmmReaderLog.h"
+
+
+//magic number at the start of every model in a HMMER3/f pressed file ("hmm:" with the high bits set).
+#define P7_PRESSED_V3F_MAGIC      0xe8ededbau
+#define P7_PRESSED_VERSION        "HMMER3/f"
+#define P7_PRESSED_NUM_TRANSITIONS  7
+#define P7_PRESSED_NUM_EVPARAMS     6
+#define P7_PRESSED_NUM_CUTOFFS      6
+//HMMER always writes a full protein sized composition, regardless of the alphabet.
+#define P7_PRESSED_MAX_ALPHABET     20
+
+//HMMER's P7_HMM flags, for the fields present in a pressed model
+#define P7_PRESSED_FLAG_DESC      (1u << 1)
+#define P7_PRESSED_FLAG_RF        (1u << 2)
+#define P7_PRESSED_FLAG_CS        (1u << 3)
+#define P7_PRESSED_FLAG_STATS     (1u << 7)
+#define P7_PRESSED_FLAG_MAP       (1u << 8)
+#define P7_PRESSED_FLAG_ACC       (1u << 9)
+#define P7_PRESSED_FLAG_GA        (1u << 10)
+#define P7_PRESSED_FLAG_TC        (1u << 11)
+#define P7_PRESSED_FLAG_NC        (1u << 12)
+#define P7_PRESSED_FLAG_CA        (1u << 13)
+#define P7_PRESSED_FLAG_COMPO     (1u << 14)
+#define P7_PRESSED_FLAG_CHKSUM    (1u << 15)
+#define P7_PRESSED_FLAG_CONS      (1u << 16)
+#define P7_PRESSED_FLAG_MMASK     (1u << 17)
+
+//easel alphabet type codes
+#define P7_ESL_RNA    1
+#define P7_ESL_DNA    2
+#define P7_ESL_AMINO  3
+#define P7_ESL_COINS  4
+#define P7_ESL_DICE   5
+
+
+/*
+ * The text format stores values that HMMER printed with a fixed number of decimals, so to produce
+ *  exactly the same floats as readP7Hmm, values from the pressed file are rounded the same way printf
+ *  would, and then converted the way the text parser converts the printed digits. A float times 10^6
+ *  fits in a double's mantissa, so the scaled value (and its rounding) is exact.
+ */
+static float p7RoundToDecimals(const float value, const uint32_t numDecimals){
+  static const double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6};
+  const double roundedValue = nearbyint((double)value * powersOfTen[numDecimals]);
+  if(fabs(roundedValue) <= (double)(1 << 24)){
+    //both operands are exact floats, so the division is correctly rounded, just like strtof
+    return (float)roundedValue / (float)powersOfTen[numDecimals];
+  }
+  char printedValue[64];
+  snprintf(printedValue, sizeof(printedValue), "%.*f", (int)numDecimals, value);
+  return strtof(printedValue, NULL);
+}
+
+//converts a probability to the score HMMER would print in a text file, -ln(p) with 5 decimals.
+static float p7ProbabilityToScore(const float probability){
+  if(probability == 1.0f){
+    return 0.0f;
+  }
+  if(probability == 0.0f){
+    return INFINITY;
+  }
+  return p7RoundToDecimals(-logf(probability), 5);
+}
+
+static void p7ProbabilitiesToScores(const float *probabilities, float *scores, const size_t numProbabilities){
+  for(size_t i = 0; i < numProbabilities; i++){
+    scores[i] = p7ProbabilityToScore(probabilities[i]);
+  }
+}
+
+//reads one of easel's binary strings, an int length that counts the null terminator, then the characters and the terminator.
+//HMMER writes absent optional strings with length 0, which are read as NULL, as readP7Hmm leaves them.
+static bool p7PressedReadString(struct P7BinaryCursor *cursor, char **string){
+  int32_t storedLength;
+  if(!p7BinaryReadWords(cursor, &storedLength, 1) || storedLength < 0 || (size_t)storedLength > p7BinaryRemaining(cursor)){
+    return false;
+  }
+  if(storedLength == 0){
+    *string = NULL;
+    return true;
+  }
+  //the stored terminator is replaced with our own, rather than trusted
+  const size_t stringLength = storedLength - 1;
+  *string = malloc(stringLength + 1);
+  if(*string == NULL){
+    return false;
+  }
+  memcpy(*string, cursor->position, stringLength);
+  (*string)[stringLength] = 0;
+  cursor->position += storedLength;
+  return true;
+}
+
+//reads an M+2 character annotation line. Index 0 and M+1 are padding, so nodes 1..M are copied to the 0 based array.
+static bool p7PressedReadAnnotation(struct P7BinaryCursor *cursor, char *annotation, const uint32_t modelLength){
+  if(p7BinaryRemaining(cursor) < (size_t)modelLength + 2){
+    return false;
+  }
+  if(annotation != NULL){
+    memcpy(annotation, cursor->position + 1, modelLength);
+  }
+  cursor->position += (size_t)modelLength + 2;
+  return true;
+}
+
+//rebuilds the text parser's view of the command history, where each line keeps its "[n] " prefix from the COM tag.
+static bool p7PressedFormatCommandLog(const char *commandLog, char **commandLineHistory){
+  *commandLineHistory = NULL;
+  if(commandLog == NULL || commandLog[0] == 0){
+    return true;
+  }
+  size_t numLines = 1;
+  for(const char *c = commandLog; *c != 0; c++){
+    numLines += *c == '\n';
+  }
+  //each line gains at most "[n] " with a 20 digit n
+  char *history = malloc(strlen(commandLog) + numLines * 24 + 1);
+  if(history == NULL){
+    return false;
+  }
+  size_t historyLength = 0;
+  uint32_t lineNumber = 1;
+  const char *lineStart = commandLog;
+  while(lineStart != NULL && *lineStart != 0){
+    const char *lineEnd = strchr(lineStart, '\n');
+    const size_t lineLength = lineEnd == NULL? strlen(lineStart): (size_t)(lineEnd - lineStart);
+    if(lineNumber != 1){
+      history[historyLength++] = '\n';
+    }
+    historyLength += sprintf(history + historyLength, "[%u] ", lineNumber++);
+    memcpy(history + historyLength, lineStart, lineLength);
+    historyLength += lineLength;
+    lineStart = lineEnd == NULL? NULL: lineEnd + 1;
+  }
+  history[historyLength] = 0;
+  *commandLineHistory = history;
+  return true;
+}
+
+static enum P7HmmReturnCode p7PressedReadHmm(struct P7BinaryCursor *cursor, struct P7Hmm *phmm){
+  struct P7Header *header = &phmm->header;
+  struct P7Model *model = &phmm->model;
+
+  uint32_t fixedWords[3];
+  if(!p7BinaryReadWords(cursor, fixedWords, 3)){
+    return p7HmmFormatError;
+  }
+  const uint32_t flags = fixedWords[0];
+  const uint32_t modelLength = fixedWords[1];
+  switch(fixedWords[2]){
+    case P7_ESL_RNA:    header->alphabet = P7HmmReaderAlphabetRna;    break;
+    case P7_ESL_DNA:    header->alphabet = P7HmmReaderAlphabetDna;    break;
+    case P7_ESL_AMINO:  header->alphabet = P7HmmReaderAlphabetAmino;  break;
+    case P7_ESL_COINS:  header->alphabet = P7HmmReaderAlphabetCoins;  break;
+    case P7_ESL_DICE:   header->alphabet = P7HmmReaderAlphabetDice;   break;
+    default: return p7HmmFormatError;
+  }
+  header->modelLength = modelLength;
+  header->hasReferenceAnnotation = flags & P7_PRESSED_FLAG_RF;
+  header->hasModelMask = flags & P7_PRESSED_FLAG_MMASK;
+  header->hasConsensusResidue = flags & P7_PRESSED_FLAG_CONS;
+  header->hasConsensusStructure = flags & P7_PRESSED_FLAG_CS;
+  header->hasMapAnnotation = flags & P7_PRESSED_FLAG_MAP;
+  const uint32_t alphabetCardinality = p7HmmGetAlphabetCardinality(phmm);
+
+  //the probability arrays: match emissions for nodes 1..M, insert emissions and 7 transitions for nodes 0..M
+  const size_t numProbabilities = (size_t)alphabetCardinality * modelLength +
+    ((size_t)alphabetCardinality + P7_PRESSED_NUM_TRANSITIONS) * ((size_t)modelLength + 1);
+  if(modelLength == 0 || numProbabilities > p7BinaryRemaining(cursor) / sizeof(float)){
+    return p7HmmFormatError;
+  }
+  enum P7HmmReturnCode returnCode = p7HmmAllocateModelData(phmm, true, NULL);
+  if(returnCode != p7HmmSuccess){
+    return returnCode;
+  }
+  float *probabilities = malloc(numProbabilities * sizeof(float));
+  if(probabilities == NULL){
+    return p7HmmAllocationFailure;
+  }
+  p7BinaryReadWords(cursor, probabilities, numProbabilities);
+  const float *matchProbabilities = probabilities;
+  const float *insertProbabilities = matchProbabilities + (size_t)alphabetCardinality * modelLength;
+  const float *transitionProbabilities = insertProbabilities + (size_t)alphabetCardinality * (modelLength + 1);
+
+  p7ProbabilitiesToScores(matchProbabilities, model->matchEmissionScores, (size_t)alphabetCardinality * modelLength);
+  p7ProbabilitiesToScores(insertProbabilities, model->insert0Emissions, alphabetCardinality);
+  p7ProbabilitiesToScores(insertProbabilities + alphabetCardinality, model->insertEmissionScores,
+    (size_t)alphabetCardinality * modelLength);
+  model->initialTransitions.beginToM1 = p7ProbabilityToScore(transitionProbabilities[0]);
+  model->initialTransitions.beginToInsert0 = p7ProbabilityToScore(transitionProbabilities[1]);
+  model->initialTransitions.beginToDelete1 = p7ProbabilityToScore(transitionProbabilities[2]);
+  model->initialTransitions.insert0ToMatch1 = p7ProbabilityToScore(transitionProbabilities[3]);
+  model->initialTransitions.insert0ToInsert0 = p7ProbabilityToScore(transitionProbabilities[4]);
+  float *const transitions[P7_PRESSED_NUM_TRANSITIONS] = {model->stateTransitions.matchToMatch,
+    model->stateTransitions.matchToInsert, model->stateTransitions.matchToDelete, model->stateTransitions.insertToMatch,
+    model->stateTransitions.insertToInsert, model->stateTransitions.deleteToMatch, model->stateTransitions.deleteToDelete};
+  for(uint32_t nodeIndex = 0; nodeIndex < modelLength; nodeIndex++){
+    const float *nodeTransitions = transitionProbabilities + (size_t)(nodeIndex + 1) * P7_PRESSED_NUM_TRANSITIONS;
+    for(uint32_t i = 0; i < P7_PRESSED_NUM_TRANSITIONS; i++){
+      transitions[i][nodeIndex] = p7ProbabilityToScore(nodeTransitions[i]);
+    }
+  }
+  //the text format writes the impossible transitions out of the last node as '*', which readP7Hmm stores as NAN
+  if(model->stateTransitions.matchToDelete[modelLength - 1] == INFINITY){
+    model->stateTransitions.matchToDelete[modelLength - 1] = NAN;
+  }
+  if(model->stateTransitions.deleteToDelete[modelLength - 1] == INFINITY){
+    model->stateTransitions.deleteToDelete[modelLength - 1] = NAN;
+  }
+  free(probabilities);
+
+  //annotation section
+  char *commandLog = NULL;
+  bool readSucceeded = p7PressedReadString(cursor, &header->name) &&
+    (!(flags & P7_PRESSED_FLAG_ACC) || p7PressedReadString(cursor, &header->accessionNumber)) &&
+    (!(flags & P7_PRESSED_FLAG_DESC) || p7PressedReadString(cursor, &header->description)) &&
+    (!(flags & P7_PRESSED_FLAG_RF) || p7PressedReadAnnotation(cursor, model->referenceAnnotation, modelLength));
+  if(readSucceeded && (flags & P7_PRESSED_FLAG_MMASK)){
+    const char *maskLine = cursor->position + 1;
+    readSucceeded = p7PressedReadAnnotation(cursor, NULL, modelLength);
+    for(uint32_t nodeIndex = 0; readSucceeded && nodeIndex < modelLength; nodeIndex++){
+      model->modelMask[nodeIndex] = maskLine[nodeIndex] == 'm';
+    }
+  }
+  readSucceeded = readSucceeded &&
+    (!(flags & P7_PRESSED_FLAG_CONS) || p7PressedReadAnnotation(cursor, model->consensusResidues, modelLength)) &&
+    (!(flags & P7_PRESSED_FLAG_CS) || p7PressedReadAnnotation(cursor, model->consensusStructure, modelLength)) &&
+    (!(flags & P7_PRESSED_FLAG_CA) || p7PressedReadAnnotation(cursor, NULL, modelLength)) &&
+    p7PressedReadString(cursor, &commandLog);
+  if(readSucceeded && !p7PressedFormatCommandLog(commandLog, &header->commandLineHistory)){
+    free(commandLog);
+    return p7HmmAllocationFailure;
+  }
+  free(commandLog);
+
+  int32_t numSequences;
+  float effectiveNumSequences;
+  int32_t maxLength;
+  readSucceeded = readSucceeded && p7BinaryReadWords(cursor, &numSequences, 1) &&
+    p7BinaryReadWords(cursor, &effectiveNumSequences, 1) && p7BinaryReadWords(cursor, &maxLength, 1) &&
+    p7PressedReadString(cursor, &header->date);
+  if(!readSucceeded){
+    return p7HmmFormatError;
+  }
+  header->numSequences = numSequences;
+  header->effectiveNumSequences = p7RoundToDecimals(effectiveNumSequences, 6);
+  header->maxLength = maxLength;
+  if(flags & P7_PRESSED_FLAG_MAP){
+    int32_t *map = malloc(((size_t)modelLength + 1) * sizeof(int32_t));
+    if(map == NULL){
+      return p7HmmAllocationFailure;
+    }
+    readSucceeded = p7BinaryReadWords(cursor, map, (size_t)modelLength + 1);
+    for(uint32_t nodeIndex = 0; readSucceeded && nodeIndex < modelLength; nodeIndex++){
+      model->mapAnnotations[nodeIndex] = map[nodeIndex + 1];
+    }
+    free(map);
+  }
+
+  float evParams[P7_PRESSED_NUM_EVPARAMS];
+  float cutoffs[P7_PRESSED_NUM_CUTOFFS];
+  readSucceeded = readSucceeded && p7BinaryReadWords(cursor, &header->checksum, 1) &&
+    p7BinaryReadWords(cursor, evParams, P7_PRESSED_NUM_EVPARAMS) && p7BinaryReadWords(cursor, cutoffs, P7_PRESSED_NUM_CUTOFFS);
+  if(!readSucceeded){
+    return p7HmmFormatError;
+  }
+  if(!(flags & P7_PRESSED_FLAG_CHKSUM)){
+    header->checksum = 0;
+  }
+  //STATS lines print mu (or tau) with 4 decimals, and lambda with 5
+  if(flags & P7_PRESSED_FLAG_STATS){
+    phmm->stats.msvGumbelMu = p7RoundToDecimals(evParams[0], 4);
+    phmm->stats.msvGumbelLambda = p7RoundToDecimals(evParams[1], 5);
+    phmm->stats.viterbiGumbelMu = p7RoundToDecimals(evParams[2], 4);
+    phmm->stats.viterbiGumbelLambda = p7RoundToDecimals(evParams[3], 5);
+    phmm->stats.forwardTau = p7RoundToDecimals(evParams[4], 4);
+    phmm->stats.forwardLambda = p7RoundToDecimals(evParams[5], 5);
+  }
+  //cutoffs print with 2 decimals, and are left at their defaults when absent, like readP7Hmm
+  const uint32_t cutoffFlags[3] = {P7_PRESSED_FLAG_GA, P7_PRESSED_FLAG_TC, P7_PRESSED_FLAG_NC};
+  float *const cutoffPairs[3] = {header->gatheringThresholds, header->trustedCutoffs, header->noiseCutoffs};
+  for(uint32_t i = 0; i < 3; i++){
+    if(flags & cutoffFlags[i]){
+      cutoffPairs[i][0] = p7RoundToDecimals(cutoffs[2 * i], 2);
+      cutoffPairs[i][1] = p7RoundToDecimals(cutoffs[2 * i + 1], 2);
+    }
+  }
+  if(flags & P7_PRESSED_FLAG_COMPO){
+    float compoProbabilities[P7_PRESSED_MAX_ALPHABET];
+    if(!p7BinaryReadWords(cursor, compoProbabilities, P7_PRESSED_MAX_ALPHABET)){
+      return p7HmmFormatError;
+    }
+    p7ProbabilitiesToScores(compoProbabilities, p7HmmAttachCompo(phmm), alphabetCardinality);
+  }
+
+  header->version = malloc(sizeof(P7_PRESSED_VERSION));
+  if(header->version == NULL){
+    return p7HmmAllocationFailure;
+  }
+  memcpy(header->version, P7_PRESSED_VERSION, sizeof(P7_PRESSED_VERSION));
+  return p7HmmSuccess;
+}
+
+
+enum P7HmmReturnCode readP7HmmPressed(const char *const fileSrc, struct P7HmmList *phmmList){
+  p7HmmListInit(phmmList);
+
+  struct P7HmmFileMap fileMap;
+  enum P7HmmReturnCode returnCode = p7HmmFileMapOpen(fileSrc, &fileMap);
+  if(returnCode != p7HmmSuccess){
+    return returnCode;
+  }
+  struct P7BinaryCursor cursor = {.position = fileMap.data, .end = fileMap.data + fileMap.length, .swapBytes = false};
+
+  //a pressed file is just each model's binary record, one after another
+  while(returnCode == p7HmmSuccess && p7BinaryRemaining(&cursor) != 0){
+    uint32_t magic;
+    if(!p7BinaryRead(&cursor, &magic, sizeof(uint32_t))){
+      printFormatError(fileSrc, phmmList->count, "pressed file ends with a partial model.");
+      returnCode = p7HmmFormatError;
+      break;
+    }
+    if(magic == P7_PRESSED_V3F_MAGIC || magic == p7SwapUint32(P7_PRESSED_V3F_MAGIC)){
+      cursor.swapBytes = magic != P7_PRESSED_V3F_MAGIC;
+    }
+    else{
+      printFormatError(fileSrc, phmmList->count,
+        "model does not start with the HMMER3/f pressed magic number (older pressed formats are not supported).");
+      returnCode = p7HmmFormatError;
+      break;
+    }
+
+    struct P7Hmm *phmm = p7HmmListAppendHmm(phmmList);
+    if(phmm == NULL){
+      printAllocationError(fileSrc, phmmList->count, "could not allocate memory to grow the P7ProfileHmmList list.");
+      returnCode = p7HmmAllocationFailure;
+      break;
+    }
+    returnCode = p7PressedReadHmm(&cursor, phmm);
+    if(returnCode == p7HmmAllocationFailure){
+      printAllocationError(fileSrc, phmmList->count, "could not allocate memory for model data.");
+    }
+    else if(returnCode != p7HmmSuccess){
+      printFormatError(fileSrc, phmmList->count, "pressed model is truncated or corrupt.");
+    }
+  }
+
+  if(returnCode == p7HmmSuccess && phmmList->count == 0){
+    printFormatError(fileSrc, 0, "pressed file does not contain any models.");
+    returnCode = p7HmmFormatError;
+  }
+  p7HmmFileMapClose(&fileMap);
+  if(returnCode != p7HmmSuccess){
+    p7HmmListDealloc(phmmList);
+  }
+  return returnCode;
+}
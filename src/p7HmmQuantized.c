@@ -0,0 +1,340 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "p7HmmReader.h"
+#include "p7ProfileHmm.h"
+
+
+//fixed point scores are stored in units of 1/1000 nat
+#define P7_FIXED16_SCALE 1000.0f
+//the ends of the int16_t range are reserved for '*' and infinite scores (e.g., -ln(0) from pressed files)
+#define P7_FIXED16_STAR INT16_MIN
+#define P7_FIXED16_INFINITY INT16_MAX
+#define P7_FIXED16_MAX (INT16_MAX - 1)
+//byte codes 0-252 span the model's range of finite scores, and the codes above it are reserved
+#define P7_BYTE_MAX 252
+#define P7_BYTE_NEGATIVE_INFINITY 253
+#define P7_BYTE_INFINITY 254
+#define P7_BYTE_STAR 255
+
+
+//converts to IEEE 754 half precision, rounding to nearest even. Out of range values become infinity.
+static uint16_t p7FloatToHalf(const float value){
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(float));
+  const uint16_t sign = (bits >> 16) & 0x8000;
+  const uint32_t exponent = (bits >> 23) & 0xff;
+  uint32_t mantissa = bits & 0x7fffff;
+  if(exponent == 0xff){
+    return sign | 0x7c00 | (mantissa != 0? 0x200: 0);
+  }
+  const int32_t halfExponent = (int32_t)exponent - 127 + 15;
+  if(halfExponent >= 31){
+    return sign | 0x7c00;
+  }
+  if(halfExponent <= 0){
+    //subnormal half, or too small to represent at all
+    if(halfExponent < -10){
+      return sign;
+    }
+    mantissa |= 0x800000;
+    const uint32_t shift = 14 - halfExponent;
+    uint32_t halfMantissa = mantissa >> shift;
+    const uint32_t remainder = mantissa & ((1u << shift) - 1);
+    const uint32_t halfway = 1u << (shift - 1);
+    if(remainder > halfway || (remainder == halfway && (halfMantissa & 1))){
+      halfMantissa++;
+    }
+    return sign | halfMantissa;
+  }
+  uint32_t half = ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+  const uint32_t remainder = mantissa & 0x1fff;
+  //a carry out of the mantissa correctly rounds up into the exponent
+  if(remainder > 0x1000 || (remainder == 0x1000 && (half & 1))){
+    half++;
+  }
+  return sign | half;
+}
+
+static float p7HalfToFloat(const uint16_t half){
+  const uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+  const uint32_t exponent = (half >> 10) & 0x1f;
+  const uint32_t mantissa = half & 0x3ff;
+  uint32_t bits;
+  if(exponent == 0x1f){
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  }
+  else if(exponent != 0){
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  }
+  else{
+    //zero or subnormal, mantissa * 2^-24
+    const float value = (float)mantissa * 5.9604644775390625e-8f;
+    return sign != 0? -value: value;
+  }
+  float value;
+  memcpy(&value, &bits, sizeof(float));
+  return value;
+}
+
+static inline int16_t p7FloatToFixed16(const float value){
+  if(isnan(value)){
+    return P7_FIXED16_STAR;
+  }
+  if(isinf(value)){
+    return value > 0? P7_FIXED16_INFINITY: -P7_FIXED16_INFINITY;
+  }
+  const float scaledValue = roundf(value * P7_FIXED16_SCALE);
+  return scaledValue >= P7_FIXED16_MAX? P7_FIXED16_MAX: scaledValue <= -P7_FIXED16_MAX? -P7_FIXED16_MAX: (int16_t)scaledValue;
+}
+
+static inline uint8_t p7FloatToByte(const float value, const float scale, const float offset){
+  if(isnan(value)){
+    return P7_BYTE_STAR;
+  }
+  if(isinf(value)){
+    return value > 0? P7_BYTE_INFINITY: P7_BYTE_NEGATIVE_INFINITY;
+  }
+  const float code = roundf((value - offset) * scale);
+  return code >= P7_BYTE_MAX? P7_BYTE_MAX: code <= 0.0f? 0: (uint8_t)code;
+}
+
+static inline float p7Fixed16ToFloat(const int16_t code){
+  switch(code){
+    case P7_FIXED16_STAR:      return NAN;
+    case P7_FIXED16_INFINITY:  return INFINITY;
+    case -P7_FIXED16_INFINITY: return -INFINITY;
+    default:                   return code / P7_FIXED16_SCALE;
+  }
+}
+
+static inline float p7ByteToFloat(const uint8_t code, const float scale, const float offset){
+  switch(code){
+    case P7_BYTE_STAR:              return NAN;
+    case P7_BYTE_INFINITY:          return INFINITY;
+    case P7_BYTE_NEGATIVE_INFINITY: return -INFINITY;
+    default:                        return offset + code / scale;
+  }
+}
+
+static void p7QuantizeScores(const struct P7QuantizedScores *quantized, const float *scores, const size_t numScores,
+  void *codes){
+  switch(quantized->precision){
+    case p7HmmPrecisionHalf:
+      for(size_t i = 0; i < numScores; i++){
+        ((uint16_t*)codes)[i] = p7FloatToHalf(scores[i]);
+      }
+      break;
+    case p7HmmPrecisionFixed16:
+      for(size_t i = 0; i < numScores; i++){
+        ((int16_t*)codes)[i] = p7FloatToFixed16(scores[i]);
+      }
+      break;
+    default:
+      for(size_t i = 0; i < numScores; i++){
+        ((uint8_t*)codes)[i] = p7FloatToByte(scores[i], quantized->scale, quantized->offset);
+      }
+      break;
+  }
+}
+
+//the switch is outside the loops, so each loop is simple enough for the compiler to vectorize
+static void p7DequantizeScores(const struct P7QuantizedScores *quantized, const void *codes, const size_t numScores,
+  float *scores){
+  switch(quantized->precision){
+    case p7HmmPrecisionFloat:
+      memcpy(scores, codes, numScores * sizeof(float));
+      break;
+    case p7HmmPrecisionHalf:
+      for(size_t i = 0; i < numScores; i++){
+        scores[i] = p7HalfToFloat(((const uint16_t*)codes)[i]);
+      }
+      break;
+    case p7HmmPrecisionFixed16:
+      for(size_t i = 0; i < numScores; i++){
+        scores[i] = p7Fixed16ToFloat(((const int16_t*)codes)[i]);
+      }
+      break;
+    case p7HmmPrecisionByte:
+      for(size_t i = 0; i < numScores; i++){
+        scores[i] = p7ByteToFloat(((const uint8_t*)codes)[i], quantized->scale, quantized->offset);
+      }
+      break;
+  }
+}
+
+//finds the range of the finite scores, so byte codes can span it.
+static void p7ScoreRange(const float *scores, const size_t numScores, float *minScore, float *maxScore){
+  for(size_t i = 0; i < numScores; i++){
+    if(isfinite(scores[i])){
+      *minScore = scores[i] < *minScore? scores[i]: *minScore;
+      *maxScore = scores[i] > *maxScore? scores[i]: *maxScore;
+    }
+  }
+}
+
+//copies everything but the emission and transition scores into the model's newly allocated block.
+static void p7CopyModelExtras(struct P7Hmm *phmm, const struct P7Model *sourceModel){
+  const uint32_t alphabetCardinality = p7HmmGetAlphabetCardinality(phmm);
+  const size_t modelLength = phmm->header.modelLength;
+  struct P7Model *model = &phmm->model;
+  memcpy(model->insert0Emissions, sourceModel->insert0Emissions, alphabetCardinality * sizeof(float));
+  if(sourceModel->compo != NULL){
+    memcpy(p7HmmAttachCompo(phmm), sourceModel->compo, alphabetCardinality * sizeof(float));
+  }
+  if(model->mapAnnotations != NULL){
+    memcpy(model->mapAnnotations, sourceModel->mapAnnotations, modelLength * sizeof(uint32_t));
+  }
+  if(model->modelMask != NULL){
+    memcpy(model->modelMask, sourceModel->modelMask, modelLength * sizeof(bool));
+  }
+  if(model->consensusResidues != NULL){
+    memcpy(model->consensusResidues, sourceModel->consensusResidues, modelLength);
+  }
+  if(model->referenceAnnotation != NULL){
+    memcpy(model->referenceAnnotation, sourceModel->referenceAnnotation, modelLength);
+  }
+  if(model->consensusStructure != NULL){
+    memcpy(model->consensusStructure, sourceModel->consensusStructure, modelLength);
+  }
+}
+
+static void p7FloatTransitions(struct P7StateTransitions *stateTransitions, float **transitions){
+  transitions[p7HmmMatchToMatch] = stateTransitions->matchToMatch;
+  transitions[p7HmmMatchToInsert] = stateTransitions->matchToInsert;
+  transitions[p7HmmMatchToDelete] = stateTransitions->matchToDelete;
+  transitions[p7HmmInsertToMatch] = stateTransitions->insertToMatch;
+  transitions[p7HmmInsertToInsert] = stateTransitions->insertToInsert;
+  transitions[p7HmmDeleteToMatch] = stateTransitions->deleteToMatch;
+  transitions[p7HmmDeleteToDelete] = stateTransitions->deleteToDelete;
+}
+
+
+float p7HmmDecodeQuantizedScore(const struct P7QuantizedScores *const quantized, const void *const codes, const size_t index){
+  if(codes == NULL){
+    return NAN;
+  }
+  switch(quantized->precision){
+    case p7HmmPrecisionHalf:
+      return p7HalfToFloat(((const uint16_t*)codes)[index]);
+    case p7HmmPrecisionFixed16:
+      return p7Fixed16ToFloat(((const int16_t*)codes)[index]);
+    case p7HmmPrecisionByte:
+      return p7ByteToFloat(((const uint8_t*)codes)[index], quantized->scale, quantized->offset);
+    default:
+      return ((const float*)codes)[index];
+  }
+}
+
+enum P7HmmReturnCode p7HmmQuantizeModel(struct P7Hmm *phmm, const enum P7HmmScorePrecision precision){
+  if(precision == p7HmmPrecisionFloat && phmm->model.matchEmissionScores != NULL){
+    return p7HmmSuccess;
+  }
+  if(phmm->model.matchEmissionScores == NULL || precision > p7HmmPrecisionByte){
+    return p7HmmFormatError;
+  }
+  const size_t numEmissions = (size_t)p7HmmGetAlphabetCardinality(phmm) * phmm->header.modelLength;
+  const size_t modelLength = phmm->header.modelLength;
+  struct P7Model floatModel = phmm->model;
+  float *floatTransitions[7];
+  p7FloatTransitions(&floatModel.stateTransitions, floatTransitions);
+
+  p7HmmDetachModelData(phmm);
+  enum P7HmmReturnCode returnCode = p7HmmAllocateQuantizedModelData(phmm, floatModel.insertEmissionScores != NULL,
+    floatModel.arena, precision);
+  if(returnCode != p7HmmSuccess){
+    phmm->model = floatModel;
+    return returnCode;
+  }
+  //the transposed copy would keep serving the unrounded scores, so it's dropped until the model is dequantized.
+  //it's always a separate allocation, even for models in an arena. The compacted insert rows are kept in float.
+  free(floatModel.transposedMatchEmissions);
+  phmm->model.uniqueInsertEmissions = floatModel.uniqueInsertEmissions;
+  phmm->model.insertRowIndices = floatModel.insertRowIndices;
+  phmm->model.numUniqueInsertRows = floatModel.numUniqueInsertRows;
+  p7CopyModelExtras(phmm, &floatModel);
+
+  struct P7QuantizedScores *quantized = &phmm->model.quantized;
+  if(precision == p7HmmPrecisionByte){
+    float minScore = INFINITY;
+    float maxScore = -INFINITY;
+    p7ScoreRange(floatModel.matchEmissionScores, numEmissions, &minScore, &maxScore);
+    if(floatModel.insertEmissionScores != NULL){
+      p7ScoreRange(floatModel.insertEmissionScores, numEmissions, &minScore, &maxScore);
+    }
+    for(uint32_t i = 0; i < 7; i++){
+      p7ScoreRange(floatTransitions[i], modelLength, &minScore, &maxScore);
+    }
+    if(minScore > maxScore){
+      minScore = maxScore = 0.0f;
+    }
+    quantized->offset = minScore;
+    quantized->scale = maxScore > minScore? P7_BYTE_MAX / (maxScore - minScore): 1.0f;
+  }
+  p7QuantizeScores(quantized, floatModel.matchEmissionScores, numEmissions, quantized->matchEmissionScores);
+  if(floatModel.insertEmissionScores != NULL){
+    p7QuantizeScores(quantized, floatModel.insertEmissionScores, numEmissions, quantized->insertEmissionScores);
+  }
+  for(uint32_t i = 0; i < 7; i++){
+    p7QuantizeScores(quantized, floatTransitions[i], modelLength, quantized->transitions[i]);
+  }
+  //a block in an arena is given back when the list's arena is destroyed
+  if(floatModel.arena == NULL){
+    free(floatModel.insert0Emissions);
+  }
+  return p7HmmSuccess;
+}
+
+enum P7HmmReturnCode p7HmmDequantizeModel(struct P7Hmm *phmm){
+  if(phmm->model.matchEmissionScores != NULL){
+    return p7HmmSuccess;
+  }
+  if(phmm->model.quantized.matchEmissionScores == NULL){
+    return p7HmmFormatError;
+  }
+  const size_t numEmissions = (size_t)p7HmmGetAlphabetCardinality(phmm) * phmm->header.modelLength;
+  const size_t modelLength = phmm->header.modelLength;
+  struct P7Model quantizedModel = phmm->model;
+  const struct P7QuantizedScores *quantized = &quantizedModel.quantized;
+
+  p7HmmDetachModelData(phmm);
+  enum P7HmmReturnCode returnCode = p7HmmAllocateModelData(phmm, quantized->insertEmissionScores != NULL,
+    quantizedModel.arena);
+  if(returnCode != p7HmmSuccess){
+    phmm->model = quantizedModel;
+    return returnCode;
+  }
+  //any transposed copy predates the rounding, so it's rebuilt from the dequantized scores on request
+  free(quantizedModel.transposedMatchEmissions);
+  phmm->model.uniqueInsertEmissions = quantizedModel.uniqueInsertEmissions;
+  phmm->model.insertRowIndices = quantizedModel.insertRowIndices;
+  phmm->model.numUniqueInsertRows = quantizedModel.numUniqueInsertRows;
+  p7CopyModelExtras(phmm, &quantizedModel);
+
+  float *floatTransitions[7];
+  p7FloatTransitions(&phmm->model.stateTransitions, floatTransitions);
+  p7DequantizeScores(quantized, quantized->matchEmissionScores, numEmissions, phmm->model.matchEmissionScores);
+  if(quantized->insertEmissionScores != NULL){
+    p7DequantizeScores(quantized, quantized->insertEmissionScores, numEmissions, phmm->model.insertEmissionScores);
+  }
+  for(uint32_t i = 0; i < 7; i++){
+    p7DequantizeScores(quantized, quantized->transitions[i], modelLength, floatTransitions[i]);
+  }
+  if(quantizedModel.arena == NULL){
+    free(quantizedModel.insert0Emissions);
+  }
+  return p7HmmSuccess;
+}
+
+enum P7HmmReturnCode p7HmmDequantizeMatchEmissions(const struct P7Hmm *const phmm, float *scores){
+  const size_t numEmissions = (size_t)p7HmmGetAlphabetCardinality(phmm) * phmm->header.modelLength;
+  if(phmm->model.matchEmissionScores != NULL){
+    memcpy(scores, phmm->model.matchEmissionScores, numEmissions * sizeof(float));
+    return p7HmmSuccess;
+  }
+  if(phmm->model.quantized.matchEmissionScores == NULL){
+    return p7HmmFormatError;
+  }
+  p7DequantizeScores(&phmm->model.quantized, phmm->model.quantized.matchEmissionScores, numEmissions, scores);
+  return p7HmmSuccess;
+}
@@ -1,6 +1,7 @@
 #ifndef P7_HMM_READER_HMM_PARSE_H
 #define P7_HMM_READER_HMM_PARSE_H
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -14,7 +15,8 @@
 
 
 enum P7HmmReturnCode{
-  p7HmmSuccess = 0, p7HmmAllocationFailure = -1, p7HmmFormatError = -2, p7HmmFileNotFound = -3
+  p7HmmSuccess = 0, p7HmmAllocationFailure = -1, p7HmmFormatError = -2, p7HmmFileNotFound = -3,
+  p7HmmModelNotFound = -4
 };
 
 enum P7Alphabet{
@@ -51,12 +53,40 @@ struct P7StateTransitions{
   float *deleteToDelete;  //Dk -> Dk+1
 };
 
+//storage formats for a model's emission and transition scores, see p7HmmQuantizeModel.
+enum P7HmmScorePrecision{
+  p7HmmPrecisionFloat,      //32 bit floats, in the score arrays of the P7Model
+  p7HmmPrecisionHalf,       //IEEE 754 half precision floats, stored as uint16_t
+  p7HmmPrecisionFixed16,    //int16_t in units of 1/1000 nat. INT16_MIN encodes '*', +-INT16_MAX encode +-infinity,
+                            //and other large scores saturate
+  p7HmmPrecisionByte        //uint8_t code, decoded as offset + code / scale. 253 and 254 encode -/+infinity,
+                            //and 255 encodes '*'
+};
+
+//a model's emission and transition scores, when they're stored at reduced precision.
+struct P7QuantizedScores{
+  enum P7HmmScorePrecision precision;
+  void *matchEmissionScores;
+  void *insertEmissionScores;   //NULL if the model was loaded without insert emissions
+  void *transitions[7];         //indexed by P7HmmTransition
+  float scale;                  //only used by p7HmmPrecisionByte
+  float offset;
+};
+
+//slabs that hold all of a list's model data and strings, see readP7HmmWithArena.
+struct P7HmmArena;
+
 struct P7Model{
   float *compo;
   float *insert0Emissions;
   struct P7InitialTransitions initialTransitions;
   float *matchEmissionScores;
   float *insertEmissionScores;
+  //each distinct insert emission row stored once, and the row each node uses, see readP7HmmCompactInserts.
+  //insertEmissionScores is NULL when these are in use.
+  float *uniqueInsertEmissions;
+  uint32_t *insertRowIndices;
+  uint32_t numUniqueInsertRows;
   struct P7StateTransitions stateTransitions;
   //these remaining fields are the optional fields on the match emission line
   uint32_t *mapAnnotations;
@@ -64,6 +94,11 @@ struct P7Model{
   char *referenceAnnotation;
   bool *modelMask;
   char *consensusStructure;
+  //symbol-major copy of matchEmissionScores, only built on request, see p7HmmGetSymbolMatchEmissions
+  float *transposedMatchEmissions;
+  //when the precision isn't p7HmmPrecisionFloat, the scores are kept here and the float score arrays are NULL
+  struct P7QuantizedScores quantized;
+  struct P7HmmArena *arena;     //arena the model's data block was carved from, NULL if it was allocated on its own
 };
 
 struct P7Header{
@@ -83,6 +118,8 @@ struct P7Header{
   char *description;
   char *date;
   char *commandLineHistory;
+  char *buildCommand;     //Pfam's BM line, the command used to build the model
+  char *searchCommand;    //Pfam's SM line, the command used to search for the model's cutoffs
   float gatheringThresholds[2];
   float trustedCutoffs[2];
   float noiseCutoffs[2];
@@ -98,8 +135,104 @@ struct P7Hmm{
 struct P7HmmList{
   struct P7Hmm *phmms;
   uint32_t count;
+  uint32_t capacity;          //number of models the phmms array has room for
+  struct P7HmmArena *arena;   //NULL unless the list was read with readP7HmmWithArena
+};
+
+//decides whether to keep a model, given its parsed header and stats, see readP7HmmFiltered.
+typedef bool (*P7HmmFilter)(const struct P7Hmm *phmm, void *filterData);
+
+//fields that can be left out of a load, combined as a bitmask, see readP7HmmSkippingFields.
+enum P7HmmSkipField{
+  p7HmmSkipNothing                = 0,
+  p7HmmSkipInsertEmissions        = 1 << 0,
+  p7HmmSkipCompo                  = 1 << 1,
+  p7HmmSkipMapAnnotations         = 1 << 2,
+  p7HmmSkipConsensusResidues      = 1 << 3,
+  p7HmmSkipReferenceAnnotation    = 1 << 4,
+  p7HmmSkipModelMask              = 1 << 5,
+  p7HmmSkipConsensusStructure     = 1 << 6,
+  p7HmmSkipCommandHistory         = 1 << 7,
+  p7HmmSkipAnnotations            = p7HmmSkipMapAnnotations | p7HmmSkipConsensusResidues |
+    p7HmmSkipReferenceAnnotation | p7HmmSkipModelMask | p7HmmSkipConsensusStructure
+};
+
+//the seven state transitions, in the order they're stored in each packed node record.
+enum P7HmmTransition{
+  p7HmmMatchToMatch, p7HmmMatchToInsert, p7HmmMatchToDelete, p7HmmInsertToMatch,
+  p7HmmInsertToInsert, p7HmmDeleteToMatch, p7HmmDeleteToDelete
+};
+
+//rows of the transposed match emissions are padded to a multiple of this many scores (one 64 byte vector).
+#define P7_HMM_TRANSPOSED_ROW_PADDING 16
+
+//offset (in floats) of the match emissions within a packed node record. The transitions come first,
+//indexed by P7HmmTransition, followed by an unused slot, so the emissions start on a 32 byte boundary.
+#define P7_HMM_PACKED_MATCH_OFFSET 8
+
+//node-major copy of a model's scores, see p7HmmPackModel.
+struct P7HmmPackedModel{
+  float *nodes;                   //modelLength records, each starting on a 64 byte boundary
+  uint32_t modelLength;
+  uint32_t alphabetCardinality;
+  uint32_t nodeStride;            //number of floats from the start of one record to the next
+  uint32_t insertOffset;          //offset (in floats) of the insert emissions within a record
+};
+
+//number of bytes in the vectors a striped profile is laid out for, see p7HmmStripeProfile.
+enum P7HmmVectorWidth{
+  p7HmmVectorWidthAuto = 0, p7HmmVectorWidthSse2 = 16, p7HmmVectorWidthAvx2 = 32, p7HmmVectorWidthAvx512 = 64
 };
 
+//order of the transition vectors stored for each segment of a striped profile. The transitions into a match
+//state (BM, MM, IM, DM) are taken from the node before it, where the DP reads them, the others from the node itself.
+enum P7HmmStripedTransition{
+  p7HmmStripedBeginToMatch, p7HmmStripedMatchToMatch, p7HmmStripedInsertToMatch, p7HmmStripedDeleteToMatch,
+  p7HmmStripedMatchToDelete, p7HmmStripedMatchToInsert, p7HmmStripedInsertToInsert, p7HmmStripedDeleteToDelete,
+  p7HmmStripedNumTransitions
+};
+
+//a model's scores rearranged into Farrar striped vectors for the MSV, Viterbi, and Forward filters.
+//Node n (0 based) of a model with numSegments segments is in segment n % numSegments, at lane n / numSegments.
+//Arrays are laid out as [symbol][segment][lane] for emissions, and [segment][P7HmmStripedTransition][lane]
+//for transitions. Lanes past the end of the model hold the worst possible score.
+struct P7HmmStripedProfile{
+  uint32_t modelLength;
+  uint32_t alphabetCardinality;
+  uint32_t vectorWidth;                 //bytes per vector, one of the P7HmmVectorWidth values
+  //MSV: 8 bit match costs, -round(msvScale * log-odds score) + msvBias, with vectorWidth lanes per vector
+  uint32_t msvNumSegments;
+  uint8_t *msvMatchCosts;
+  float msvScale;
+  uint8_t msvBase;
+  uint8_t msvBias;
+  uint8_t msvBeginToMatchCost;          //uniform local entry into any match state
+  uint8_t msvEndCost;                   //leaving the end state for C or J
+  //Viterbi: 16 bit scores, round(viterbiScale * log-odds score), with vectorWidth / 2 lanes per vector
+  uint32_t viterbiNumSegments;
+  int16_t *viterbiMatchScores;
+  int16_t *viterbiTransitions;
+  float viterbiScale;
+  int16_t viterbiBase;
+  //Forward: match and insert odds ratios and transition probabilities, with vectorWidth / 4 lanes per vector
+  uint32_t forwardNumSegments;
+  float *forwardMatchOdds;
+  float *forwardInsertOdds;
+  float *forwardTransitions;
+};
+
+//reusable buffers for reading many files in a row on one thread, see p7HmmContextCreate.
+struct P7HmmContext;
+
+//streaming reader that parses one model at a time, see p7HmmReaderOpen.
+struct P7HmmReader;
+
+//name and accession index for fetching single models, see p7HmmIndexOpen.
+struct P7HmmIndex;
+
+//list of model headers whose bodies are parsed on demand, see p7HmmLazyOpen.
+struct P7HmmLazyList;
+
 /*
  * Function:  readP7Hmm
  * --------------------
@@ -119,15 +252,794 @@ struct P7HmmList{
  *      p7HmmFormatError if there appears to be a file formatting error,
  *        and therefore the parser could not read the file correctly.
  *      p7HmmAllocationFailure if the file could not be read sucessfully.
+ *      p7HmmFileNotFound if the file could not be opened, or reading from it failed.
  */
 enum P7HmmReturnCode readP7Hmm(const char *const fileSrc, struct P7HmmList *phmmList);
 
+/*
+ * Function:  readP7HmmFiltered
+ * --------------------
+ * reads the given fileSrc like readP7Hmm, but only keeps the models accepted by the filter.
+ *    The filter is called once each model's header is complete (just before its 'HMM' line),
+ *    with every header field and the STATS values set, but no model data. The rest of a rejected
+ *    model is skipped by only looking for its '//' terminator, so its node lines are never
+ *    tokenized, and its model data is never allocated.
+ *
+ *  Inputs:
+ *    fileSrc: Location of the hmm file to open.
+ *    filter: function returning true for models to keep, or NULL to keep every model.
+ *    filterData: passed to every call of the filter, e.g., a list of accessions to keep.
+ *    phmmList: Pointer to a P7HmmList, either dynamically allocated by the user,
+ *      or allocated on the stack, but uninitialized.
+ *
+ *  Returns:
+ *    P7HmmReturnCode represnting the result of the read, as with readP7Hmm.
+ *      A file whose models are all rejected is read successfully into an empty list.
+ */
+enum P7HmmReturnCode readP7HmmFiltered(const char *const fileSrc, const P7HmmFilter filter, void *filterData,
+  struct P7HmmList *phmmList);
+
+/*
+ * Function:  readP7HmmSkippingFields
+ * --------------------
+ * reads the given fileSrc like readP7Hmm, but leaves out the fields named in skipFields.
+ *    Skipped fields are never allocated or decoded, and are left NULL in every model. Skipping an
+ *    annotation also sets its header flag (e.g., hasModelMask) to false, so the models stay
+ *    self-consistent. When every annotation is skipped, the annotation columns of the match
+ *    emission lines aren't tokenized at all. Models loaded without insert emissions can't be
+ *    written back out with p7HmmWrite or p7HmmListWriteBinary.
+ *
+ *  Inputs:
+ *    fileSrc: Location of the hmm file to open.
+ *    skipFields: bitwise OR of P7HmmSkipField values, or p7HmmSkipNothing to load everything.
+ *    phmmList: Pointer to a P7HmmList, either dynamically allocated by the user,
+ *      or allocated on the stack, but uninitialized.
+ *
+ *  Returns:
+ *    P7HmmReturnCode represnting the result of the read, as with readP7Hmm.
+ */
+enum P7HmmReturnCode readP7HmmSkippingFields(const char *const fileSrc, const uint32_t skipFields,
+  struct P7HmmList *phmmList);
+
+/*
+ * Function:  p7HmmValidateFile
+ * --------------------
+ * checks the given fileSrc against the same format rules readP7Hmm applies (node index order,
+ *    the number of values on each line, yes/no flags, where '*' is allowed, and so on), but never
+ *    allocates or stores any model data. Each model is summarized by its header and stats, as a
+ *    P7HmmList whose model arrays are all NULL (its command history is left out as well).
+ *
+ *  Inputs:
+ *    fileSrc: Location of the hmm file to check.
+ *    summaryList: Pointer to an uninitialized P7HmmList, that will hold one header-only model
+ *      for each model that passed validation. Deallocate it with p7HmmListDealloc.
+ *
+ *  Returns:
+ *    P7HmmReturnCode represnting the result of the check, as with readP7Hmm.
+ *      On a format error, the message is printed as usual, and summaryList keeps the
+ *      summaries of every model before the one that failed.
+ */
+enum P7HmmReturnCode p7HmmValidateFile(const char *const fileSrc, struct P7HmmList *summaryList);
+
+/*
+ * Function:  readP7HmmCompactInserts
+ * --------------------
+ * reads the given fileSrc like readP7Hmm, but stores each distinct insert emission row of a model only
+ *    once. In most HMMER3 models every node's insert emissions are the background frequencies, so this
+ *    roughly halves the memory used by emissions. The rows are in uniqueInsertEmissions, with the row of
+ *    node k at insertRowIndices[k], and insertEmissionScores is left NULL. Rows are only merged if they're
+ *    identical, so p7HmmGetInsertEmissionScores returns exactly the same scores as for readP7Hmm.
+ *
+ *  Inputs:
+ *    fileSrc: Location of the hmm file to open.
+ *    phmmList: Pointer to a P7HmmList, either dynamically allocated by the user,
+ *      or allocated on the stack, but uninitialized.
+ *
+ *  Returns:
+ *    P7HmmReturnCode represnting the result of the read, as with readP7Hmm.
+ */
+enum P7HmmReturnCode readP7HmmCompactInserts(const char *const fileSrc, struct P7HmmList *phmmList);
+
+/*
+ * Function:  readP7HmmQuantized
+ * --------------------
+ * reads the given fileSrc like readP7Hmm, but stores every model's emission and transition scores
+ *    at the given precision (see p7HmmQuantizeModel). Each model is converted as soon as its '//'
+ *    line is parsed, so only one model is ever held as floats. The scores are read through
+ *    p7HmmGetMatchEmissionScore, p7HmmGetInsertEmissionScores, and p7HmmGetTransitionScore,
+ *    which decode them on the fly, or converted back with p7HmmDequantizeModel.
+ *
+ *  Inputs:
+ *    fileSrc: Location of the hmm file to open.
+ *    precision: format to store the scores in.
+ *    phmmList: Pointer to a P7HmmList, either dynamically allocated by the user,
+ *      or allocated on the stack, but uninitialized.
+ *
+ *  Returns:
+ *    P7HmmReturnCode represnting the result of the read, as with readP7Hmm.
+ */
+enum P7HmmReturnCode readP7HmmQuantized(const char *const fileSrc, const enum P7HmmScorePrecision precision,
+  struct P7HmmList *phmmList);
+
+/*
+ * Function:  readP7HmmWithArena
+ * --------------------
+ * reads the given fileSrc like readP7Hmm, but every model's data block and header strings are
+ *    carved out of large slabs owned by the list, instead of being allocated one by one.
+ *    p7HmmListDealloc then frees the whole list with a handful of calls, no matter how many
+ *    models it holds. Models in such a list must not be passed to anything that frees them
+ *    individually; deallocate the list as a whole instead.
+ *
+ *  Inputs:
+ *    fileSrc: Location of the hmm file to open.
+ *    phmmList: Pointer to a P7HmmList, either dynamically allocated by the user,
+ *      or allocated on the stack, but uninitialized.
+ *
+ *  Returns:
+ *    P7HmmReturnCode represnting the result of the read, as with readP7Hmm.
+ */
+enum P7HmmReturnCode readP7HmmWithArena(const char *const fileSrc, struct P7HmmList *phmmList);
+
+/*
+ * Function:  p7HmmContextCreate
+ * --------------------
+ * Creates a parser context, which owns the line buffer and parser state that readP7Hmm would
+ *    otherwise allocate and free for every file. Reading many small files through one context
+ *    with readP7HmmWithContext only allocates the models themselves. There is no global state,
+ *    so each thread can use its own context, but a context must not be shared between threads.
+ *
+ *  Inputs:
+ *    context: set to the new context, or NULL on failure.
+ *
+ *  Returns:
+ *    p7HmmSuccess on success, or p7HmmAllocationFailure.
+ */
+enum P7HmmReturnCode p7HmmContextCreate(struct P7HmmContext **context);
+
+/*
+ * Function:  readP7HmmWithContext
+ * --------------------
+ * reads the given fileSrc exactly like readP7Hmm, reusing the context's buffers. The line buffer
+ *    is kept after the call, and only grows if a file needs a larger one (e.g., a gzip file).
+ *
+ *  Inputs:
+ *    context: context from p7HmmContextCreate.
+ *    fileSrc: Location of the hmm file to open.
+ *    phmmList: Pointer to a P7HmmList, either dynamically allocated by the user,
+ *      or allocated on the stack, but uninitialized.
+ *
+ *  Returns:
+ *    P7HmmReturnCode represnting the result of the read, as with readP7Hmm.
+ */
+enum P7HmmReturnCode readP7HmmWithContext(struct P7HmmContext *context, const char *const fileSrc,
+  struct P7HmmList *phmmList);
+
+/*
+ * Function:  p7HmmContextDestroy
+ * --------------------
+ * Frees the context and its buffers. Lists read with the context are unaffected.
+ *
+ *  Inputs:
+ *    context: context to free, or NULL.
+ */
+void p7HmmContextDestroy(struct P7HmmContext *context);
+
+/*
+ * Function:  readP7HmmMapped
+ * --------------------
+ * reads the given fileSrc as a profile Hmm file, like readP7Hmm, but memory maps the
+ *    file and parses directly out of the mapping instead of copying each line through
+ *    stdio. This is the faster option for large model databases.
+ *
+ *  Inputs:
+ *    fileSrc: Location of the hmm file to open.
+ *    phmmList: Pointer to a P7HmmList, either dynamically allocated by the user,
+ *      or allocated on the stack, but uninitialized.
+ *
+ *  Returns:
+ *    P7HmmReturnCode represnting the result of the read. Possible returns are:
+ *      p7HmmSuccess on successful file read.
+ *      p7HmmFileNotFound if the file could not be opened or mapped.
+ *      p7HmmFormatError if there appears to be a file formatting error,
+ *        and therefore the parser could not read the file correctly.
+ *      p7HmmAllocationFailure if memory for the models could not be allocated.
+ */
+enum P7HmmReturnCode readP7HmmMapped(const char *const fileSrc, struct P7HmmList *phmmList);
+
+/*
+ * Function:  readP7HmmFromBuffer
+ * --------------------
+ * parses profile Hmm text that is already in memory, like the contents of a
+ *    HMMER3 hmm file, using the same parser as readP7Hmm. The buffer is only read,
+ *    and does not need to be null terminated. Error messages will refer to the
+ *    source as "(buffer)".
+ *
+ *  Inputs:
+ *    buffer: pointer to the hmm text.
+ *    bufferLength: number of characters in the buffer.
+ *    phmmList: Pointer to a P7HmmList, either dynamically allocated by the user,
+ *      or allocated on the stack, but uninitialized.
+ *
+ *  Returns:
+ *    P7HmmReturnCode represnting the result of the read. Possible returns are:
+ *      p7HmmSuccess on successful parse.
+ *      p7HmmFormatError if the text does not meet the HMMER3 format spec.
+ *      p7HmmAllocationFailure if memory for the models could not be allocated.
+ */
+enum P7HmmReturnCode readP7HmmFromBuffer(const char *buffer, const size_t bufferLength, struct P7HmmList *phmmList);
+
+/*
+ * Function:  readP7HmmParallel
+ * --------------------
+ * Reads a multi-model hmm file using several threads. The file is memory mapped, split
+ *    into byte ranges of roughly equal size that each end on a model's '//' terminator line,
+ *    and each range is parsed on its own thread. The resulting list holds the models in
+ *    the same order as the file, identical to the list from readP7Hmm.
+ *
+ *  Inputs:
+ *    fileSrc: Location of the hmm file to read.
+ *    numThreads: maximum number of threads to parse with, or 0 to use one thread per online processor.
+ *      Small files are parsed with fewer threads.
+ *    phmmList: pointer to an uninitialized P7HmmList struct to store the loaded P7Hmm models.
+ *
+ *  Returns:
+ *    p7HmmSuccess on success,
+ *    p7HmmAllocationFailure if memory could not be allocated,
+ *    p7HmmFormatError if the file did not meet the format specification,
+ *    p7HmmFileNotFound if the file could not be opened.
+ */
+enum P7HmmReturnCode readP7HmmParallel(const char *const fileSrc, const uint32_t numThreads, struct P7HmmList *phmmList);
+
+/*
+ * Function:  readP7HmmBatch
+ * --------------------
+ * Loads many hmm files concurrently, e.g., a database split into one file per family.
+ *    Threads repeatedly claim the next unread file from the array, so uneven file sizes
+ *    are balanced across threads automatically. The models from every file that loaded
+ *    successfully are merged into one list, in the same order as the fileSrcs array.
+ *    Files that fail to load contribute no models, and their error is reported in fileReturnCodes.
+ *
+ *  Inputs:
+ *    fileSrcs: array of hmm file locations to load.
+ *    numFiles: number of locations in fileSrcs.
+ *    numThreads: maximum number of threads to load with, or 0 to use one thread per online processor.
+ *    phmmList: pointer to an uninitialized P7HmmList struct to store the loaded P7Hmm models.
+ *      The list must be deallocated with p7HmmListDealloc, even if some files failed to load.
+ *    fileReturnCodes: array of numFiles return codes, set to the result of loading each file.
+ *
+ *  Returns:
+ *    p7HmmSuccess if every file loaded successfully,
+ *    otherwise, the return code of the first file (in array order) that failed to load.
+ *    p7HmmAllocationFailure is also returned if the merged list could not be allocated,
+ *      in which case the list is left empty.
+ */
+enum P7HmmReturnCode readP7HmmBatch(const char *const *fileSrcs, const uint32_t numFiles, const uint32_t numThreads,
+  struct P7HmmList *phmmList, enum P7HmmReturnCode *fileReturnCodes);
+
+/*
+ * Function:  p7HmmBlockCompressFile
+ * --------------------
+ * Creates a block compressed container from a plain hmm file. The models are grouped into
+ *    blocks of roughly blockLength uncompressed bytes, always ending on a model's '//' line,
+ *    and each block is compressed as an independent gzip member. A block index is written
+ *    alongside the container, at blockFileSrc with ".p7bi" appended. Since the container is
+ *    a series of gzip members, it can also be read serially by readP7Hmm, like any gzip file.
+ *
+ *  Inputs:
+ *    hmmFileSrc: Location of the uncompressed hmm file to compress.
+ *    blockFileSrc: Location to write the container to.
+ *    blockLength: target number of uncompressed bytes per block, or 0 for the default (256KiB).
+ *
+ *  Returns:
+ *    p7HmmSuccess on success,
+ *    p7HmmAllocationFailure if memory could not be allocated, or compression failed,
+ *    p7HmmFormatError if the input file is already gzip compressed,
+ *    p7HmmFileNotFound if the input could not be opened, or the output files could not be written.
+ */
+enum P7HmmReturnCode p7HmmBlockCompressFile(const char *const hmmFileSrc, const char *const blockFileSrc,
+  const size_t blockLength);
+
+/*
+ * Function:  readP7HmmBlockCompressed
+ * --------------------
+ * Reads a block compressed container made by p7HmmBlockCompressFile. Threads claim blocks
+ *    from the block index, and each block is decompressed and parsed independently.
+ *    The resulting list holds the models in the same order as the original file.
+ *
+ *  Inputs:
+ *    fileSrc: Location of the container. The block index must be at fileSrc with ".p7bi" appended.
+ *    numThreads: maximum number of threads to use, or 0 to use one thread per online processor.
+ *    phmmList: pointer to an uninitialized P7HmmList struct to store the loaded P7Hmm models.
+ *
+ *  Returns:
+ *    p7HmmSuccess on success,
+ *    p7HmmAllocationFailure if memory could not be allocated,
+ *    p7HmmFormatError if a block or the index is corrupt, or a model does not meet the format specification,
+ *    p7HmmFileNotFound if the container or its index could not be opened.
+ */
+enum P7HmmReturnCode readP7HmmBlockCompressed(const char *const fileSrc, const uint32_t numThreads, struct P7HmmList *phmmList);
+
+/*
+ * Function:  readP7HmmBlockCompressedModel
+ * --------------------
+ * Reads a single model from a block compressed container, by decompressing and parsing
+ *    only the block that holds it.
+ *
+ *  Inputs:
+ *    fileSrc: Location of the container. The block index must be at fileSrc with ".p7bi" appended.
+ *    modelIndex: index of the model to read, in file order starting from 0.
+ *    phmmList: pointer to an uninitialized P7HmmList struct to store the requested model.
+ *
+ *  Returns:
+ *    p7HmmSuccess on success,
+ *    p7HmmModelNotFound if modelIndex is past the last model in the container,
+ *    p7HmmAllocationFailure if memory could not be allocated,
+ *    p7HmmFormatError if the block or the index is corrupt,
+ *    p7HmmFileNotFound if the container or its index could not be opened.
+ */
+enum P7HmmReturnCode readP7HmmBlockCompressedModel(const char *const fileSrc, const uint32_t modelIndex,
+  struct P7HmmList *phmmList);
+
+/*
+ * Function:  readP7HmmPressed
+ * --------------------
+ * Reads a HMMER3/f pressed model file (.h3m), as created by hmmpress. Pressed files store
+ *    probabilities, which are converted to the same -ln(p) scores that readP7Hmm reads from
+ *    the text file, rounded the same way HMMER rounds them when writing text. Pressed files
+ *    don't store the version line, so each model's version is set to "HMMER3/f".
+ *
+ *  Inputs:
+ *    fileSrc: Location of the .h3m file.
+ *    phmmList: pointer to an uninitialized P7HmmList struct to store the loaded P7Hmm models.
+ *
+ *  Returns:
+ *    p7HmmSuccess on success,
+ *    p7HmmAllocationFailure if memory could not be allocated,
+ *    p7HmmFormatError if the file is not a HMMER3/f pressed file, or is truncated,
+ *    p7HmmFileNotFound if the file could not be opened.
+ */
+enum P7HmmReturnCode readP7HmmPressed(const char *const fileSrc, struct P7HmmList *phmmList);
+
+/*
+ * Function:  p7HmmListWriteBinary
+ * --------------------
+ * Writes every model in the list to a compact binary file, which can be loaded much faster
+ *    than hmm text with p7HmmListReadBinary. The file starts with a magic number, a format
+ *    version, and a byte order tag, and stores values in the writing machine's byte order.
+ *    Files written on a machine with the other byte order are swapped when read.
+ *
+ *  Inputs:
+ *    phmmList: list of models to write.
+ *    fileSrc: Location to write the binary file to.
+ *
+ *  Returns:
+ *    p7HmmSuccess on success,
+ *    p7HmmFormatError if a model is quantized, or was loaded without its insert emissions,
+ *    p7HmmFileNotFound if the file could not be opened or written.
+ */
+enum P7HmmReturnCode p7HmmListWriteBinary(const struct P7HmmList *phmmList, const char *const fileSrc);
+
+/*
+ * Function:  p7HmmListReadBinary
+ * --------------------
+ * Loads a list of models from a binary file written by p7HmmListWriteBinary. The file is
+ *    memory mapped, and each model's arrays are copied out directly, without any text parsing.
+ *
+ *  Inputs:
+ *    fileSrc: Location of the binary file.
+ *    phmmList: pointer to an uninitialized P7HmmList struct to store the loaded P7Hmm models.
+ *
+ *  Returns:
+ *    p7HmmSuccess on success,
+ *    p7HmmAllocationFailure if memory could not be allocated,
+ *    p7HmmFormatError if the file is not a supported binary list, or is truncated,
+ *    p7HmmFileNotFound if the file could not be opened.
+ */
+enum P7HmmReturnCode p7HmmListReadBinary(const char *const fileSrc, struct P7HmmList *phmmList);
+
+/*
+ * Function:  p7HmmWrite
+ * --------------------
+ * Writes the model to the given file as HMMER3/f text, in the same layout HMMER uses, so a model
+ *    read with readP7Hmm is written back out byte for byte. Scores are formatted with a fixed
+ *    precision formatter rather than printf, and GA/TC/NC cutoffs are written the way Pfam
+ *    writes them (e.g., "GA    22 22;").
+ *
+ *  Inputs:
+ *    phmm: model to write.
+ *    file: file opened for writing. The file is not closed.
+ *
+ *  Returns:
+ *    p7HmmSuccess on success,
+ *    p7HmmAllocationFailure if the output buffer could not be allocated,
+ *    p7HmmFormatError if the model has no alphabet or model data (or was loaded without insert emissions),
+ *    p7HmmFileNotFound if the file could not be written.
+ */
+enum P7HmmReturnCode p7HmmWrite(const struct P7Hmm *phmm, FILE *file);
+
+/*
+ * Function:  p7HmmListWrite
+ * --------------------
+ * Writes every model in the list to a HMMER3/f text file, like p7HmmWrite.
+ *
+ *  Inputs:
+ *    phmmList: list of models to write.
+ *    fileSrc: Location to write the hmm file to.
+ *
+ *  Returns:
+ *    p7HmmSuccess on success,
+ *    p7HmmAllocationFailure if the output buffer could not be allocated,
+ *    p7HmmFormatError if a model has no alphabet or model data,
+ *    p7HmmFileNotFound if the file could not be opened or written.
+ */
+enum P7HmmReturnCode p7HmmListWrite(const struct P7HmmList *phmmList, const char *const fileSrc);
+
+/*
+ * Function:  p7HmmIndexBuild
+ * --------------------
+ * Builds an index of the models in a plain (uncompressed) hmm file, like hmmfetch --index.
+ *    The index is written alongside the file, at fileSrc with ".p7i" appended, and records each
+ *    model's NAME, ACC, and byte offset, along with the file's length and modification time.
+ *    Only the header lines are read while indexing, the node lines of each model are skipped
+ *    over with a scan for the '//' terminator.
+ *
+ *  Inputs:
+ *    fileSrc: Location of the hmm file to index.
+ *
+ *  Returns:
+ *    p7HmmSuccess on success,
+ *    p7HmmAllocationFailure if memory could not be allocated,
+ *    p7HmmFormatError if the file is compressed, or a model doesn't start with a 'HMMER3' format tag,
+ *    p7HmmFileNotFound if the file could not be opened, or the index could not be written.
+ */
+enum P7HmmReturnCode p7HmmIndexBuild(const char *const fileSrc);
+
+/*
+ * Function:  p7HmmIndexOpen
+ * --------------------
+ * Loads the index built by p7HmmIndexBuild and memory maps the hmm file, so that single models
+ *    can be fetched with p7HmmIndexFetch without reading the rest of the file.
+ *
+ *  Inputs:
+ *    fileSrc: Location of the indexed hmm file. The index must be at fileSrc with ".p7i" appended.
+ *    index: Pointer to the index pointer to set. The index must be closed with p7HmmIndexClose when finished.
+ *
+ *  Returns:
+ *    p7HmmSuccess on success,
+ *    p7HmmAllocationFailure if memory could not be allocated,
+ *    p7HmmFormatError if the index is corrupt, or the hmm file's length or modification time has changed
+ *      since it was indexed,
+ *    p7HmmFileNotFound if the hmm file or its index could not be opened.
+ */
+enum P7HmmReturnCode p7HmmIndexOpen(const char *const fileSrc, struct P7HmmIndex **index);
+
+/*
+ * Function:  p7HmmIndexFetch
+ * --------------------
+ * Parses the single model whose NAME or ACC exactly matches the key. If several models
+ *    share the key, the first one in the file is returned.
+ *
+ *  Inputs:
+ *    index: index opened with p7HmmIndexOpen.
+ *    key: name or accession (including the version, e.g. "PF00128.27") of the model to fetch.
+ *    phmmList: pointer to an uninitialized P7HmmList struct to store the fetched model.
+ *
+ *  Returns:
+ *    p7HmmSuccess on success,
+ *    p7HmmModelNotFound if no model has the given name or accession,
+ *    p7HmmAllocationFailure if memory could not be allocated,
+ *    p7HmmFormatError if the model does not meet the format specification, or the model at the indexed
+ *      offset no longer has the key as its name or accession.
+ */
+enum P7HmmReturnCode p7HmmIndexFetch(const struct P7HmmIndex *index, const char *const key, struct P7HmmList *phmmList);
+
+/*
+ * Function:  p7HmmIndexClose
+ * --------------------
+ * Unmaps the hmm file and deallocates the index. Models already fetched remain valid.
+ *
+ *  Inputs:
+ *    index: index opened with p7HmmIndexOpen. May be NULL.
+ */
+void p7HmmIndexClose(struct P7HmmIndex *index);
+
+/*
+ * Function:  p7HmmLazyOpen
+ * --------------------
+ * Scans a plain (uncompressed) hmm file, parsing only each model's header and STATS lines.
+ *    The body of each model (from its 'HMM' line to its '//' line) is skipped over, and only
+ *    parsed the first time the model is requested with p7HmmLazyGetModel. This makes catalog
+ *    style queries over a large database, e.g., selecting models by name, length, or cutoffs,
+ *    much cheaper than a full load.
+ *
+ *  Inputs:
+ *    fileSrc: Location of the hmm file to scan. The file stays memory mapped until the list is closed.
+ *    lazyList: Pointer to the lazy list pointer to set. The list must be closed with p7HmmLazyClose when finished.
+ *
+ *  Returns:
+ *    p7HmmSuccess on success,
+ *    p7HmmAllocationFailure if memory could not be allocated,
+ *    p7HmmFormatError if the file is compressed, a header does not meet the format specification,
+ *      or a model is missing its '//' terminator,
+ *    p7HmmFileNotFound if the file could not be opened.
+ */
+enum P7HmmReturnCode p7HmmLazyOpen(const char *const fileSrc, struct P7HmmLazyList **lazyList);
+
+/*
+ * Function:  p7HmmLazyHeaders
+ * --------------------
+ * Gets the list of scanned models. Every model's header and stats are filled in, but the
+ *    model data is NULL until the model is loaded with p7HmmLazyGetModel.
+ *
+ *  Inputs:
+ *    lazyList: list opened with p7HmmLazyOpen.
+ *
+ *  Returns:
+ *    pointer to the list of models, owned by the lazy list.
+ */
+const struct P7HmmList *p7HmmLazyHeaders(const struct P7HmmLazyList *lazyList);
+
+/*
+ * Function:  p7HmmLazyGetModel
+ * --------------------
+ * Gets a fully loaded model, parsing its body the first time it's requested. Later requests
+ *    return the same model without parsing it again. Different models may be loaded from
+ *    different threads, but the same model must not be requested from two threads at once.
+ *
+ *  Inputs:
+ *    lazyList: list opened with p7HmmLazyOpen.
+ *    modelIndex: index of the model in file order, starting from 0.
+ *    phmm: pointer to set to the loaded model, which is owned by the lazy list.
+ *
+ *  Returns:
+ *    p7HmmSuccess on success,
+ *    p7HmmModelNotFound if modelIndex is past the last model in the list,
+ *    p7HmmAllocationFailure if memory for the model data could not be allocated,
+ *    p7HmmFormatError if the model's body does not meet the format specification, or does not hold exactly one model.
+ */
+enum P7HmmReturnCode p7HmmLazyGetModel(struct P7HmmLazyList *lazyList, const uint32_t modelIndex, struct P7Hmm **phmm);
+
+/*
+ * Function:  p7HmmLazyClose
+ * --------------------
+ * Deallocates every model in the lazy list, including the loaded ones, and unmaps the file.
+ *
+ *  Inputs:
+ *    lazyList: list opened with p7HmmLazyOpen. May be NULL.
+ */
+void p7HmmLazyClose(struct P7HmmLazyList *lazyList);
+
+/*
+ * Function:  p7HmmReaderOpen
+ * --------------------
+ * Opens the given fileSrc for streaming, so that models can be parsed one at a time
+ *    with p7HmmReaderNext instead of loading the whole file at once. Only one model
+ *    is resident at a time, so memory use is bounded by the largest model in the file.
+ *
+ *  Inputs:
+ *    fileSrc: Location of the hmm file to open. The string is used to label error messages,
+ *      so it must remain valid until the reader is closed.
+ *    reader: Pointer to the reader pointer to set. The reader must be closed with
+ *      p7HmmReaderClose when finished.
+ *
+ *  Returns:
+ *    p7HmmSuccess if the reader was opened,
+ *    p7HmmFileNotFound if the file could not be opened,
+ *    p7HmmAllocationFailure if memory for the reader could not be allocated.
+ */
+enum P7HmmReturnCode p7HmmReaderOpen(const char *const fileSrc, struct P7HmmReader **reader);
+
+/*
+ * Function:  p7HmmReaderNext
+ * --------------------
+ * Parses the next model from the reader's file. The returned model is owned by the reader,
+ *    and remains valid until the next call to p7HmmReaderNext or p7HmmReaderClose.
+ *    The reader reuses its line buffer and model list between calls.
+ *
+ *  Inputs:
+ *    reader: reader opened with p7HmmReaderOpen.
+ *    phmm: Pointer to set to the parsed model, or to NULL once the end of the file is reached.
+ *
+ *  Returns:
+ *    p7HmmSuccess if a model was parsed, or the end of the file was reached.
+ *    p7HmmFormatError if the next model does not meet the format specification.
+ *    p7HmmAllocationFailure if memory for the model could not be allocated.
+ */
+enum P7HmmReturnCode p7HmmReaderNext(struct P7HmmReader *reader, struct P7Hmm **phmm);
+
+/*
+ * Function:  p7HmmReaderClose
+ * --------------------
+ * Closes the reader's file and deallocates the reader, including the last model it returned.
+ *
+ *  Inputs:
+ *    reader: reader opened with p7HmmReaderOpen. May be NULL.
+ */
+void p7HmmReaderClose(struct P7HmmReader *reader);
+
+/*
+ * Function:  p7HmmPackModel
+ * --------------------
+ * Copies the scores of a loaded model into a node-major layout, where each node's transitions,
+ *    match emissions and insert emissions sit together in one 64 byte aligned record. A DP step at
+ *    node k then reads one contiguous record (192 bytes for amino models, 64 for DNA and RNA) instead
+ *    of nine separate arrays. Within a record, transitions are at the P7HmmTransition indices, match
+ *    emissions start at P7_HMM_PACKED_MATCH_OFFSET, and insert emissions start at insertOffset.
+ *    Models loaded with p7HmmSkipInsertEmissions get NaN insert emissions. The packed model doesn't
+ *    reference the original, so either can be freed first.
+ *
+ *  Inputs:
+ *    phmm: model to pack, with its model data loaded.
+ *    packedModel: packed model to fill. Must be deallocated with p7HmmPackedModelDealloc.
+ *
+ *  Returns:
+ *    p7HmmSuccess on success,
+ *    p7HmmFormatError if the model's alphabet or length isn't set, or its model data isn't loaded,
+ *    p7HmmAllocationFailure if the records could not be allocated.
+ */
+enum P7HmmReturnCode p7HmmPackModel(const struct P7Hmm *const phmm, struct P7HmmPackedModel *packedModel);
+
+/*
+ * Function:  p7HmmPackedGetNode
+ * --------------------
+ * Gets the record for the given node, for loops that read several of its scores at once.
+ *
+ *  Inputs:
+ *    packedModel: model packed with p7HmmPackModel.
+ *    nodeIndex: position in the profile hmm, as with p7HmmGetMatchEmissionScore.
+ *
+ *  Returns:
+ *    pointer to the node's record, or NULL if nodeIndex is out of range.
+ */
+const float *p7HmmPackedGetNode(const struct P7HmmPackedModel *const packedModel, const uint32_t nodeIndex);
+
+/*
+ * Function:  p7HmmPackedGetMatchEmissionScore
+ * --------------------
+ * Gets a match emission score from a packed model, like p7HmmGetMatchEmissionScore.
+ *
+ *  Returns:
+ *    float value of the match emission score, or NaN if the given nodeIndex or symbolIndex is out of range.
+ */
+float p7HmmPackedGetMatchEmissionScore(const struct P7HmmPackedModel *const packedModel, const uint32_t nodeIndex,
+  const uint32_t symbolIndex);
+
+/*
+ * Function:  p7HmmPackedGetInsertEmissionScore
+ * --------------------
+ * Gets an insert emission score from a packed model, like p7HmmGetInsertEmissionScores.
+ *
+ *  Returns:
+ *    float value of the insert emission score, or NaN if the given nodeIndex or symbolIndex is out of range.
+ */
+float p7HmmPackedGetInsertEmissionScore(const struct P7HmmPackedModel *const packedModel, const uint32_t nodeIndex,
+  const uint32_t symbolIndex);
+
+/*
+ * Function:  p7HmmPackedGetTransition
+ * --------------------
+ * Gets one of the state transitions out of the given node of a packed model.
+ *
+ *  Returns:
+ *    float value of the transition, or NaN if the given nodeIndex or transition is out of range.
+ */
+float p7HmmPackedGetTransition(const struct P7HmmPackedModel *const packedModel, const uint32_t nodeIndex,
+  const enum P7HmmTransition transition);
+
+/*
+ * Function:  p7HmmPackedModelDealloc
+ * --------------------
+ * Frees the records of a packed model, and resets it to empty.
+ *
+ *  Inputs:
+ *    packedModel: model packed with p7HmmPackModel.
+ */
+void p7HmmPackedModelDealloc(struct P7HmmPackedModel *packedModel);
+
+/*
+ * Function:  p7HmmDetectVectorWidth
+ * --------------------
+ * Checks which vector instructions the running CPU supports.
+ *
+ *  Returns:
+ *    p7HmmVectorWidthAvx512 if AVX-512BW is supported, p7HmmVectorWidthAvx2 if AVX2 is supported,
+ *      and p7HmmVectorWidthSse2 otherwise.
+ */
+enum P7HmmVectorWidth p7HmmDetectVectorWidth(void);
+
+/*
+ * Function:  p7HmmStripeProfile
+ * --------------------
+ * Compiles a loaded model into striped vectors for SIMD filters, like HMMER's optimized profile.
+ *    Match emissions are converted to log-odds scores against insert0Emissions as the null model
+ *    (HMMER sets every insert emission to the background frequencies), and stored three ways:
+ *    biased 8 bit costs in one-third bits for MSV, 16 bit scores in 1/500 bits for Viterbi,
+ *    and float odds ratios for Forward. The profile is configured for local alignment, with
+ *    a uniform entry into every match state. '*' transitions are stored as impossible.
+ *
+ *  Inputs:
+ *    phmm: model to compile, with its model data loaded.
+ *    vectorWidth: vector width to lay the profile out for, or p7HmmVectorWidthAuto to
+ *      use the widest one supported by the running CPU.
+ *    profile: profile to fill. Must be deallocated with p7HmmStripedProfileDealloc.
+ *
+ *  Returns:
+ *    p7HmmSuccess on success,
+ *    p7HmmFormatError if the model's alphabet or length isn't set, its model data isn't loaded,
+ *      or vectorWidth isn't one of the P7HmmVectorWidth values,
+ *    p7HmmAllocationFailure if the profile could not be allocated.
+ */
+enum P7HmmReturnCode p7HmmStripeProfile(const struct P7Hmm *const phmm, const enum P7HmmVectorWidth vectorWidth,
+  struct P7HmmStripedProfile *profile);
+
+/*
+ * Function:  p7HmmStripedProfileDealloc
+ * --------------------
+ * Frees the vectors of a striped profile, and resets it to empty.
+ *
+ *  Inputs:
+ *    profile: profile compiled with p7HmmStripeProfile.
+ */
+void p7HmmStripedProfileDealloc(struct P7HmmStripedProfile *profile);
+
+/*
+ * Function:  p7HmmQuantizeModel
+ * --------------------
+ * Converts a loaded model's emission and transition scores to a smaller storage format, and frees the
+ *    float arrays. Half precision keeps about 3 significant digits, fixed point keeps the scores to the
+ *    nearest 1/1000 nat (the file itself has 1/100000), and byte codes are scaled to span the model's
+ *    range of scores, about 1/20 nat for typical models. Everything else in the model is kept as is.
+ *    Quantized models can't be written, packed, striped, or transposed until they're dequantized.
+ *    For models in lists read with readP7HmmWithArena, the smaller block is taken from the list's arena,
+ *    and the float block's space is only given back when the list is freed.
+ *
+ *  Inputs:
+ *    phmm: model to convert, with its model data loaded as floats.
+ *    precision: format to store the scores in. p7HmmPrecisionFloat leaves the model unchanged.
+ *
+ *  Returns:
+ *    p7HmmSuccess on success,
+ *    p7HmmFormatError if the model's data isn't loaded as floats, or precision isn't valid,
+ *    p7HmmAllocationFailure if the smaller data block could not be allocated. The model is left unchanged.
+ */
+enum P7HmmReturnCode p7HmmQuantizeModel(struct P7Hmm *phmm, const enum P7HmmScorePrecision precision);
+
+/*
+ * Function:  p7HmmDequantizeModel
+ * --------------------
+ * Converts a quantized model's scores back into float arrays, e.g., to write it out or compile it.
+ *    Does nothing if the model's scores are already floats. As with p7HmmQuantizeModel, models in lists
+ *    read with readP7HmmWithArena get their float block from the list's arena.
+ *
+ *  Returns:
+ *    p7HmmSuccess on success,
+ *    p7HmmFormatError if the model's data isn't loaded,
+ *    p7HmmAllocationFailure if the float arrays could not be allocated. The model is left unchanged.
+ */
+enum P7HmmReturnCode p7HmmDequantizeModel(struct P7Hmm *phmm);
+
+/*
+ * Function:  p7HmmDequantizeMatchEmissions
+ * --------------------
+ * Decodes every match emission score of a model into the given array, node by node, as laid out in
+ *    matchEmissionScores. Works for models at any precision.
+ *
+ *  Inputs:
+ *    phmm: model to decode the scores of.
+ *    scores: array with room for modelLength * alphabet cardinality scores.
+ *
+ *  Returns:
+ *    p7HmmSuccess on success, or p7HmmFormatError if the model's data isn't loaded.
+ */
+enum P7HmmReturnCode p7HmmDequantizeMatchEmissions(const struct P7Hmm *const phmm, float *scores);
+
 /*
  * Function:  p7HmmListDealloc
  * --------------------
  * Deallocates and cleans up the given phmmList. This function will walk through
  *  all hmms in the list, deallocating all their allocated data, until finally deallocating
- *  the list its self.
+ *  the list its self. Lists read with readP7HmmWithArena free their arena instead of
+ *  walking the models.
  *
  *  Inputs:
  *    phmmList: struct containing the list of profile hmms, generated and allocated
@@ -160,6 +1072,7 @@ uint32_t p7HmmGetAlphabetCardinality(const struct P7Hmm *const currentPhmm);
  * Function:  p7HmmGetMatchEmissionScore
  * --------------------
  * Gets the match emission score from the given phmm, for the specified nodeIndex and symbol of the alphabet.
+ *  Scores of quantized models are decoded on the fly.
  *
  *  Inputs:
  *    phmm: pointer to the phmm to extract the match emission score from
@@ -175,6 +1088,8 @@ float p7HmmGetMatchEmissionScore(const struct P7Hmm *const phmm, uint32_t nodeIn
  * Function:  p7HmmGetInsertEmissionScores
  * --------------------
  * Gets the insert emission score from the given phmm, for the specified nodeIndex and symbol of the alphabet.
+ *  Models loaded with p7HmmSkipInsertEmissions have no insert emissions, so NaN is always returned for them.
+ *  Scores of quantized models are decoded on the fly.
  *
  *  Inputs:
  *    phmm: pointer to the phmm to extract the match emission score from
@@ -186,4 +1101,55 @@ float p7HmmGetMatchEmissionScore(const struct P7Hmm *const phmm, uint32_t nodeIn
  */
 float p7HmmGetInsertEmissionScores(const struct P7Hmm *const phmm, uint32_t nodeIndex, uint32_t symbolIndex);
 
+/*
+ * Function:  p7HmmGetTransitionScore
+ * --------------------
+ * Gets one of the state transition scores out of the given node, decoding it if the model is quantized.
+ *
+ *  Inputs:
+ *    phmm: pointer to the phmm to extract the transition score from.
+ *    nodeIndex: position in the profile hmm, as specified by the node indices in the hmm file.
+ *    transition: which of the node's transitions to get.
+ *
+ *  Returns:
+ *    float value of the transition score, or NaN if the given nodeIndex or transition is out of range.
+ */
+float p7HmmGetTransitionScore(const struct P7Hmm *const phmm, uint32_t nodeIndex, enum P7HmmTransition transition);
+
+/*
+ * Function:  p7HmmBuildTransposedMatchEmissions
+ * --------------------
+ * Builds the symbol-major copy of the given phmm's match emissions, where the scores of every node for
+ *  one symbol are contiguous. Each symbol's row starts on a 64 byte boundary and is padded with INFINITY
+ *  (a probability of 0) up to a multiple of P7_HMM_TRANSPOSED_ROW_PADDING scores, so loops over the nodes
+ *  for a single residue can use whole vector loads. The copy is kept with the model and freed along with it.
+ *  Does nothing if the copy was already built. p7HmmGetSymbolMatchEmissions builds the copy on first use,
+ *  but since that modifies the model, models shared between threads should be built up front with this function.
+ *
+ *  Inputs:
+ *    phmm: model to build the copy for, with its model data loaded.
+ *
+ *  Returns:
+ *    p7HmmSuccess on success,
+ *    p7HmmFormatError if the model's alphabet or length isn't set, or its model data isn't loaded,
+ *    p7HmmAllocationFailure if the copy could not be allocated.
+ */
+enum P7HmmReturnCode p7HmmBuildTransposedMatchEmissions(struct P7Hmm *phmm);
+
+/*
+ * Function:  p7HmmGetSymbolMatchEmissions
+ * --------------------
+ * Gets the match emission scores of every node for the given symbol, building the transposed copy if needed.
+ *  Score k of the row is equal to p7HmmGetMatchEmissionScore(phmm, k, symbolIndex).
+ *
+ *  Inputs:
+ *    phmm: pointer to the phmm to get the match emission scores from.
+ *    symbolIndex: which symbol of the profile hmm's alphabet to get the scores for.
+ *
+ *  Returns:
+ *    the symbol's row of modelLength scores plus padding, or NULL if symbolIndex is out of range or the
+ *      copy could not be built.
+ */
+const float *p7HmmGetSymbolMatchEmissions(struct P7Hmm *phmm, uint32_t symbolIndex);
+
 #endif
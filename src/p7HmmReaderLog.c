@@ -9,3 +9,7 @@ void printAllocationError(const char *const fileSrc, size_t lineNumber, char *er
   fprintf(stderr, "\033[0;31mHmmReader allocation failure\033[0m:File %s Line %zu.\n", fileSrc, lineNumber);
   fprintf(stderr, "\t%s\n", errorMessage);
 }
+void printFileError(const char *const fileSrc, size_t lineNumber, char *errorMessage){
+  fprintf(stderr, "\033[0;31mHmmReader file error\033[0m:File %s Line %zu.\n", fileSrc, lineNumber);
+  fprintf(stderr, "\t%s\n", errorMessage);
+}
@@ -32,4 +32,18 @@ void printFormatError(const char *const fileSrc, size_t lineNumber, char *errorM
  */
 void printAllocationError(const char *const fileSrc, size_t lineNumber, char *errorMessage);
 
+/*
+ * Function:  printFileError
+ * --------------------
+ * prints an error message detailing a failure to read from a file to stderr.
+ *  this is functionally equivalent to printFormatError, other than the
+ *  type of error in the output error message.
+ *
+ *  Inputs:
+ *    fileSrc: Location of the hmm file that the error occurred in.
+ *    lineNumber: line number where reading failed.
+ *    errormessage: text string describing the failed read.
+ */
+void printFileError(const char *const fileSrc, size_t lineNumber, char *errorMessage);
+
 #endif
@@ -0,0 +1,407 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "p7HmmReader.h"
+#include "p7ProfileHmm.h"
+#include "p7HmmReaderLog.h"
+
+
+#define P7_WRITER_BUFFER_LENGTH (1 << 16)
+//room for the longest line the writer produces: a node index, 20 scores, and the 5 annotation columns,
+//even if every score is a huge value that falls back to snprintf
+#define P7_WRITER_MAX_LINE_LENGTH 2048
+#define P7_WRITER_MAX_FALLBACK_LENGTH 64
+//scaled values at or past this can't be rounded exactly through a double, so they're handed to snprintf
+#define P7_WRITER_MAX_FIXED_VALUE 1e15
+#define P7_SCORE_WIDTH    8
+#define P7_SCORE_DECIMALS 5
+
+
+struct P7TextWriter{
+  FILE *file;
+  char *buffer;
+  size_t length;
+  bool failed;
+};
+
+static const double p7PowersOfTen[7] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6};
+
+
+static void p7WriterFlush(struct P7TextWriter *writer){
+  if(writer->length != 0 && !writer->failed){
+    writer->failed = fwrite(writer->buffer, 1, writer->length, writer->file) != writer->length;
+  }
+  writer->length = 0;
+}
+
+//makes sure there's room for at least P7_WRITER_MAX_LINE_LENGTH more characters, and returns where they go.
+static inline char *p7WriterLine(struct P7TextWriter *writer){
+  if(writer->length + P7_WRITER_MAX_LINE_LENGTH > P7_WRITER_BUFFER_LENGTH){
+    p7WriterFlush(writer);
+  }
+  return writer->buffer + writer->length;
+}
+
+static void p7WriterAppend(struct P7TextWriter *writer, const char *text, const size_t textLength){
+  if(writer->length + textLength > P7_WRITER_BUFFER_LENGTH){
+    p7WriterFlush(writer);
+    //text too long for the buffer (e.g., a huge description) goes straight to the file
+    if(textLength > P7_WRITER_BUFFER_LENGTH){
+      writer->failed |= fwrite(text, 1, textLength, writer->file) != textLength;
+      return;
+    }
+  }
+  memcpy(writer->buffer + writer->length, text, textLength);
+  writer->length += textLength;
+}
+
+static inline void p7WriterAppendString(struct P7TextWriter *writer, const char *text){
+  p7WriterAppend(writer, text, strlen(text));
+}
+
+//writes the value right justified in a field of the given width, like printf's "%*u". Returns the length written.
+static inline size_t p7FormatUint32(char *out, uint32_t value, const size_t width){
+  char digits[10];
+  size_t numDigits = 0;
+  do{
+    digits[numDigits++] = '0' + (value % 10);
+    value /= 10;
+  }while(value != 0);
+  size_t length = 0;
+  while(length + numDigits < width){
+    out[length++] = ' ';
+  }
+  while(numDigits != 0){
+    out[length++] = digits[--numDigits];
+  }
+  return length;
+}
+
+/*
+ * writes the value right justified in a field of the given width, with exactly numDecimals digits
+ *  after the decimal point, producing the same characters as printf's "%*.*f".
+ *  A float times a power of ten up to 10^6 fits exactly in a double's mantissa, so nearbyint rounds the
+ *  true value half to even, the same way glibc rounds it when printing. Returns the length written.
+ */
+static inline size_t p7FormatFixed(char *out, const float value, const uint32_t numDecimals, const size_t width){
+  const double scaledValue = fabs((double)value) * p7PowersOfTen[numDecimals];
+  if(!(scaledValue < P7_WRITER_MAX_FIXED_VALUE)){
+    //catches infinities and NANs too
+    return snprintf(out, P7_WRITER_MAX_FALLBACK_LENGTH, "%*.*f", (int)width, (int)numDecimals, value);
+  }
+  uint64_t roundedValue = (uint64_t)nearbyint(scaledValue);
+  char digits[24];
+  size_t numDigits = 0;
+  do{
+    digits[numDigits++] = '0' + (roundedValue % 10);
+    roundedValue /= 10;
+  }while(roundedValue != 0 || numDigits <= numDecimals);
+
+  const bool isNegative = signbit(value);
+  const size_t valueLength = numDigits + (numDecimals != 0) + isNegative;
+  size_t length = 0;
+  while(length + valueLength < width){
+    out[length++] = ' ';
+  }
+  if(isNegative){
+    out[length++] = '-';
+  }
+  while(numDigits > numDecimals){
+    out[length++] = digits[--numDigits];
+  }
+  if(numDecimals != 0){
+    out[length++] = '.';
+    while(numDigits != 0){
+      out[length++] = digits[--numDigits];
+    }
+  }
+  return length;
+}
+
+//writes a space separated score column, or '*' for a transition that can never be taken.
+static inline size_t p7FormatScore(char *out, const float score){
+  out[0] = ' ';
+  if(isnan(score) || isinf(score)){
+    memset(out + 1, ' ', P7_SCORE_WIDTH - 1);
+    out[P7_SCORE_WIDTH] = '*';
+    return P7_SCORE_WIDTH + 1;
+  }
+  return p7FormatFixed(out + 1, score, P7_SCORE_DECIMALS, P7_SCORE_WIDTH) + 1;
+}
+
+static inline size_t p7FormatScores(char *out, const float *scores, const uint32_t numScores){
+  size_t length = 0;
+  for(uint32_t i = 0; i < numScores; i++){
+    length += p7FormatScore(out + length, scores[i]);
+  }
+  return length;
+}
+
+static const char *p7AlphabetName(const enum P7Alphabet alphabet){
+  switch(alphabet){
+    case P7HmmReaderAlphabetAmino:  return P7_HMM_READER_ALPHABET_AMINO;
+    case P7HmmReaderAlphabetDna:    return P7_HMM_READER_ALPHABET_DNA;
+    case P7HmmReaderAlphabetRna:    return P7_HMM_READER_ALPHABET_RNA;
+    case P7HmmReaderAlphabetCoins:  return P7_HMM_READER_ALPHABET_COINS;
+    case P7HmmReaderAlphabetDice:   return P7_HMM_READER_ALPHABET_DICE;
+    default:                        return NULL;
+  }
+}
+
+static const char *p7AlphabetSymbols(const enum P7Alphabet alphabet){
+  switch(alphabet){
+    case P7HmmReaderAlphabetAmino:  return "ACDEFGHIKLMNPQRSTVWY";
+    case P7HmmReaderAlphabetDna:    return "ACGT";
+    case P7HmmReaderAlphabetRna:    return "ACGU";
+    case P7HmmReaderAlphabetCoins:  return "HT";
+    case P7HmmReaderAlphabetDice:   return "123456";
+    default:                        return NULL;
+  }
+}
+
+static void p7WriteTextLine(struct P7TextWriter *writer, const char *tag, const char *text){
+  p7WriterAppendString(writer, tag);
+  p7WriterAppendString(writer, text);
+  p7WriterAppend(writer, "\n", 1);
+}
+
+static void p7WriteYesNoLine(struct P7TextWriter *writer, const char *tag, const bool value){
+  p7WriteTextLine(writer, tag, value? "yes": "no");
+}
+
+static void p7WriteUint32Line(struct P7TextWriter *writer, const char *tag, const uint32_t value){
+  char *line = p7WriterLine(writer);
+  const size_t tagLength = strlen(tag);
+  memcpy(line, tag, tagLength);
+  size_t length = tagLength + p7FormatUint32(line + tagLength, value, 0);
+  line[length++] = '\n';
+  writer->length += length;
+}
+
+//cutoffs are written the way Pfam writes them, in the shortest form that reads back as the same value
+static void p7WriteCutoffLine(struct P7TextWriter *writer, const char *tag, const float cutoffs[2]){
+  if(cutoffs[0] == 0 && cutoffs[1] == 0){
+    return;
+  }
+  char *line = p7WriterLine(writer);
+  writer->length += snprintf(line, P7_WRITER_MAX_LINE_LENGTH, "%s%g %g;\n", tag, cutoffs[0], cutoffs[1]);
+}
+
+static void p7WriteStatsLine(struct P7TextWriter *writer, const char *tag, const float mu, const float lambda){
+  char *line = p7WriterLine(writer);
+  const size_t tagLength = strlen(tag);
+  memcpy(line, tag, tagLength);
+  size_t length = tagLength;
+  line[length++] = ' ';
+  length += p7FormatFixed(line + length, mu, 4, 8);
+  line[length++] = ' ';
+  length += p7FormatFixed(line + length, lambda, 5, 8);
+  line[length++] = '\n';
+  writer->length += length;
+}
+
+//the command history is stored one line per COM line, each still starting with its "[n]" number
+static void p7WriteCommandHistory(struct P7TextWriter *writer, const char *history){
+  while(history != NULL){
+    const char *lineEnd = strchr(history, '\n');
+    const size_t lineLength = lineEnd == NULL? strlen(history): (size_t)(lineEnd - history);
+    p7WriterAppendString(writer, "COM   ");
+    p7WriterAppend(writer, history, lineLength);
+    p7WriterAppend(writer, "\n", 1);
+    history = lineEnd == NULL? NULL: lineEnd + 1;
+  }
+}
+
+static void p7WriteHeader(struct P7TextWriter *writer, const struct P7Hmm *phmm){
+  const struct P7Header *header = &phmm->header;
+  p7WriteTextLine(writer, "", header->version != NULL? header->version: "HMMER3/f");
+  p7WriteTextLine(writer, "NAME  ", header->name != NULL? header->name: "none_given");
+  if(header->accessionNumber != NULL){
+    p7WriteTextLine(writer, "ACC   ", header->accessionNumber);
+  }
+  if(header->description != NULL){
+    p7WriteTextLine(writer, "DESC  ", header->description);
+  }
+  p7WriteUint32Line(writer, "LENG  ", header->modelLength);
+  if(header->maxLength != 0){
+    p7WriteUint32Line(writer, "MAXL  ", header->maxLength);
+  }
+  p7WriteTextLine(writer, "ALPH  ", p7AlphabetName(header->alphabet));
+  p7WriteYesNoLine(writer, "RF    ", header->hasReferenceAnnotation);
+  p7WriteYesNoLine(writer, "MM    ", header->hasModelMask);
+  p7WriteYesNoLine(writer, "CONS  ", header->hasConsensusResidue);
+  p7WriteYesNoLine(writer, "CS    ", header->hasConsensusStructure);
+  p7WriteYesNoLine(writer, "MAP   ", header->hasMapAnnotation);
+  if(header->date != NULL){
+    p7WriteTextLine(writer, "DATE  ", header->date);
+  }
+  p7WriteCommandHistory(writer, header->commandLineHistory);
+  if(header->numSequences != 0){
+    p7WriteUint32Line(writer, "NSEQ  ", header->numSequences);
+  }
+  if(header->effectiveNumSequences != 0){
+    char *line = p7WriterLine(writer);
+    memcpy(line, "EFFN  ", 6);
+    size_t length = 6 + p7FormatFixed(line + 6, header->effectiveNumSequences, 6, 0);
+    line[length++] = '\n';
+    writer->length += length;
+  }
+  if(header->checksum != 0){
+    p7WriteUint32Line(writer, "CKSUM ", header->checksum);
+  }
+  p7WriteCutoffLine(writer, "GA    ", header->gatheringThresholds);
+  p7WriteCutoffLine(writer, "TC    ", header->trustedCutoffs);
+  p7WriteCutoffLine(writer, "NC    ", header->noiseCutoffs);
+  if(header->buildCommand != NULL){
+    p7WriteTextLine(writer, "BM    ", header->buildCommand);
+  }
+  if(header->searchCommand != NULL){
+    p7WriteTextLine(writer, "SM    ", header->searchCommand);
+  }
+  const struct P7Stats *stats = &phmm->stats;
+  if(stats->msvGumbelMu != 0 || stats->msvGumbelLambda != 0 || stats->viterbiGumbelMu != 0 ||
+    stats->viterbiGumbelLambda != 0 || stats->forwardTau != 0 || stats->forwardLambda != 0){
+    p7WriteStatsLine(writer, "STATS LOCAL MSV     ", stats->msvGumbelMu, stats->msvGumbelLambda);
+    p7WriteStatsLine(writer, "STATS LOCAL VITERBI ", stats->viterbiGumbelMu, stats->viterbiGumbelLambda);
+    p7WriteStatsLine(writer, "STATS LOCAL FORWARD ", stats->forwardTau, stats->forwardLambda);
+  }
+}
+
+static void p7WriteModel(struct P7TextWriter *writer, const struct P7Hmm *phmm){
+  const struct P7Header *header = &phmm->header;
+  const struct P7Model *model = &phmm->model;
+  const struct P7StateTransitions *transitions = &model->stateTransitions;
+  const uint32_t alphabetCardinality = p7HmmGetAlphabetCardinality(phmm);
+  const char *symbols = p7AlphabetSymbols(header->alphabet);
+
+  char *line = p7WriterLine(writer);
+  size_t length = 0;
+  memcpy(line, "HMM     ", 8);
+  length += 8;
+  for(uint32_t i = 0; i < alphabetCardinality; i++){
+    memcpy(line + length, "     ", 5);
+    line[length + 5] = symbols[i];
+    memcpy(line + length + 6, "   ", 3);
+    length += 9;
+  }
+  line[length++] = '\n';
+  writer->length += length;
+  p7WriterAppendString(writer, "            m->m     m->i     m->d     i->m     i->i     d->m     d->d\n");
+
+  if(model->compo != NULL){
+    line = p7WriterLine(writer);
+    memcpy(line, "  COMPO ", 8);
+    length = 8 + p7FormatScores(line + 8, model->compo, alphabetCardinality);
+    line[length++] = '\n';
+    writer->length += length;
+  }
+
+  line = p7WriterLine(writer);
+  memset(line, ' ', 8);
+  length = 8 + p7FormatScores(line + 8, model->insert0Emissions, alphabetCardinality);
+  line[length++] = '\n';
+  writer->length += length;
+
+  //the last two initial transitions (D0 -> M1 and D0 -> D1) don't exist, and are always written as 0 and '*'
+  const float initialTransitions[7] = {model->initialTransitions.beginToM1, model->initialTransitions.beginToInsert0,
+    model->initialTransitions.beginToDelete1, model->initialTransitions.insert0ToMatch1,
+    model->initialTransitions.insert0ToInsert0, 0.0f, INFINITY};
+  line = p7WriterLine(writer);
+  memset(line, ' ', 8);
+  length = 8 + p7FormatScores(line + 8, initialTransitions, 7);
+  line[length++] = '\n';
+  writer->length += length;
+
+  for(uint32_t node = 0; node < header->modelLength; node++){
+    //match emission line, with the optional annotation columns
+    line = p7WriterLine(writer);
+    line[0] = ' ';
+    length = 1 + p7FormatUint32(line + 1, node + 1, 6);
+    line[length++] = ' ';
+    length += p7FormatScores(line + length, &model->matchEmissionScores[node * alphabetCardinality], alphabetCardinality);
+    line[length++] = ' ';
+    if(header->hasMapAnnotation && model->mapAnnotations != NULL){
+      length += p7FormatUint32(line + length, model->mapAnnotations[node], 6);
+    }
+    else{
+      memcpy(line + length, "     -", 6);
+      length += 6;
+    }
+    const bool hasConsensus = header->hasConsensusResidue && model->consensusResidues != NULL;
+    const bool hasReference = header->hasReferenceAnnotation && model->referenceAnnotation != NULL;
+    const bool hasMask = header->hasModelMask && model->modelMask != NULL;
+    const bool hasStructure = header->hasConsensusStructure && model->consensusStructure != NULL;
+    line[length] = ' ';
+    line[length + 1] = hasConsensus? model->consensusResidues[node]: '-';
+    line[length + 2] = ' ';
+    line[length + 3] = hasReference? model->referenceAnnotation[node]: '-';
+    line[length + 4] = ' ';
+    //with a mask, HMMER marks the unmasked nodes with '.', and only models without one get '-'
+    line[length + 5] = hasMask? (model->modelMask[node]? 'm': '.'): '-';
+    line[length + 6] = ' ';
+    line[length + 7] = hasStructure? model->consensusStructure[node]: '-';
+    line[length + 8] = '\n';
+    writer->length += length + 9;
+
+    line = p7WriterLine(writer);
+    memset(line, ' ', 8);
+    length = 8 + p7FormatScores(line + 8, p7HmmGetInsertEmissionRow(phmm, node), alphabetCardinality);
+    line[length++] = '\n';
+    writer->length += length;
+
+    const float nodeTransitions[7] = {transitions->matchToMatch[node], transitions->matchToInsert[node],
+      transitions->matchToDelete[node], transitions->insertToMatch[node], transitions->insertToInsert[node],
+      transitions->deleteToMatch[node], transitions->deleteToDelete[node]};
+    line = p7WriterLine(writer);
+    memset(line, ' ', 8);
+    length = 8 + p7FormatScores(line + 8, nodeTransitions, 7);
+    line[length++] = '\n';
+    writer->length += length;
+  }
+  p7WriterAppend(writer, "//\n", 3);
+}
+
+static enum P7HmmReturnCode p7WriteHmms(const struct P7Hmm *phmms, const uint32_t numPhmms, FILE *file){
+  struct P7TextWriter writer = {.file = file, .buffer = malloc(P7_WRITER_BUFFER_LENGTH), .length = 0, .failed = false};
+  if(writer.buffer == NULL){
+    printAllocationError("(writer)", 0, "failed to allocate memory for the hmm writer's buffer.");
+    return p7HmmAllocationFailure;
+  }
+  enum P7HmmReturnCode returnCode = p7HmmSuccess;
+  for(uint32_t i = 0; i < numPhmms; i++){
+    const struct P7Hmm *phmm = &phmms[i];
+    //the body can't be written without an alphabet, or without model data (including skipped insert emissions)
+    if(p7AlphabetSymbols(phmm->header.alphabet) == NULL || phmm->model.matchEmissionScores == NULL ||
+      (phmm->model.insertEmissionScores == NULL && phmm->model.insertRowIndices == NULL)){
+      printFormatError("(writer)", 0, "can't write a model without an alphabet or model data.");
+      returnCode = p7HmmFormatError;
+      break;
+    }
+    p7WriteHeader(&writer, phmm);
+    p7WriteModel(&writer, phmm);
+  }
+  p7WriterFlush(&writer);
+  free(writer.buffer);
+  if(returnCode == p7HmmSuccess && writer.failed){
+    returnCode = p7HmmFileNotFound;
+  }
+  return returnCode;
+}
+
+
+enum P7HmmReturnCode p7HmmWrite(const struct P7Hmm *phmm, FILE *file){
+  return p7WriteHmms(phmm, 1, file);
+}
+
+enum P7HmmReturnCode p7HmmListWrite(const struct P7HmmList *phmmList, const char *const fileSrc){
+  FILE *file = fopen(fileSrc, "w");
+  if(file == NULL){
+    return p7HmmFileNotFound;
+  }
+  enum P7HmmReturnCode returnCode = p7WriteHmms(phmmList->phmms, phmmList->count, file);
+  if(fclose(file) != 0 && returnCode == p7HmmSuccess){
+    returnCode = p7HmmFileNotFound;
+  }
+  return returnCode;
+}
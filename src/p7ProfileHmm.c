@@ -1,26 +1,42 @@
 #include "p7ProfileHmm.h"
+#include "p7HmmArena.h"
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 
 void p7HmmListInit(struct P7HmmList *phmmList){
   phmmList->phmms = NULL;
   phmmList->count = 0;
+  phmmList->capacity = 0;
+  phmmList->arena = NULL;
 }
 
 //returns NULL on error
 struct P7Hmm *p7HmmListAppendHmm(struct P7HmmList *phmmList){
-  void *profileHmmListPointer = realloc(phmmList->phmms, sizeof(struct P7Hmm) * (phmmList->count + 1));
-  if(profileHmmListPointer == NULL){
-    return NULL;
-  }
-  else{
+  if(phmmList->count == phmmList->capacity){
+    //grow geometrically, so appending n models only copies the array O(log n) times
+    const uint32_t grownCapacity = phmmList->capacity == 0? P7_LIST_INITIAL_CAPACITY:
+      phmmList->capacity > UINT32_MAX / 2? UINT32_MAX: phmmList->capacity * 2;
+    if(grownCapacity == phmmList->count){
+      return NULL;
+    }
+    void *profileHmmListPointer = realloc(phmmList->phmms, sizeof(struct P7Hmm) * (size_t)grownCapacity);
+    if(profileHmmListPointer == NULL){
+      return NULL;
+    }
     phmmList->phmms = profileHmmListPointer;
-    p7HmmInit(&phmmList->phmms[phmmList->count]);  //initialize the newly allocated phmm.
-    struct P7Hmm *newlyAllocatedPhmm = &phmmList->phmms[phmmList->count];
-    phmmList->count++;
-    return newlyAllocatedPhmm;
+    phmmList->capacity = grownCapacity;
   }
+  p7HmmInit(&phmmList->phmms[phmmList->count]);  //initialize the newly allocated phmm.
+  struct P7Hmm *newlyAllocatedPhmm = &phmmList->phmms[phmmList->count];
+  phmmList->count++;
+  return newlyAllocatedPhmm;
+}
+
+static void p7ClearQuantizedScores(struct P7QuantizedScores *quantized){
+  memset(quantized, 0, sizeof(struct P7QuantizedScores));
+  quantized->precision = p7HmmPrecisionFloat;
 }
 
 void p7HmmInit(struct P7Hmm *phmm){
@@ -41,6 +57,8 @@ void p7HmmInit(struct P7Hmm *phmm){
   phmm->header.description = NULL;
   phmm->header.date = NULL;
   phmm->header.commandLineHistory = NULL;
+  phmm->header.buildCommand = NULL;
+  phmm->header.searchCommand = NULL;
   phmm->header.gatheringThresholds[0] = 0.0f;
   phmm->header.gatheringThresholds[1] = 0.0f;
   phmm->header.trustedCutoffs[0] = 0.0f;
@@ -60,6 +78,9 @@ void p7HmmInit(struct P7Hmm *phmm){
   phmm->model.initialTransitions.beginToDelete1 = 0;
   phmm->model.matchEmissionScores = NULL;
   phmm->model.insertEmissionScores = NULL;
+  phmm->model.uniqueInsertEmissions = NULL;
+  phmm->model.insertRowIndices = NULL;
+  phmm->model.numUniqueInsertRows = 0;
   phmm->model.stateTransitions.matchToMatch = NULL;
   phmm->model.stateTransitions.matchToInsert = NULL;
   phmm->model.stateTransitions.matchToDelete = NULL;
@@ -72,6 +93,9 @@ void p7HmmInit(struct P7Hmm *phmm){
   phmm->model.referenceAnnotation = NULL;
   phmm->model.modelMask = NULL;
   phmm->model.consensusStructure = NULL;
+  phmm->model.transposedMatchEmissions = NULL;
+  p7ClearQuantizedScores(&phmm->model.quantized);
+  phmm->model.arena = NULL;
 }
 
 void p7HmmDealloc(struct P7Hmm *phmm){
@@ -80,31 +104,37 @@ void p7HmmDealloc(struct P7Hmm *phmm){
   free(phmm->header.accessionNumber);
   free(phmm->header.description);
   free(phmm->header.date);
-  free(phmm->model.compo);
-  free(phmm->model.insert0Emissions);
-  free(phmm->model.matchEmissionScores);
-  free(phmm->model.insertEmissionScores);
-  free(phmm->model.stateTransitions.matchToMatch);
-  free(phmm->model.stateTransitions.matchToInsert);
-  free(phmm->model.stateTransitions.matchToDelete);
-  free(phmm->model.stateTransitions.insertToMatch);
-  free(phmm->model.stateTransitions.insertToInsert);
-  free(phmm->model.stateTransitions.deleteToMatch);
-  free(phmm->model.stateTransitions.deleteToDelete);
-  free(phmm->model.mapAnnotations);
-  free(phmm->model.consensusResidues);
-  free(phmm->model.referenceAnnotation);
-  free(phmm->model.modelMask);
-  free(phmm->model.consensusStructure);
+  free(phmm->header.commandLineHistory);
+  free(phmm->header.buildCommand);
+  free(phmm->header.searchCommand);
   phmm->header.version = NULL;
   phmm->header.name = NULL;
   phmm->header.accessionNumber = NULL;
   phmm->header.description = NULL;
   phmm->header.date = NULL;
+  phmm->header.commandLineHistory = NULL;
+  phmm->header.buildCommand = NULL;
+  phmm->header.searchCommand = NULL;
+  p7HmmDeallocModelData(phmm);
+}
+
+void p7HmmDeallocModelData(struct P7Hmm *phmm){
+  //every model array lives in the one block that starts with insert0Emissions
+  free(phmm->model.insert0Emissions);
+  free(phmm->model.transposedMatchEmissions);
+  free(phmm->model.uniqueInsertEmissions);
+  free(phmm->model.insertRowIndices);
+  p7HmmDetachModelData(phmm);
+}
+
+void p7HmmDetachModelData(struct P7Hmm *phmm){
   phmm->model.compo = NULL;
   phmm->model.insert0Emissions = NULL;
   phmm->model.matchEmissionScores = NULL;
   phmm->model.insertEmissionScores = NULL;
+  phmm->model.uniqueInsertEmissions = NULL;
+  phmm->model.insertRowIndices = NULL;
+  phmm->model.numUniqueInsertRows = 0;
   phmm->model.stateTransitions.matchToMatch = NULL;
   phmm->model.stateTransitions.matchToInsert = NULL;
   phmm->model.stateTransitions.matchToDelete = NULL;
@@ -117,15 +147,54 @@ void p7HmmDealloc(struct P7Hmm *phmm){
   phmm->model.referenceAnnotation = NULL;
   phmm->model.modelMask = NULL;
   phmm->model.consensusStructure = NULL;
+  phmm->model.transposedMatchEmissions = NULL;
+  p7ClearQuantizedScores(&phmm->model.quantized);
 }
 
 void p7HmmListDealloc(struct P7HmmList *phmmList){
-  for(size_t i = 0; i < phmmList->count; i++){
-    p7HmmDealloc(&phmmList->phmms[i]);
+  if(phmmList->arena != NULL){
+    //every model's data and strings live in the arena, but transposed copies and compacted insert rows don't
+    for(size_t i = 0; i < phmmList->count; i++){
+      free(phmmList->phmms[i].model.transposedMatchEmissions);
+      free(phmmList->phmms[i].model.uniqueInsertEmissions);
+      free(phmmList->phmms[i].model.insertRowIndices);
+    }
+    p7HmmArenaDestroy(phmmList->arena);
+  }
+  else{
+    for(size_t i = 0; i < phmmList->count; i++){
+      p7HmmDealloc(&phmmList->phmms[i]);
+    }
   }
   free(phmmList->phmms);
-  phmmList->phmms = NULL;
-  phmmList->count = 0;
+  p7HmmListInit(phmmList);
+}
+
+enum P7HmmReturnCode p7HmmListConcatenate(struct P7HmmList *phmmList, struct P7HmmList *sourceLists,
+  const uint32_t numSourceLists){
+  size_t totalModels = phmmList->count;
+  for(uint32_t i = 0; i < numSourceLists; i++){
+    totalModels += sourceLists[i].count;
+  }
+  if(totalModels != phmmList->count){
+    struct P7Hmm *grownPhmms = realloc(phmmList->phmms, totalModels * sizeof(struct P7Hmm));
+    if(grownPhmms == NULL){
+      return p7HmmAllocationFailure;
+    }
+    phmmList->phmms = grownPhmms;
+    phmmList->capacity = totalModels;
+  }
+  for(uint32_t i = 0; i < numSourceLists; i++){
+    if(sourceLists[i].count != 0){
+      memcpy(&phmmList->phmms[phmmList->count], sourceLists[i].phmms, sourceLists[i].count * sizeof(struct P7Hmm));
+      phmmList->count += sourceLists[i].count;
+    }
+    free(sourceLists[i].phmms);
+    sourceLists[i].phmms = NULL;
+    sourceLists[i].count = 0;
+    sourceLists[i].capacity = 0;
+  }
+  return p7HmmSuccess;
 }
 
 //returns 0 if the alphabet type is unsupported or unset
@@ -140,64 +209,126 @@ uint32_t p7HmmGetAlphabetCardinality(const struct P7Hmm *const currentPhmm){
   }
 }
 
-//allocates model arrays for the given phmm, based on its header data.
-//the application must know the alphabet being used in order to allocate memory correctly,
-//so this will likely be done after reading the header.
-enum P7HmmReturnCode p7HmmAllocateModelData(struct P7Hmm *currentPhmm){
+static inline size_t p7AlignModelData(const size_t length){
+  return (length + P7_MODEL_DATA_ALIGNMENT - 1) & ~(size_t)(P7_MODEL_DATA_ALIGNMENT - 1);
+}
+
+//lays out the model's data block, with scoreSize bytes per emission and transition score. The annotation arrays
+//are set in the model, and the score arrays are returned through matchScores, insertScores, and transitions.
+static enum P7HmmReturnCode p7AllocateModelBlock(struct P7Hmm *currentPhmm, const bool allocateInsertEmissions,
+  struct P7HmmArena *arena, const size_t scoreSize, void **matchScores, void **insertScores, void **transitions){
   const uint32_t alphabetCardinality = p7HmmGetAlphabetCardinality(currentPhmm);
-  const uint32_t modelLength = currentPhmm->header.modelLength;
+  const size_t modelLength = currentPhmm->header.modelLength;
   if(alphabetCardinality == 0){
     return p7HmmFormatError;
   }
   if(modelLength == 0){
     return p7HmmFormatError;
   }
-  currentPhmm->model.insert0Emissions       = malloc(alphabetCardinality * sizeof(float));
-  currentPhmm->model.matchEmissionScores    = malloc(alphabetCardinality * sizeof(float) * modelLength);
-  currentPhmm->model.insertEmissionScores   = malloc(alphabetCardinality * sizeof(float) * modelLength);
-  currentPhmm->model.stateTransitions.matchToMatch    = malloc(sizeof(float) * modelLength);
-  currentPhmm->model.stateTransitions.matchToInsert   = malloc(sizeof(float) * modelLength);
-  currentPhmm->model.stateTransitions.matchToDelete   = malloc(sizeof(float) * modelLength);
-  currentPhmm->model.stateTransitions.insertToMatch   = malloc(sizeof(float) * modelLength);
-  currentPhmm->model.stateTransitions.insertToInsert  = malloc(sizeof(float) * modelLength);
-  currentPhmm->model.stateTransitions.deleteToMatch   = malloc(sizeof(float) * modelLength);
-  currentPhmm->model.stateTransitions.deleteToDelete  = malloc(sizeof(float) * modelLength);
-
-  //bitwise OR the allocated arrays togeter to determine if the allocation suceeded
-  bool majorAllocationsSuccessful = currentPhmm->model.insert0Emissions != NULL &&
-    currentPhmm->model.matchEmissionScores != NULL && currentPhmm->model.insertEmissionScores != NULL &&
-    currentPhmm->model.stateTransitions.matchToMatch != NULL && currentPhmm->model.stateTransitions.matchToInsert != NULL &&
-    currentPhmm->model.stateTransitions.matchToDelete != NULL && currentPhmm->model.stateTransitions.insertToMatch != NULL &&
-    currentPhmm->model.stateTransitions.insertToInsert != NULL && currentPhmm->model.stateTransitions.deleteToMatch != NULL &&
-    currentPhmm->model.stateTransitions.deleteToDelete != NULL;
-
-    if(currentPhmm->header.hasReferenceAnnotation){
-      currentPhmm->model.referenceAnnotation = malloc(sizeof(char) * modelLength);
-      majorAllocationsSuccessful &= (currentPhmm->model.referenceAnnotation != NULL);
-    }
-    if(currentPhmm->header.hasModelMask){
-      currentPhmm->model.modelMask = malloc(sizeof(bool) * modelLength);
-      majorAllocationsSuccessful &= (currentPhmm->model.modelMask != NULL);
-    }
-    if(currentPhmm->header.hasConsensusResidue){
-      currentPhmm->model.consensusResidues = malloc(sizeof(char) * modelLength);
-      majorAllocationsSuccessful &= (currentPhmm->model.consensusResidues != NULL);
-    }
-    if(currentPhmm->header.hasConsensusStructure){
-      currentPhmm->model.consensusStructure = malloc(sizeof(char) * modelLength);
-      majorAllocationsSuccessful &= (currentPhmm->model.consensusStructure != NULL);
-    }
-    if(currentPhmm->header.hasMapAnnotation){
-      currentPhmm->model.mapAnnotations = malloc(sizeof(uint32_t) * modelLength);
-      majorAllocationsSuccessful &= (currentPhmm->model.mapAnnotations != NULL);
-    }
 
-  if(majorAllocationsSuccessful){
-    return p7HmmSuccess;
-  }
-  else{
+  //lay out every array in one block, each starting on its own aligned boundary. Room for compo is always
+  //reserved right after insert0Emissions, since it's only known to be present once the COMPO line is read.
+  const size_t rowLength = p7AlignModelData(alphabetCardinality * sizeof(float));
+  const size_t emissionsLength = p7AlignModelData(alphabetCardinality * scoreSize * modelLength);
+  const size_t transitionLength = p7AlignModelData(scoreSize * modelLength);
+  const size_t annotationLength = p7AlignModelData(modelLength);
+  const struct P7Header *header = &currentPhmm->header;
+  size_t blockLength = 2 * rowLength + emissionsLength + 7 * transitionLength;
+  blockLength += allocateInsertEmissions?       emissionsLength: 0;
+  blockLength += header->hasMapAnnotation?      p7AlignModelData(sizeof(uint32_t) * modelLength): 0;
+  blockLength += header->hasConsensusResidue?   annotationLength: 0;
+  blockLength += header->hasReferenceAnnotation? annotationLength: 0;
+  blockLength += header->hasModelMask?          p7AlignModelData(sizeof(bool) * modelLength): 0;
+  blockLength += header->hasConsensusStructure? annotationLength: 0;
+
+  char *block = arena != NULL? p7HmmArenaAlloc(arena, blockLength): aligned_alloc(P7_MODEL_DATA_ALIGNMENT, blockLength);
+  if(block == NULL){
     return p7HmmAllocationFailure;
   }
+  struct P7Model *model = &currentPhmm->model;
+  model->arena = arena;
+  model->insert0Emissions = (float*)block;
+  block += 2 * rowLength;
+  *matchScores = block;
+  block += emissionsLength;
+  if(allocateInsertEmissions){
+    *insertScores = block;
+    block += emissionsLength;
+  }
+  for(uint32_t i = 0; i < 7; i++){
+    transitions[i] = block;
+    block += transitionLength;
+  }
+  if(header->hasMapAnnotation){
+    model->mapAnnotations = (uint32_t*)block;
+    block += p7AlignModelData(sizeof(uint32_t) * modelLength);
+  }
+  if(header->hasModelMask){
+    model->modelMask = (bool*)block;
+    block += p7AlignModelData(sizeof(bool) * modelLength);
+  }
+  if(header->hasConsensusResidue){
+    model->consensusResidues = block;
+    block += annotationLength;
+  }
+  if(header->hasReferenceAnnotation){
+    model->referenceAnnotation = block;
+    block += annotationLength;
+  }
+  if(header->hasConsensusStructure){
+    model->consensusStructure = block;
+  }
+  return p7HmmSuccess;
+}
+
+static inline size_t p7TransposedRowLength(const size_t modelLength){
+  return (modelLength + P7_HMM_TRANSPOSED_ROW_PADDING - 1) & ~(size_t)(P7_HMM_TRANSPOSED_ROW_PADDING - 1);
+}
+
+//allocates model arrays for the given phmm, based on its header data.
+//the application must know the alphabet being used in order to allocate memory correctly,
+//so this will likely be done after reading the header.
+enum P7HmmReturnCode p7HmmAllocateModelData(struct P7Hmm *currentPhmm, const bool allocateInsertEmissions,
+  struct P7HmmArena *arena){
+  void *matchScores;
+  void *insertScores = NULL;
+  void *transitions[7];
+  enum P7HmmReturnCode returnCode = p7AllocateModelBlock(currentPhmm, allocateInsertEmissions, arena, sizeof(float),
+    &matchScores, &insertScores, transitions);
+  if(returnCode != p7HmmSuccess){
+    return returnCode;
+  }
+  struct P7Model *model = &currentPhmm->model;
+  model->matchEmissionScores = matchScores;
+  if(allocateInsertEmissions){
+    model->insertEmissionScores = insertScores;
+  }
+  model->stateTransitions.matchToMatch = transitions[p7HmmMatchToMatch];
+  model->stateTransitions.matchToInsert = transitions[p7HmmMatchToInsert];
+  model->stateTransitions.matchToDelete = transitions[p7HmmMatchToDelete];
+  model->stateTransitions.insertToMatch = transitions[p7HmmInsertToMatch];
+  model->stateTransitions.insertToInsert = transitions[p7HmmInsertToInsert];
+  model->stateTransitions.deleteToMatch = transitions[p7HmmDeleteToMatch];
+  model->stateTransitions.deleteToDelete = transitions[p7HmmDeleteToDelete];
+  return p7HmmSuccess;
+}
+
+enum P7HmmReturnCode p7HmmAllocateQuantizedModelData(struct P7Hmm *currentPhmm, const bool allocateInsertEmissions,
+  struct P7HmmArena *arena, const enum P7HmmScorePrecision precision){
+  const size_t scoreSize = precision == p7HmmPrecisionByte? sizeof(uint8_t): sizeof(uint16_t);
+  struct P7QuantizedScores *quantized = &currentPhmm->model.quantized;
+  enum P7HmmReturnCode returnCode = p7AllocateModelBlock(currentPhmm, allocateInsertEmissions, arena, scoreSize,
+    &quantized->matchEmissionScores, &quantized->insertEmissionScores, quantized->transitions);
+  if(returnCode == p7HmmSuccess){
+    quantized->precision = precision;
+  }
+  return returnCode;
+}
+
+float *p7HmmAttachCompo(struct P7Hmm *phmm){
+  const uint32_t alphabetCardinality = p7HmmGetAlphabetCardinality(phmm);
+  phmm->model.compo = (float*)((char*)phmm->model.insert0Emissions + p7AlignModelData(alphabetCardinality * sizeof(float)));
+  return phmm->model.compo;
 }
 
 float p7HmmGetMatchEmissionScore(const struct P7Hmm *const phmm, uint32_t nodeIndex, uint32_t symbolIndex){
@@ -205,6 +336,10 @@ float p7HmmGetMatchEmissionScore(const struct P7Hmm *const phmm, uint32_t nodeIn
   if((symbolIndex >= alphabetCardinality) || (nodeIndex >= phmm->header.modelLength)){
     return NAN;
   }
+  else if(phmm->model.matchEmissionScores == NULL){
+    return p7HmmDecodeQuantizedScore(&phmm->model.quantized, phmm->model.quantized.matchEmissionScores,
+      (nodeIndex * alphabetCardinality) + symbolIndex);
+  }
   else{
     return phmm->model.matchEmissionScores[(nodeIndex * alphabetCardinality) + symbolIndex];
   }
@@ -215,7 +350,76 @@ float p7HmmGetInsertEmissionScores(const struct P7Hmm *const phmm, uint32_t node
   if((symbolIndex >= alphabetCardinality) || (nodeIndex >= phmm->header.modelLength)){
     return NAN;
   }
-  else{
-    return phmm->model.insertEmissionScores[(nodeIndex * alphabetCardinality) + symbolIndex];
+  const float *insertRow = p7HmmGetInsertEmissionRow(phmm, nodeIndex);
+  if(insertRow != NULL){
+    return insertRow[symbolIndex];
+  }
+  //NaN if the model has no insert emissions at all
+  return p7HmmDecodeQuantizedScore(&phmm->model.quantized, phmm->model.quantized.insertEmissionScores,
+    (nodeIndex * alphabetCardinality) + symbolIndex);
+}
+
+const float *p7HmmGetInsertEmissionRow(const struct P7Hmm *const phmm, const uint32_t nodeIndex){
+  const uint32_t alphabetCardinality = p7HmmGetAlphabetCardinality(phmm);
+  if(phmm->model.insertEmissionScores != NULL){
+    return &phmm->model.insertEmissionScores[(size_t)nodeIndex * alphabetCardinality];
+  }
+  if(phmm->model.insertRowIndices != NULL){
+    return &phmm->model.uniqueInsertEmissions[(size_t)phmm->model.insertRowIndices[nodeIndex] * alphabetCardinality];
+  }
+  return NULL;
+}
+
+float p7HmmGetTransitionScore(const struct P7Hmm *const phmm, uint32_t nodeIndex, enum P7HmmTransition transition){
+  if(nodeIndex >= phmm->header.modelLength || (uint32_t)transition >= 7){
+    return NAN;
+  }
+  const struct P7StateTransitions *stateTransitions = &phmm->model.stateTransitions;
+  const float *const transitions[7] = {
+    [p7HmmMatchToMatch] = stateTransitions->matchToMatch,
+    [p7HmmMatchToInsert] = stateTransitions->matchToInsert,
+    [p7HmmMatchToDelete] = stateTransitions->matchToDelete,
+    [p7HmmInsertToMatch] = stateTransitions->insertToMatch,
+    [p7HmmInsertToInsert] = stateTransitions->insertToInsert,
+    [p7HmmDeleteToMatch] = stateTransitions->deleteToMatch,
+    [p7HmmDeleteToDelete] = stateTransitions->deleteToDelete};
+  if(transitions[transition] != NULL){
+    return transitions[transition][nodeIndex];
+  }
+  return p7HmmDecodeQuantizedScore(&phmm->model.quantized, phmm->model.quantized.transitions[transition], nodeIndex);
+}
+
+enum P7HmmReturnCode p7HmmBuildTransposedMatchEmissions(struct P7Hmm *phmm){
+  if(phmm->model.transposedMatchEmissions != NULL){
+    return p7HmmSuccess;
+  }
+  const uint32_t alphabetCardinality = p7HmmGetAlphabetCardinality(phmm);
+  const size_t modelLength = phmm->header.modelLength;
+  if(alphabetCardinality == 0 || modelLength == 0 || phmm->model.matchEmissionScores == NULL){
+    return p7HmmFormatError;
+  }
+  const size_t rowLength = p7TransposedRowLength(modelLength);
+  float *transposed = aligned_alloc(P7_MODEL_DATA_ALIGNMENT, rowLength * alphabetCardinality * sizeof(float));
+  if(transposed == NULL){
+    return p7HmmAllocationFailure;
+  }
+  const float *matchEmissionScores = phmm->model.matchEmissionScores;
+  for(uint32_t symbolIndex = 0; symbolIndex < alphabetCardinality; symbolIndex++){
+    float *row = transposed + symbolIndex * rowLength;
+    for(size_t nodeIndex = 0; nodeIndex < modelLength; nodeIndex++){
+      row[nodeIndex] = matchEmissionScores[nodeIndex * alphabetCardinality + symbolIndex];
+    }
+    for(size_t nodeIndex = modelLength; nodeIndex < rowLength; nodeIndex++){
+      row[nodeIndex] = INFINITY;
+    }
+  }
+  phmm->model.transposedMatchEmissions = transposed;
+  return p7HmmSuccess;
+}
+
+const float *p7HmmGetSymbolMatchEmissions(struct P7Hmm *phmm, uint32_t symbolIndex){
+  if(symbolIndex >= p7HmmGetAlphabetCardinality(phmm) || p7HmmBuildTransposedMatchEmissions(phmm) != p7HmmSuccess){
+    return NULL;
   }
+  return phmm->model.transposedMatchEmissions + symbolIndex * p7TransposedRowLength(phmm->header.modelLength);
 }
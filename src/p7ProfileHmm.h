@@ -6,6 +6,12 @@
 #include "p7HmmReader.h"
 
 
+//every array in a model's data block starts on a boundary of this many bytes, e.g., for aligned SIMD loads
+#define P7_MODEL_DATA_ALIGNMENT 64
+//number of models a list has room for after its first append, doubled each time it fills up
+#define P7_LIST_INITIAL_CAPACITY 16
+
+
 /*
  * Function:  p7HmmListInit
  * --------------------
@@ -41,11 +47,34 @@ void p7HmmInit(struct P7Hmm *phmm);
  */
 void p7HmmDealloc(struct P7Hmm *phmm);
 
+/*
+ * Function:  p7HmmDeallocModelData
+ * --------------------
+ * Deallocates only the model arrays (the block allocated by p7HmmAllocateModelData, which includes compo),
+ *  and sets their pointers to NULL. The header strings are left intact.
+ *
+ *  Inputs:
+ *    phmm: pointer to profile hmm struct whose model data should be deallocated.
+ */
+void p7HmmDeallocModelData(struct P7Hmm *phmm);
+
+/*
+ * Function:  p7HmmDetachModelData
+ * --------------------
+ * Sets every model array pointer (float and quantized) to NULL without freeing anything, e.g., after
+ *  the block they point into has been handed off elsewhere.
+ *
+ *  Inputs:
+ *    phmm: pointer to profile hmm struct whose model data pointers should be cleared.
+ */
+void p7HmmDetachModelData(struct P7Hmm *phmm);
+
 /*
  * Function:  p7HmmListAppendHmm
  * --------------------
- * Grows the phmms array in the given phmmList by one, and (if successful)
- *  updates the count to new correct number of elements in the list.
+ * Adds one model to the end of the given phmmList, and (if successful) updates the count
+ *  to new correct number of elements in the list. When the phmms array is full, its
+ *  capacity is doubled, so the array is only reallocated O(log n) times.
  *
  *  Inputs:
  *    phmmList: pointer to P7HmmList struct that will contain an additional profile hmm.
@@ -57,6 +86,25 @@ void p7HmmDealloc(struct P7Hmm *phmm);
  */
 struct P7Hmm *p7HmmListAppendHmm(struct P7HmmList *phmmList);
 
+/*
+ * Function:  p7HmmListConcatenate
+ * --------------------
+ * Moves the models from each of the source lists, in order, onto the end of phmmList.
+ *  The model data itself is not copied, so afterwards the source lists are left empty,
+ *  with their phmms arrays freed. None of the lists may use an arena.
+ *
+ *  Inputs:
+ *    phmmList: pointer to the list to append the models to.
+ *    sourceLists: array of lists to take the models from.
+ *    numSourceLists: number of lists in sourceLists.
+ *
+ *  Returns:
+ *    p7HmmSuccess on success,
+ *    p7HmmAllocationFailure if phmmList could not be grown. In this case, no models are moved.
+ */
+enum P7HmmReturnCode p7HmmListConcatenate(struct P7HmmList *phmmList, struct P7HmmList *sourceLists,
+  const uint32_t numSourceLists);
+
 
 /*
  * Function:  p7HmmAllocateModelData
@@ -68,18 +116,88 @@ struct P7Hmm *p7HmmListAppendHmm(struct P7HmmList *phmmList);
  *  are described to be present in the header. When these ancillary data are set to 'no'
  *  in the header, they will be left NULL.
  *
+ *  All of the arrays are carved out of a single block, with each array aligned to
+ *  P7_MODEL_DATA_ALIGNMENT bytes. insert0Emissions points to the start of the block, so
+ *  freeing it frees every array (unless the block came from an arena). Space for compo is reserved, see p7HmmAttachCompo.
+ *
  *  The alphabet and model length MUST be set in the currentPhmm before this function is called.
  *  Otherwise, the function wouldn't know how much memory to allocate.
  *
  *  Inputs:
  *    currentPhmm: pointer to the profile hmm to allocate data for.
+ *    allocateInsertEmissions: if false, insertEmissionScores is left NULL.
+ *    arena: arena to carve the block out of, or NULL to allocate it on its own.
  *
  *  Returns:
  *    p7HmmSuccess on success,
  *    p7HmmFormatError if either the alphabet or modelLength are uninitialized.
  *    p7HmmAllocationFailure if there was a failure to allocate data for the profile hmm.
  */
-enum P7HmmReturnCode p7HmmAllocateModelData(struct P7Hmm *currentPhmm);
+enum P7HmmReturnCode p7HmmAllocateModelData(struct P7Hmm *currentPhmm, const bool allocateInsertEmissions,
+  struct P7HmmArena *arena);
+
+/*
+ * Function:  p7HmmAllocateQuantizedModelData
+ * --------------------
+ * Allocates the model's data block like p7HmmAllocateModelData, but with the emission and transition
+ *  scores sized for the given precision, and pointed to by the model's quantized scores instead of
+ *  the float arrays.
+ *
+ *  Inputs:
+ *    currentPhmm: pointer to the profile hmm to allocate data for. Its model data pointers must be NULL.
+ *    allocateInsertEmissions: if false, the quantized insertEmissionScores is left NULL.
+ *    arena: arena to carve the block out of, or NULL to allocate it on its own.
+ *    precision: format the scores will be stored in, anything but p7HmmPrecisionFloat.
+ *
+ *  Returns:
+ *    as with p7HmmAllocateModelData.
+ */
+enum P7HmmReturnCode p7HmmAllocateQuantizedModelData(struct P7Hmm *currentPhmm, const bool allocateInsertEmissions,
+  struct P7HmmArena *arena, const enum P7HmmScorePrecision precision);
+
+/*
+ * Function:  p7HmmGetInsertEmissionRow
+ * --------------------
+ * Gets the insert emission scores of one node, whether the model stores a row per node, or only its
+ *  distinct rows (see readP7HmmCompactInserts).
+ *
+ *  Inputs:
+ *    phmm: pointer to the profile hmm to get the row from.
+ *    nodeIndex: position in the profile hmm. Must be less than the model length.
+ *
+ *  Returns:
+ *    the node's row of insert emission scores, or NULL if the model has no float insert emissions.
+ */
+const float *p7HmmGetInsertEmissionRow(const struct P7Hmm *const phmm, const uint32_t nodeIndex);
+
+/*
+ * Function:  p7HmmDecodeQuantizedScore
+ * --------------------
+ * Decodes a single score out of one of a model's quantized score arrays.
+ *
+ *  Inputs:
+ *    quantized: the model's quantized scores, for the precision and byte scaling.
+ *    codes: the quantized array to decode from, or NULL.
+ *    index: index of the score in the array.
+ *
+ *  Returns:
+ *    the decoded score, or NaN if codes is NULL, or the score was '*'.
+ */
+float p7HmmDecodeQuantizedScore(const struct P7QuantizedScores *const quantized, const void *const codes, const size_t index);
+
+/*
+ * Function:  p7HmmAttachCompo
+ * --------------------
+ * Points the model's compo at the space reserved for it in the model's data block, for
+ *  models whose COMPO line was found. No memory is allocated.
+ *
+ *  Inputs:
+ *    phmm: pointer to a profile hmm whose data was allocated with p7HmmAllocateModelData.
+ *
+ *  Returns:
+ *    the model's compo array, with room for one value per symbol of the alphabet.
+ */
+float *p7HmmAttachCompo(struct P7Hmm *phmm);
 
 
 #endif
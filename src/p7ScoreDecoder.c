@@ -0,0 +1,279 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "p7ScoreDecoder.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+//the avx2 kernel is compiled for avx2 whatever the build flags, and only run on CPUs that support it
+#if defined(__SSE2__) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define P7_DECODER_AVX2_DISPATCH
+#include <immintrin.h>
+#define P7_DECODER_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+
+//longest token that will be handed to strtof when a number can't take the fast conversion path
+#define P7_MAX_FALLBACK_NUMBER_LENGTH 63
+//number of digits after the decimal point in HMMER's "%.5f" score format
+#define P7_FIXED_SCORE_FRACTIONAL_DIGITS 5
+//fixed format scores are decoded from a 16 byte window with the decimal point at this offset
+#define P7_FIXED_SCORE_WINDOW_DOT_OFFSET 8
+
+//exact powers of ten in single precision. 10^10 is the largest power of ten that a float can represent exactly.
+static const float p7ExactPowersOfTen[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+
+
+//Decimal values with few enough significant digits are converted directly: when the digits form an
+//integer of at most 2^24 and there are at most 10 fractional digits, both the integer and the power
+//of ten are exact in single precision, so the one float division is correctly rounded and matches
+//strtof bit for bit.
+bool p7ParseFloat(const char *token, const size_t tokenLength, float *value){
+  const char *position = token;
+  const char *const tokenEnd = token + tokenLength;
+  bool isNegative = false;
+  if(position < tokenEnd && (*position == '-' || *position == '+')){
+    isNegative = *position == '-';
+    position++;
+  }
+  uint64_t mantissa = 0;
+  uint32_t numDigits = 0;
+  uint32_t numFractionalDigits = 0;
+  while(position < tokenEnd && p7IsDigit(*position) && numDigits < 18){
+    mantissa = (mantissa * 10) + (*position - '0');
+    numDigits++;
+    position++;
+  }
+  if(position < tokenEnd && *position == '.'){
+    position++;
+    while(position < tokenEnd && p7IsDigit(*position) && numDigits < 18){
+      mantissa = (mantissa * 10) + (*position - '0');
+      numDigits++;
+      numFractionalDigits++;
+      position++;
+    }
+  }
+
+  const bool takesFastPath = numDigits > 0 && mantissa <= (1 << 24) && numFractionalDigits <= 10 &&
+    (position == tokenEnd || !(p7IsDigit(*position) || *position == 'e' || *position == 'E' ||
+      *position == 'x' || *position == 'X' || *position == '.'));
+  if(takesFastPath){
+    float result = (float)mantissa / p7ExactPowersOfTen[numFractionalDigits];
+    *value = isNegative? -result: result;
+    return true;
+  }
+
+  //fall back to strtof on a null terminated copy of the token
+  char numberBuffer[P7_MAX_FALLBACK_NUMBER_LENGTH + 1];
+  const size_t copyLength = tokenLength < P7_MAX_FALLBACK_NUMBER_LENGTH? tokenLength: P7_MAX_FALLBACK_NUMBER_LENGTH;
+  memcpy(numberBuffer, token, copyLength);
+  numberBuffer[copyLength] = 0;
+  char *conversionEnd;
+  float result = strtof(numberBuffer, &conversionEnd);
+  if(conversionEnd == numberBuffer){
+    return false;
+  }
+  *value = result;
+  return true;
+}
+
+
+#if defined(__SSE2__)
+//checks if the token at position looks like a fixed format score (1-3 integer digits, a decimal point,
+//then 5 digits and a separator), and that the 16 byte window around its decimal point lies inside the line.
+static inline bool p7LocateFixedScore(const char *position, const char *const lineStart, const char *const lineEnd,
+  const char **dot, uint32_t *numIntegerDigits){
+  const char *dotPosition = position;
+  while(dotPosition < lineEnd && p7IsDigit(*dotPosition) && dotPosition - position < 4){
+    dotPosition++;
+  }
+  const uint32_t integerDigits = dotPosition - position;
+  const bool windowIsInLine = (dotPosition - lineStart >= P7_FIXED_SCORE_WINDOW_DOT_OFFSET) &&
+    (lineEnd - dotPosition >= 16 - P7_FIXED_SCORE_WINDOW_DOT_OFFSET);
+  if(integerDigits == 0 || integerDigits > 3 || !windowIsInLine || *dotPosition != '.' ||
+    !p7IsBlank(dotPosition[P7_FIXED_SCORE_FRACTIONAL_DIGITS + 1])){
+    return false;
+  }
+  *dot = dotPosition;
+  *numIntegerDigits = integerDigits;
+  return true;
+}
+
+//mask of the window bytes that must be digits, bits 9 through 13 are the fractional digits.
+static inline int p7FixedScoreDigitMask(const uint32_t numIntegerDigits){
+  return 0x3E00 | (((1 << numIntegerDigits) - 1) << (P7_FIXED_SCORE_WINDOW_DOT_OFFSET - numIntegerDigits));
+}
+
+//weights for the low 8 bytes of the window, so that a multiply-add yields the integer part of the score.
+static inline __m128i p7IntegerDigitWeights(const uint32_t numIntegerDigits){
+  switch(numIntegerDigits){
+    case 1:   return _mm_setr_epi16(0, 0, 0, 0, 0, 0, 0, 1);
+    case 2:   return _mm_setr_epi16(0, 0, 0, 0, 0, 0, 10, 1);
+    default:  return _mm_setr_epi16(0, 0, 0, 0, 0, 100, 10, 1);
+  }
+}
+
+//converts the integer and fractional parts of the score to the correctly rounded float.
+static inline bool p7FixedScoreToFloat(const uint32_t integerPart, const uint32_t fractionalPart, float *score){
+  const uint32_t mantissa = (integerPart * 100000) + fractionalPart;
+  if(mantissa > (1 << 24)){
+    return false;
+  }
+  *score = (float)mantissa / p7ExactPowersOfTen[P7_FIXED_SCORE_FRACTIONAL_DIGITS];
+  return true;
+}
+
+static inline bool p7DecodeFixedScoreSse2(const char *dot, const uint32_t numIntegerDigits, float *score){
+  const __m128i window = _mm_loadu_si128((const __m128i*)(dot - P7_FIXED_SCORE_WINDOW_DOT_OFFSET));
+  const __m128i digits = _mm_sub_epi8(window, _mm_set1_epi8('0'));
+  const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+  const int requiredDigitMask = p7FixedScoreDigitMask(numIntegerDigits);
+  if((_mm_movemask_epi8(isDigit) & requiredDigitMask) != requiredDigitMask){
+    return false;
+  }
+
+  //bytes outside of the score have zero weight, so whatever they hold drops out of the sums.
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i fractionalWeights = _mm_setr_epi16(0, 10000, 1000, 100, 10, 1, 0, 0);
+  const __m128i integerProducts = _mm_madd_epi16(_mm_unpacklo_epi8(digits, zero), p7IntegerDigitWeights(numIntegerDigits));
+  const __m128i fractionalProducts = _mm_madd_epi16(_mm_unpackhi_epi8(digits, zero), fractionalWeights);
+  //horizontally add both sets of products at once, leaving the integer part in lane 0 and the fraction in lane 1.
+  __m128i sums = _mm_add_epi32(_mm_unpacklo_epi32(integerProducts, fractionalProducts),
+    _mm_unpackhi_epi32(integerProducts, fractionalProducts));
+  sums = _mm_add_epi32(sums, _mm_unpackhi_epi64(sums, sums));
+  return p7FixedScoreToFloat(_mm_cvtsi128_si32(sums), _mm_cvtsi128_si32(_mm_shuffle_epi32(sums, 1)), score);
+}
+#endif
+
+#if defined(P7_DECODER_AVX2_DISPATCH)
+//decodes two fixed format scores at once, one per 128-bit lane.
+P7_DECODER_AVX2_TARGET static inline bool p7DecodeFixedScorePairAvx2(const char *firstDot, const uint32_t firstNumIntegerDigits,
+  const char *secondDot, const uint32_t secondNumIntegerDigits, float *scores){
+  const __m256i window = _mm256_inserti128_si256(_mm256_castsi128_si256(
+    _mm_loadu_si128((const __m128i*)(firstDot - P7_FIXED_SCORE_WINDOW_DOT_OFFSET))),
+    _mm_loadu_si128((const __m128i*)(secondDot - P7_FIXED_SCORE_WINDOW_DOT_OFFSET)), 1);
+  const __m256i digits = _mm256_sub_epi8(window, _mm256_set1_epi8('0'));
+  const __m256i isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(digits, _mm256_set1_epi8(9)), digits);
+  const uint32_t requiredDigitMask = (uint32_t)p7FixedScoreDigitMask(firstNumIntegerDigits) |
+    ((uint32_t)p7FixedScoreDigitMask(secondNumIntegerDigits) << 16);
+  if(((uint32_t)_mm256_movemask_epi8(isDigit) & requiredDigitMask) != requiredDigitMask){
+    return false;
+  }
+
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i integerWeights = _mm256_inserti128_si256(_mm256_castsi128_si256(
+    p7IntegerDigitWeights(firstNumIntegerDigits)), p7IntegerDigitWeights(secondNumIntegerDigits), 1);
+  const __m256i fractionalWeights = _mm256_setr_epi16(0, 10000, 1000, 100, 10, 1, 0, 0,
+    0, 10000, 1000, 100, 10, 1, 0, 0);
+  const __m256i integerProducts = _mm256_madd_epi16(_mm256_unpacklo_epi8(digits, zero), integerWeights);
+  const __m256i fractionalProducts = _mm256_madd_epi16(_mm256_unpackhi_epi8(digits, zero), fractionalWeights);
+  __m256i sums = _mm256_add_epi32(_mm256_unpacklo_epi32(integerProducts, fractionalProducts),
+    _mm256_unpackhi_epi32(integerProducts, fractionalProducts));
+  sums = _mm256_add_epi32(sums, _mm256_unpackhi_epi64(sums, sums));
+  const __m128i firstSums = _mm256_castsi256_si128(sums);
+  const __m128i secondSums = _mm256_extracti128_si256(sums, 1);
+  float decodedScores[2];
+  if(!p7FixedScoreToFloat(_mm_cvtsi128_si32(firstSums), _mm_cvtsi128_si32(_mm_shuffle_epi32(firstSums, 1)), &decodedScores[0]) ||
+    !p7FixedScoreToFloat(_mm_cvtsi128_si32(secondSums), _mm_cvtsi128_si32(_mm_shuffle_epi32(secondSums, 1)), &decodedScores[1])){
+    return false;
+  }
+  scores[0] = decodedScores[0];
+  scores[1] = decodedScores[1];
+  return true;
+}
+#endif
+
+
+//the row loop, inlined into one copy for the baseline target and one compiled for avx2. useAvx2 is a constant
+//in each copy, so the baseline copy never calls the avx2 kernel.
+static inline __attribute__((always_inline)) uint32_t p7DecodeScoreRowWith(const char **cursor,
+  const char *const lineStart, const char *const lineEnd, float *scores, const uint32_t numScores,
+  uint32_t *starMask, const bool useAvx2){
+  const char *position = *cursor;
+  uint32_t numDecoded = 0;
+  *starMask = 0;
+
+  while(numDecoded < numScores){
+    while(position < lineEnd && p7IsBlank(*position)){
+      position++;
+    }
+    if(position == lineEnd){
+      break;
+    }
+
+    if(*position == '*' && (position + 1 == lineEnd || p7IsBlank(position[1]))){
+      scores[numDecoded] = NAN;
+      *starMask |= 1u << numDecoded;
+      numDecoded++;
+      position++;
+      continue;
+    }
+
+#if defined(__SSE2__)
+    const char *dot;
+    uint32_t numIntegerDigits;
+    if(p7LocateFixedScore(position, lineStart, lineEnd, &dot, &numIntegerDigits)){
+      const char *scoreEnd = dot + P7_FIXED_SCORE_FRACTIONAL_DIGITS + 1;
+#if defined(P7_DECODER_AVX2_DISPATCH)
+      if(useAvx2 && numDecoded + 1 < numScores){
+        const char *nextPosition = scoreEnd;
+        while(nextPosition < lineEnd && p7IsBlank(*nextPosition)){
+          nextPosition++;
+        }
+        const char *nextDot;
+        uint32_t nextNumIntegerDigits;
+        if(p7LocateFixedScore(nextPosition, lineStart, lineEnd, &nextDot, &nextNumIntegerDigits) &&
+          p7DecodeFixedScorePairAvx2(dot, numIntegerDigits, nextDot, nextNumIntegerDigits, &scores[numDecoded])){
+          numDecoded += 2;
+          position = nextDot + P7_FIXED_SCORE_FRACTIONAL_DIGITS + 1;
+          continue;
+        }
+      }
+#endif
+      if(p7DecodeFixedScoreSse2(dot, numIntegerDigits, &scores[numDecoded])){
+        numDecoded++;
+        position = scoreEnd;
+        continue;
+      }
+    }
+#endif
+
+    //unusual token, so find its end and use the general parser
+    const char *tokenEnd = position;
+    while(tokenEnd < lineEnd && !p7IsBlank(*tokenEnd)){
+      tokenEnd++;
+    }
+    if(!p7ParseFloat(position, tokenEnd - position, &scores[numDecoded])){
+      break;
+    }
+    numDecoded++;
+    position = tokenEnd;
+  }
+
+  *cursor = position;
+  return numDecoded;
+}
+
+static uint32_t p7DecodeScoreRowBaseline(const char **cursor, const char *const lineStart, const char *const lineEnd,
+  float *scores, const uint32_t numScores, uint32_t *starMask){
+  return p7DecodeScoreRowWith(cursor, lineStart, lineEnd, scores, numScores, starMask, false);
+}
+
+#if defined(P7_DECODER_AVX2_DISPATCH)
+P7_DECODER_AVX2_TARGET static uint32_t p7DecodeScoreRowAvx2(const char **cursor, const char *const lineStart,
+  const char *const lineEnd, float *scores, const uint32_t numScores, uint32_t *starMask){
+  return p7DecodeScoreRowWith(cursor, lineStart, lineEnd, scores, numScores, starMask, true);
+}
+#endif
+
+uint32_t p7DecodeScoreRow(const char **cursor, const char *const lineStart, const char *const lineEnd,
+  float *scores, const uint32_t numScores, uint32_t *starMask){
+#if defined(P7_DECODER_AVX2_DISPATCH)
+  //__builtin_cpu_supports only reads the cpu features libgcc detected at startup
+  if(__builtin_cpu_supports("avx2")){
+    return p7DecodeScoreRowAvx2(cursor, lineStart, lineEnd, scores, numScores, starMask);
+  }
+#endif
+  return p7DecodeScoreRowBaseline(cursor, lineStart, lineEnd, scores, numScores, starMask);
+}
@@ -0,0 +1,61 @@
+#ifndef P7_HMM_READER_SCORE_DECODER_H
+#define P7_HMM_READER_SCORE_DECODER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+
+static inline bool p7IsBlank(const char c){
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool p7IsDigit(const char c){
+  return (unsigned char)(c - '0') < 10;
+}
+
+/*
+ * Function:  p7ParseFloat
+ * --------------------
+ * Parses a float from the start of the given token, with the same result as sscanf's "%f".
+ *  Plain decimal values are converted without calling into the C library, anything
+ *  else (exponents, long mantissas, inf/nan) is handed to strtof.
+ *
+ *  Inputs:
+ *    token: pointer to the first character of the token. Does not need to be null terminated.
+ *    tokenLength: number of characters in the token.
+ *    value: pointer to the float to write the parsed value to.
+ *
+ *  Returns:
+ *    true if a value was parsed, or false if the token does not start with a number.
+ */
+bool p7ParseFloat(const char *token, const size_t tokenLength, float *value);
+
+/*
+ * Function:  p7DecodeScoreRow
+ * --------------------
+ * Decodes a row of whitespace separated score fields, like the emission and transition
+ *  lines in the body of a profile hmm file. Fields in HMMER's fixed "%.5f" format are
+ *  converted with SIMD digit arithmetic when available (two fields at a time on CPUs with
+ *  AVX2, which is detected at runtime), and '*' fields are decoded
+ *  directly. Any other token falls back to p7ParseFloat. The results are bit-identical
+ *  to converting each field with sscanf's "%f".
+ *
+ *  Inputs:
+ *    cursor: pointer to the current position in the line. On return, it is advanced past the
+ *      last field that was decoded.
+ *    lineStart: first character of the line. The decoder may read (but never writes) any
+ *      character between lineStart and lineEnd.
+ *    lineEnd: one past the last character of the line.
+ *    scores: array to write the decoded scores to, must have room for numScores values.
+ *    numScores: number of fields to decode, at most 32.
+ *    starMask: bit i is set if field i was '*'. '*' fields are written to scores as NAN.
+ *
+ *  Returns:
+ *    The number of fields decoded. This will be less than numScores if the line ran out
+ *      of fields, or if a field could not be parsed as a number.
+ */
+uint32_t p7DecodeScoreRow(const char **cursor, const char *const lineStart, const char *const lineEnd,
+  float *scores, const uint32_t numScores, uint32_t *starMask);
+
+#endif
@@ -0,0 +1,231 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "p7HmmReader.h"
+#include "p7ProfileHmm.h"
+
+
+#define P7_STRIPED_LN2 0.69314718055994530942f
+//the same fixed point scales as HMMER: MSV costs are in one-third bits, and Viterbi scores in 1/500 bits
+#define P7_STRIPED_MSV_SCALE (3.0f / P7_STRIPED_LN2)
+#define P7_STRIPED_MSV_BASE 190
+#define P7_STRIPED_VITERBI_SCALE (500.0f / P7_STRIPED_LN2)
+#define P7_STRIPED_VITERBI_BASE 12000
+//at least 2 segments, so shifting the last segment's vector by one lane never wraps onto itself
+#define P7_STRIPED_MIN_SEGMENTS 2
+
+
+static inline uint32_t p7StripedNumSegments(const uint32_t modelLength, const uint32_t numLanes){
+  const uint32_t numSegments = (modelLength + numLanes - 1) / numLanes;
+  return numSegments < P7_STRIPED_MIN_SEGMENTS? P7_STRIPED_MIN_SEGMENTS: numSegments;
+}
+
+static inline size_t p7StripedAlign(const size_t length){
+  return (length + P7_MODEL_DATA_ALIGNMENT - 1) & ~(size_t)(P7_MODEL_DATA_ALIGNMENT - 1);
+}
+
+//scores in the file are negative natural log probabilities, and '*' (stored as NaN) is a probability of 0.
+static inline float p7StripedLogProbability(const float score){
+  return isnan(score)? -INFINITY: -score;
+}
+
+static inline float p7StripedMatchLogOdds(const struct P7Hmm *phmm, const uint32_t nodeIndex, const uint32_t symbolIndex,
+  const uint32_t alphabetCardinality){
+  return p7StripedLogProbability(phmm->model.matchEmissionScores[nodeIndex * alphabetCardinality + symbolIndex]) -
+    p7StripedLogProbability(phmm->model.insert0Emissions[symbolIndex]);
+}
+
+static inline uint8_t p7StripedUnbiasedByteify(const float score){
+  const float cost = -roundf(P7_STRIPED_MSV_SCALE * score);
+  return cost > 255.0f? 255: cost < 0.0f? 0: (uint8_t)cost;
+}
+
+static inline uint8_t p7StripedBiasedByteify(const float score, const uint8_t bias){
+  const float cost = -roundf(P7_STRIPED_MSV_SCALE * score);
+  return cost > 255.0f - bias? 255: cost < -(float)bias? 0: (uint8_t)(cost + bias);
+}
+
+static inline int16_t p7StripedWordify(const float score){
+  const float scaledScore = roundf(P7_STRIPED_VITERBI_SCALE * score);
+  return scaledScore >= 32767.0f? 32767: scaledScore <= -32768.0f? -32768: (int16_t)scaledScore;
+}
+
+//log probability of one of the striped transitions at the given node, see P7HmmStripedTransition.
+static float p7StripedTransitionLogProbability(const struct P7Hmm *phmm, const uint32_t transition,
+  const uint32_t nodeIndex, const float beginToMatch){
+  const struct P7InitialTransitions *initial = &phmm->model.initialTransitions;
+  const struct P7StateTransitions *transitions = &phmm->model.stateTransitions;
+  switch(transition){
+    case p7HmmStripedBeginToMatch:
+      return beginToMatch;
+    case p7HmmStripedMatchToMatch:
+      return p7StripedLogProbability(nodeIndex == 0? initial->beginToM1: transitions->matchToMatch[nodeIndex - 1]);
+    case p7HmmStripedInsertToMatch:
+      return p7StripedLogProbability(nodeIndex == 0? initial->insert0ToMatch1: transitions->insertToMatch[nodeIndex - 1]);
+    case p7HmmStripedDeleteToMatch:
+      return nodeIndex == 0? -INFINITY: p7StripedLogProbability(transitions->deleteToMatch[nodeIndex - 1]);
+    case p7HmmStripedMatchToDelete:
+      return p7StripedLogProbability(transitions->matchToDelete[nodeIndex]);
+    case p7HmmStripedMatchToInsert:
+      return p7StripedLogProbability(transitions->matchToInsert[nodeIndex]);
+    case p7HmmStripedInsertToInsert:
+      return p7StripedLogProbability(transitions->insertToInsert[nodeIndex]);
+    default:
+      return p7StripedLogProbability(transitions->deleteToDelete[nodeIndex]);
+  }
+}
+
+
+enum P7HmmVectorWidth p7HmmDetectVectorWidth(void){
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx512bw")){
+    return p7HmmVectorWidthAvx512;
+  }
+  if(__builtin_cpu_supports("avx2")){
+    return p7HmmVectorWidthAvx2;
+  }
+#endif
+  return p7HmmVectorWidthSse2;
+}
+
+enum P7HmmReturnCode p7HmmStripeProfile(const struct P7Hmm *const phmm, const enum P7HmmVectorWidth vectorWidth,
+  struct P7HmmStripedProfile *profile){
+  memset(profile, 0, sizeof(struct P7HmmStripedProfile));
+  const uint32_t alphabetCardinality = p7HmmGetAlphabetCardinality(phmm);
+  const uint32_t modelLength = phmm->header.modelLength;
+  if(alphabetCardinality == 0 || modelLength == 0 || phmm->model.matchEmissionScores == NULL){
+    return p7HmmFormatError;
+  }
+  const uint32_t width = vectorWidth == p7HmmVectorWidthAuto? p7HmmDetectVectorWidth(): vectorWidth;
+  if(width != p7HmmVectorWidthSse2 && width != p7HmmVectorWidthAvx2 && width != p7HmmVectorWidthAvx512){
+    return p7HmmFormatError;
+  }
+
+  //every array is carved out of one block, each starting on its own aligned boundary
+  const uint32_t msvLanes = width;
+  const uint32_t viterbiLanes = width / sizeof(int16_t);
+  const uint32_t forwardLanes = width / sizeof(float);
+  const uint32_t msvNumSegments = p7StripedNumSegments(modelLength, msvLanes);
+  const uint32_t viterbiNumSegments = p7StripedNumSegments(modelLength, viterbiLanes);
+  const uint32_t forwardNumSegments = p7StripedNumSegments(modelLength, forwardLanes);
+  const size_t msvLength = p7StripedAlign((size_t)alphabetCardinality * msvNumSegments * width);
+  const size_t viterbiMatchLength = p7StripedAlign((size_t)alphabetCardinality * viterbiNumSegments * width);
+  const size_t viterbiTransitionLength = p7StripedAlign((size_t)p7HmmStripedNumTransitions * viterbiNumSegments * width);
+  const size_t forwardEmissionLength = p7StripedAlign((size_t)alphabetCardinality * forwardNumSegments * width);
+  const size_t forwardTransitionLength = p7StripedAlign((size_t)p7HmmStripedNumTransitions * forwardNumSegments * width);
+  char *block = aligned_alloc(P7_MODEL_DATA_ALIGNMENT, msvLength + viterbiMatchLength + viterbiTransitionLength +
+    2 * forwardEmissionLength + forwardTransitionLength);
+  if(block == NULL){
+    return p7HmmAllocationFailure;
+  }
+  profile->msvMatchCosts = (uint8_t*)block;
+  block += msvLength;
+  profile->viterbiMatchScores = (int16_t*)block;
+  block += viterbiMatchLength;
+  profile->viterbiTransitions = (int16_t*)block;
+  block += viterbiTransitionLength;
+  profile->forwardMatchOdds = (float*)block;
+  block += forwardEmissionLength;
+  profile->forwardInsertOdds = (float*)block;
+  block += forwardEmissionLength;
+  profile->forwardTransitions = (float*)block;
+
+  profile->modelLength = modelLength;
+  profile->alphabetCardinality = alphabetCardinality;
+  profile->vectorWidth = width;
+  profile->msvNumSegments = msvNumSegments;
+  profile->viterbiNumSegments = viterbiNumSegments;
+  profile->forwardNumSegments = forwardNumSegments;
+  profile->msvScale = P7_STRIPED_MSV_SCALE;
+  profile->msvBase = P7_STRIPED_MSV_BASE;
+  profile->viterbiScale = P7_STRIPED_VITERBI_SCALE;
+  profile->viterbiBase = P7_STRIPED_VITERBI_BASE;
+
+  //local alignment enters at any match state with equal probability, 2/(M(M+1))
+  const float beginToMatch = logf(2.0f / ((float)modelLength * ((float)modelLength + 1.0f)));
+  profile->msvBeginToMatchCost = p7StripedUnbiasedByteify(beginToMatch);
+  profile->msvEndCost = p7StripedUnbiasedByteify(logf(0.5f));
+
+  //the bias lifts the best match score to a cost of 0, so every cost fits in an unsigned byte
+  float maxMatchLogOdds = -INFINITY;
+  for(uint32_t nodeIndex = 0; nodeIndex < modelLength; nodeIndex++){
+    for(uint32_t symbolIndex = 0; symbolIndex < alphabetCardinality; symbolIndex++){
+      const float logOdds = p7StripedMatchLogOdds(phmm, nodeIndex, symbolIndex, alphabetCardinality);
+      maxMatchLogOdds = logOdds > maxMatchLogOdds? logOdds: maxMatchLogOdds;
+    }
+  }
+  profile->msvBias = p7StripedUnbiasedByteify(-maxMatchLogOdds);
+
+  for(uint32_t symbolIndex = 0; symbolIndex < alphabetCardinality; symbolIndex++){
+    uint8_t *msvCosts = profile->msvMatchCosts + (size_t)symbolIndex * msvNumSegments * msvLanes;
+    for(uint32_t segment = 0; segment < msvNumSegments; segment++){
+      for(uint32_t lane = 0; lane < msvLanes; lane++){
+        const uint32_t nodeIndex = segment + lane * msvNumSegments;
+        msvCosts[segment * msvLanes + lane] = nodeIndex < modelLength?
+          p7StripedBiasedByteify(p7StripedMatchLogOdds(phmm, nodeIndex, symbolIndex, alphabetCardinality), profile->msvBias): 255;
+      }
+    }
+
+    int16_t *viterbiScores = profile->viterbiMatchScores + (size_t)symbolIndex * viterbiNumSegments * viterbiLanes;
+    for(uint32_t segment = 0; segment < viterbiNumSegments; segment++){
+      for(uint32_t lane = 0; lane < viterbiLanes; lane++){
+        const uint32_t nodeIndex = segment + lane * viterbiNumSegments;
+        viterbiScores[segment * viterbiLanes + lane] = nodeIndex < modelLength?
+          p7StripedWordify(p7StripedMatchLogOdds(phmm, nodeIndex, symbolIndex, alphabetCardinality)): -32768;
+      }
+    }
+
+    float *matchOdds = profile->forwardMatchOdds + (size_t)symbolIndex * forwardNumSegments * forwardLanes;
+    float *insertOdds = profile->forwardInsertOdds + (size_t)symbolIndex * forwardNumSegments * forwardLanes;
+    const float backgroundLogProbability = p7StripedLogProbability(phmm->model.insert0Emissions[symbolIndex]);
+    for(uint32_t segment = 0; segment < forwardNumSegments; segment++){
+      for(uint32_t lane = 0; lane < forwardLanes; lane++){
+        const uint32_t nodeIndex = segment + lane * forwardNumSegments;
+        const size_t position = segment * forwardLanes + lane;
+        if(nodeIndex >= modelLength){
+          matchOdds[position] = 0.0f;
+          insertOdds[position] = 0.0f;
+          continue;
+        }
+        matchOdds[position] = expf(p7StripedMatchLogOdds(phmm, nodeIndex, symbolIndex, alphabetCardinality));
+        //models loaded without insert emissions are given HMMER's insert emissions, equal to the background
+        const float *insertRow = p7HmmGetInsertEmissionRow(phmm, nodeIndex);
+        insertOdds[position] = insertRow == NULL? 1.0f: expf(p7StripedLogProbability(insertRow[symbolIndex]) -
+          backgroundLogProbability);
+      }
+    }
+  }
+
+  for(uint32_t segment = 0; segment < viterbiNumSegments; segment++){
+    for(uint32_t transition = 0; transition < p7HmmStripedNumTransitions; transition++){
+      //II is kept below 0, so the DP's insert loop always converges
+      const int16_t maxScore = transition == p7HmmStripedInsertToInsert? -1: 0;
+      int16_t *scores = profile->viterbiTransitions + ((size_t)segment * p7HmmStripedNumTransitions + transition) * viterbiLanes;
+      for(uint32_t lane = 0; lane < viterbiLanes; lane++){
+        const uint32_t nodeIndex = segment + lane * viterbiNumSegments;
+        const int16_t score = nodeIndex < modelLength?
+          p7StripedWordify(p7StripedTransitionLogProbability(phmm, transition, nodeIndex, beginToMatch)): -32768;
+        scores[lane] = score > maxScore? maxScore: score;
+      }
+    }
+  }
+
+  for(uint32_t segment = 0; segment < forwardNumSegments; segment++){
+    for(uint32_t transition = 0; transition < p7HmmStripedNumTransitions; transition++){
+      float *probabilities = profile->forwardTransitions + ((size_t)segment * p7HmmStripedNumTransitions + transition) * forwardLanes;
+      for(uint32_t lane = 0; lane < forwardLanes; lane++){
+        const uint32_t nodeIndex = segment + lane * forwardNumSegments;
+        probabilities[lane] = nodeIndex < modelLength?
+          expf(p7StripedTransitionLogProbability(phmm, transition, nodeIndex, beginToMatch)): 0.0f;
+      }
+    }
+  }
+  return p7HmmSuccess;
+}
+
+void p7HmmStripedProfileDealloc(struct P7HmmStripedProfile *profile){
+  //every array lives in the one block that starts with msvMatchCosts
+  free(profile->msvMatchCosts);
+  memset(profile, 0, sizeof(struct P7HmmStripedProfile));
+}
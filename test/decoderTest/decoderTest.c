@@ -0,0 +1,116 @@
+#define  _POSIX_C_SOURCE 200809L     //required for the getline function
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "../../src/p7ScoreDecoder.h"
+#include "../test.h"
+
+char *hmmFileSrcs[] = {"../printTest/Alpha-amylase.hmm", "../printTest/OxRdtase_C.hmm", "../printTest/T2SSL.hmm",
+  "../printTest/Tae4.hmm", "../printTest/Thioredoxin_10.hmm", "../printTest/combined.hmm"};
+const size_t numHmmFiles = sizeof(hmmFileSrcs) / sizeof(char*);
+
+//scores around the edges of the fixed format fast path, as well as tokens that must fall back to strtof
+char *edgeCaseLine = "          0.00000  9.99999 10.00000 99.99999 100.00000 167.77215 167.77216 167.77217 "
+  "999.99999 1.234567 * 1e-3 -1.50000 0.1 5.  .5 2.71828 3.14159           ";
+
+#define MAX_ROW_LENGTH 32
+
+char printBuffer[2048];
+
+bool bitsEqual(float f1, float f2){
+  return memcmp(&f1, &f2, sizeof(float)) == 0;
+}
+
+//compares p7ParseFloat against sscanf for every token, and p7DecodeScoreRow against sscanf for the
+//leading numeric fields of the line.
+void testLine(const char *fileSrc, size_t lineNumber, const char *line, size_t lineLength){
+  char tokenizedLine[4096];
+  if(lineLength >= sizeof(tokenizedLine)){
+    return;
+  }
+  memcpy(tokenizedLine, line, lineLength);
+  tokenizedLine[lineLength] = 0;
+
+  float expectedScores[MAX_ROW_LENGTH];
+  bool expectedStars[MAX_ROW_LENGTH];
+  uint32_t numRowFields = 0;
+  bool rowIsNumeric = true;
+  for(char *token = strtok(tokenizedLine, " "); token != NULL; token = strtok(NULL, " ")){
+    float expected;
+    const bool scanned = sscanf(token, "%f", &expected) == 1;
+    float actual;
+    const bool parsed = p7ParseFloat(token, strlen(token), &actual);
+    sprintf(printBuffer, "%s line %zu: token '%s' parse result %d, sscanf result %d.", fileSrc, lineNumber, token, parsed, scanned);
+    testAssertString(parsed == scanned, printBuffer);
+    if(scanned && parsed){
+      sprintf(printBuffer, "%s line %zu: token '%s' parsed as %.9g, sscanf gave %.9g.", fileSrc, lineNumber, token, actual, expected);
+      testAssertString(bitsEqual(expected, actual), printBuffer);
+    }
+
+    const bool isStar = strcmp(token, "*") == 0;
+    if(rowIsNumeric && (scanned || isStar) && numRowFields < MAX_ROW_LENGTH){
+      expectedScores[numRowFields] = expected;
+      expectedStars[numRowFields] = isStar;
+      numRowFields++;
+    }
+    else{
+      rowIsNumeric = false;
+    }
+  }
+
+  if(numRowFields == 0){
+    return;
+  }
+  float decodedScores[MAX_ROW_LENGTH];
+  uint32_t starMask;
+  const char *cursor = line;
+  uint32_t numDecoded = p7DecodeScoreRow(&cursor, line, line + lineLength, decodedScores, numRowFields, &starMask);
+  sprintf(printBuffer, "%s line %zu: decoded %u fields, expected %u.", fileSrc, lineNumber, numDecoded, numRowFields);
+  testAssertString(numDecoded == numRowFields, printBuffer);
+  for(uint32_t i = 0; i < numDecoded && i < numRowFields; i++){
+    if(expectedStars[i]){
+      sprintf(printBuffer, "%s line %zu: field %u should have been decoded as '*'.", fileSrc, lineNumber, i);
+      testAssertString((starMask & (1u << i)) && isnan(decodedScores[i]), printBuffer);
+    }
+    else{
+      sprintf(printBuffer, "%s line %zu: field %u decoded as %.9g, sscanf gave %.9g.", fileSrc, lineNumber, i,
+        decodedScores[i], expectedScores[i]);
+      testAssertString(!(starMask & (1u << i)) && bitsEqual(decodedScores[i], expectedScores[i]), printBuffer);
+    }
+  }
+}
+
+void testFile(const char *fileSrc){
+  FILE *hmmFile = fopen(fileSrc, "r");
+  sprintf(printBuffer, "could not open %s.", fileSrc);
+  testAssertString(hmmFile != NULL, printBuffer);
+  if(hmmFile == NULL){
+    return;
+  }
+  char *lineBuffer = NULL;
+  size_t lineBufferLength = 0;
+  size_t lineNumber = 0;
+  ssize_t numCharactersRead;
+  while((numCharactersRead = getline(&lineBuffer, &lineBufferLength, hmmFile)) != -1){
+    lineNumber++;
+    size_t lineLength = numCharactersRead;
+    if(lineLength != 0 && lineBuffer[lineLength - 1] == '\n'){
+      lineLength--;
+    }
+    testLine(fileSrc, lineNumber, lineBuffer, lineLength);
+  }
+  free(lineBuffer);
+  fclose(hmmFile);
+}
+
+int main(int argc, char ** argv){
+  for(size_t i = 0; i < numHmmFiles; i++){
+    printf("\n\tstarting decoder test on %s\n", hmmFileSrcs[i]);
+    testFile(hmmFileSrcs[i]);
+  }
+
+  printf("\n\tstarting decoder edge case test\n");
+  testLine("edge cases", 1, edgeCaseLine, strlen(edgeCaseLine));
+
+  printf("\n\tdecoder tests finished, %zu assertions checked\n", assertionNumber);
+}
@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../../src/p7HmmReader.h"
+#include "../../src/p7ProfileHmm.h"
+#include "../test.h"
+
+/*
+ * hmmpress isn't available to generate fixtures, so this test presses the text test files itself,
+ *  writing each model with the same layout as HMMER 3.1b2's write_bin30hmm() (with scores converted
+ *  back to probabilities), then checks that readP7HmmPressed gives the same models as readP7Hmm.
+ */
+
+#define PRESSED_V3F_MAGIC 0xe8ededbau
+
+const char *hmmFileSrcs[6] = {"../printTest/Alpha-amylase.hmm", "../printTest/OxRdtase_C.hmm", "../printTest/T2SSL.hmm",
+  "../printTest/Tae4.hmm", "../printTest/Thioredoxin_10.hmm", "../printTest/combined.hmm"};
+const char *pressedFileSrc = "pressedTest.h3m";
+char printBuffer[2048];
+
+
+static float scoreToProbability(const float score){
+  return isnan(score)? 0.0f: expf(-score);
+}
+
+static void writeInt(FILE *file, int32_t value){
+  fwrite(&value, sizeof(int32_t), 1, file);
+}
+
+static void writeFloat(FILE *file, float value){
+  fwrite(&value, sizeof(float), 1, file);
+}
+
+//as easel writes them, the length counts the null terminator, which is written too. Absent strings have length 0.
+static void writeString(FILE *file, const char *string){
+  int32_t length = string == NULL? 0: strlen(string) + 1;
+  writeInt(file, length);
+  fwrite(string, 1, length, file);
+}
+
+//annotations are written for nodes 0..M+1, with a leading pad character and a trailing terminator.
+static void writeAnnotation(FILE *file, const char *annotation, uint32_t modelLength){
+  fputc(' ', file);
+  fwrite(annotation, 1, modelLength, file);
+  fputc(0, file);
+}
+
+static void writePressedHmm(FILE *file, const struct P7Hmm *phmm){
+  const uint32_t K = p7HmmGetAlphabetCardinality(phmm);
+  const uint32_t M = phmm->header.modelLength;
+  uint32_t flags = (1 << 7);
+  flags |= phmm->header.description != NULL? (1 << 1): 0;
+  flags |= phmm->header.hasReferenceAnnotation? (1 << 2): 0;
+  flags |= phmm->header.hasConsensusStructure? (1 << 3): 0;
+  flags |= phmm->header.hasMapAnnotation? (1 << 8): 0;
+  flags |= phmm->header.accessionNumber != NULL? (1 << 9): 0;
+  flags |= phmm->header.gatheringThresholds[0] != 0? (1 << 10): 0;
+  flags |= phmm->header.trustedCutoffs[0] != 0? (1 << 11): 0;
+  flags |= phmm->header.noiseCutoffs[0] != 0? (1 << 12): 0;
+  flags |= phmm->model.compo != NULL? (1 << 14): 0;
+  flags |= phmm->header.checksum != 0? (1 << 15): 0;
+  flags |= phmm->header.hasConsensusResidue? (1 << 16): 0;
+  flags |= phmm->header.hasModelMask? (1 << 17): 0;
+  const int32_t alphabetTypes[] = {3, 2, 1, 4, 5}; //amino, dna, rna, coins, dice
+
+  uint32_t magic = PRESSED_V3F_MAGIC;
+  fwrite(&magic, sizeof(uint32_t), 1, file);
+  writeInt(file, flags);
+  writeInt(file, M);
+  writeInt(file, alphabetTypes[phmm->header.alphabet]);
+  for(uint32_t k = 0; k < M * K; k++){
+    writeFloat(file, scoreToProbability(phmm->model.matchEmissionScores[k]));
+  }
+  for(uint32_t k = 0; k < K; k++){
+    writeFloat(file, scoreToProbability(phmm->model.insert0Emissions[k]));
+  }
+  for(uint32_t k = 0; k < M * K; k++){
+    writeFloat(file, scoreToProbability(phmm->model.insertEmissionScores[k]));
+  }
+  const struct P7InitialTransitions *initial = &phmm->model.initialTransitions;
+  writeFloat(file, scoreToProbability(initial->beginToM1));
+  writeFloat(file, scoreToProbability(initial->beginToInsert0));
+  writeFloat(file, scoreToProbability(initial->beginToDelete1));
+  writeFloat(file, scoreToProbability(initial->insert0ToMatch1));
+  writeFloat(file, scoreToProbability(initial->insert0ToInsert0));
+  writeFloat(file, 1.0f);
+  writeFloat(file, 0.0f);
+  const struct P7StateTransitions *t = &phmm->model.stateTransitions;
+  for(uint32_t k = 0; k < M; k++){
+    const float nodeScores[7] = {t->matchToMatch[k], t->matchToInsert[k], t->matchToDelete[k], t->insertToMatch[k],
+      t->insertToInsert[k], t->deleteToMatch[k], t->deleteToDelete[k]};
+    for(uint32_t i = 0; i < 7; i++){
+      writeFloat(file, scoreToProbability(nodeScores[i]));
+    }
+  }
+
+  writeString(file, phmm->header.name);
+  if(flags & (1 << 9)) writeString(file, phmm->header.accessionNumber);
+  if(flags & (1 << 1)) writeString(file, phmm->header.description);
+  if(flags & (1 << 2)) writeAnnotation(file, phmm->model.referenceAnnotation, M);
+  if(flags & (1 << 17)){
+    fputc(' ', file);
+    for(uint32_t k = 0; k < M; k++){
+      fputc(phmm->model.modelMask[k]? 'm': '.', file);
+    }
+    fputc(0, file);
+  }
+  if(flags & (1 << 16)) writeAnnotation(file, phmm->model.consensusResidues, M);
+  if(flags & (1 << 3)) writeAnnotation(file, phmm->model.consensusStructure, M);
+
+  //the text file's COM lines are numbered "[n] ", which HMMER adds when writing the text
+  char commandLog[8192] = {0};
+  if(phmm->header.commandLineHistory != NULL){
+    const char *line = phmm->header.commandLineHistory;
+    while(line != NULL){
+      const char *lineText = strstr(line, "] ") + 2;
+      const char *lineEnd = strchr(line, '\n');
+      strncat(commandLog, lineText, lineEnd == NULL? strlen(lineText): (size_t)(lineEnd - lineText) + 1);
+      line = lineEnd == NULL? NULL: lineEnd + 1;
+    }
+  }
+  writeString(file, commandLog[0] == 0? NULL: commandLog);
+  writeInt(file, phmm->header.numSequences);
+  writeFloat(file, phmm->header.effectiveNumSequences);
+  writeInt(file, phmm->header.maxLength);
+  writeString(file, phmm->header.date);
+  if(flags & (1 << 8)){
+    writeInt(file, 0);
+    for(uint32_t k = 0; k < M; k++){
+      writeInt(file, phmm->model.mapAnnotations[k]);
+    }
+  }
+  writeInt(file, phmm->header.checksum);
+  const struct P7Stats *stats = &phmm->stats;
+  const float evParams[6] = {stats->msvGumbelMu, stats->msvGumbelLambda, stats->viterbiGumbelMu,
+    stats->viterbiGumbelLambda, stats->forwardTau, stats->forwardLambda};
+  fwrite(evParams, sizeof(float), 6, file);
+  const float cutoffs[6] = {phmm->header.gatheringThresholds[0], phmm->header.gatheringThresholds[1],
+    phmm->header.trustedCutoffs[0], phmm->header.trustedCutoffs[1], phmm->header.noiseCutoffs[0], phmm->header.noiseCutoffs[1]};
+  fwrite(cutoffs, sizeof(float), 6, file);
+  if(flags & (1 << 14)){
+    for(uint32_t k = 0; k < 20; k++){
+      writeFloat(file, k < K? scoreToProbability(phmm->model.compo[k]): 0.0f);
+    }
+  }
+}
+
+static bool sameBytes(const void *a, const void *b, size_t length){
+  if(a == NULL || b == NULL){
+    return a == b;
+  }
+  return memcmp(a, b, length) == 0;
+}
+
+static bool sameString(const char *a, const char *b){
+  if(a == NULL || b == NULL){
+    return a == b;
+  }
+  return strcmp(a, b) == 0;
+}
+
+//compares every field of the two models bit for bit, except the version line, which isn't stored in pressed files.
+static void compareHmms(const struct P7Hmm *textHmm, const struct P7Hmm *pressedHmm, const char *fileSrc, uint32_t modelIndex){
+  const uint32_t K = p7HmmGetAlphabetCardinality(textHmm);
+  const uint32_t M = textHmm->header.modelLength;
+  const struct P7Header *a = &textHmm->header, *b = &pressedHmm->header;
+  sprintf(printBuffer, "pressed model %u of %s did not match the text model", modelIndex, fileSrc);
+
+  testAssertString(a->modelLength == b->modelLength && a->alphabet == b->alphabet, printBuffer);
+  if(a->modelLength != b->modelLength || a->alphabet != b->alphabet){
+    return;
+  }
+  testAssertString(a->hasReferenceAnnotation == b->hasReferenceAnnotation && a->hasModelMask == b->hasModelMask &&
+    a->hasConsensusResidue == b->hasConsensusResidue && a->hasConsensusStructure == b->hasConsensusStructure &&
+    a->hasMapAnnotation == b->hasMapAnnotation, printBuffer);
+  testAssertString(a->maxLength == b->maxLength && a->checksum == b->checksum && a->numSequences == b->numSequences, printBuffer);
+  testAssertString(sameBytes(&a->effectiveNumSequences, &b->effectiveNumSequences, sizeof(float)), printBuffer);
+  testAssertString(sameString(a->name, b->name) && sameString(a->accessionNumber, b->accessionNumber), printBuffer);
+  testAssertString(sameString(a->description, b->description) && sameString(a->date, b->date), printBuffer);
+  testAssertString(sameString(a->commandLineHistory, b->commandLineHistory), printBuffer);
+  testAssertString(sameBytes(a->gatheringThresholds, b->gatheringThresholds, 2 * sizeof(float)) &&
+    sameBytes(a->trustedCutoffs, b->trustedCutoffs, 2 * sizeof(float)) &&
+    sameBytes(a->noiseCutoffs, b->noiseCutoffs, 2 * sizeof(float)), printBuffer);
+  testAssertString(sameBytes(&textHmm->stats, &pressedHmm->stats, sizeof(struct P7Stats)), printBuffer);
+
+  const struct P7Model *x = &textHmm->model, *y = &pressedHmm->model;
+  testAssertString(sameBytes(x->compo, y->compo, K * sizeof(float)), printBuffer);
+  testAssertString(sameBytes(x->insert0Emissions, y->insert0Emissions, K * sizeof(float)), printBuffer);
+  testAssertString(sameBytes(&x->initialTransitions, &y->initialTransitions, sizeof(struct P7InitialTransitions)), printBuffer);
+  testAssertString(sameBytes(x->matchEmissionScores, y->matchEmissionScores, K * M * sizeof(float)), printBuffer);
+  testAssertString(sameBytes(x->insertEmissionScores, y->insertEmissionScores, K * M * sizeof(float)), printBuffer);
+  const float *const xt[7] = {x->stateTransitions.matchToMatch, x->stateTransitions.matchToInsert,
+    x->stateTransitions.matchToDelete, x->stateTransitions.insertToMatch, x->stateTransitions.insertToInsert,
+    x->stateTransitions.deleteToMatch, x->stateTransitions.deleteToDelete};
+  const float *const yt[7] = {y->stateTransitions.matchToMatch, y->stateTransitions.matchToInsert,
+    y->stateTransitions.matchToDelete, y->stateTransitions.insertToMatch, y->stateTransitions.insertToInsert,
+    y->stateTransitions.deleteToMatch, y->stateTransitions.deleteToDelete};
+  for(uint32_t i = 0; i < 7; i++){
+    testAssertString(sameBytes(xt[i], yt[i], M * sizeof(float)), printBuffer);
+  }
+  testAssertString(sameBytes(x->mapAnnotations, y->mapAnnotations, M * sizeof(uint32_t)), printBuffer);
+  testAssertString(sameBytes(x->consensusResidues, y->consensusResidues, M), printBuffer);
+  testAssertString(sameBytes(x->referenceAnnotation, y->referenceAnnotation, M), printBuffer);
+  testAssertString(sameBytes(x->modelMask, y->modelMask, M * sizeof(bool)), printBuffer);
+  testAssertString(sameBytes(x->consensusStructure, y->consensusStructure, M), printBuffer);
+}
+
+
+int main(int argc, char **argv){
+  printf("beginning pressed file tests\n");
+  for(uint32_t fileIndex = 0; fileIndex < 6; fileIndex++){
+    struct P7HmmList textList, pressedList;
+    enum P7HmmReturnCode rc = readP7Hmm(hmmFileSrcs[fileIndex], &textList);
+    testAssertString(rc == p7HmmSuccess, "readP7Hmm did not return success");
+    //drop the optional DATE and COM lines from one model, which a text file without them leaves NULL
+    if(fileIndex == 5 && textList.count > 1){
+      struct P7Header *header = &textList.phmms[1].header;
+      free(header->date);
+      free(header->commandLineHistory);
+      header->date = NULL;
+      header->commandLineHistory = NULL;
+    }
+
+    FILE *pressedFile = fopen(pressedFileSrc, "wb");
+    for(uint32_t i = 0; i < textList.count; i++){
+      writePressedHmm(pressedFile, &textList.phmms[i]);
+    }
+    fclose(pressedFile);
+
+    rc = readP7HmmPressed(pressedFileSrc, &pressedList);
+    testAssertString(rc == p7HmmSuccess, "readP7HmmPressed did not return success");
+    sprintf(printBuffer, "expected %u pressed models, got %u", textList.count, pressedList.count);
+    testAssertString(textList.count == pressedList.count, printBuffer);
+    for(uint32_t i = 0; i < textList.count && i < pressedList.count; i++){
+      compareHmms(&textList.phmms[i], &pressedList.phmms[i], hmmFileSrcs[fileIndex], i);
+      testAssertString(strcmp(pressedList.phmms[i].header.version, "HMMER3/f") == 0, "pressed model version should be HMMER3/f");
+    }
+    p7HmmListDealloc(&textList);
+    p7HmmListDealloc(&pressedList);
+  }
+
+  struct P7HmmList pressedList;
+  enum P7HmmReturnCode rc = readP7HmmPressed(hmmFileSrcs[0], &pressedList);
+  testAssertString(rc == p7HmmFormatError, "readP7HmmPressed should reject a text hmm file");
+  remove(pressedFileSrc);
+
+  printf("pressed file tests finished, %zu assertions checked\n", assertionNumber);
+}
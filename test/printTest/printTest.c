@@ -1,5 +1,11 @@
+#define  _POSIX_C_SOURCE 200809L
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <zlib.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include "../../src/p7HmmReader.h"
 #include "../../src/p7ProfileHmm.h"
 #include "../test.h"
@@ -18,8 +24,11 @@ void t2HmmTest(struct P7Hmm *phmm);
 void thioHmmTest(struct P7Hmm *phmm);
 void taeHmmTest(struct P7Hmm *phmm);
 void combinedHmmTest(struct P7HmmList *phmmList);
+bool filesAreIdentical(const char *fileSrc1, const char *fileSrc2, const bool ignoreTrailingBlanks);
+bool filterByLength(const struct P7Hmm *phmm, void *filterData);
 
 char printBuffer[2048];
+void (*const combinedModelTests[5])(struct P7Hmm*) = {amalyseHmmTest, oxHmmTest, t2HmmTest, taeHmmTest, thioHmmTest};
 
 bool floatCompare(float f1, float f2){
   const float threshold = .00001f;
@@ -79,7 +88,879 @@ int main(int argc, char ** argv){
   testAssertString(phmmList.phmms != NULL, "phmmList Returned Null");
   testAssertString(phmmList.count == 5, "phmmList did not have expected count of 1");
   combinedHmmTest(&phmmList);
+  //every model's arrays are carved out of one block, each aligned for SIMD loads
+  for(uint32_t i = 0; i < phmmList.count; i++){
+    const struct P7Model *model = &phmmList.phmms[i].model;
+    const void *const modelArrays[5] = {model->insert0Emissions, model->matchEmissionScores,
+      model->insertEmissionScores, model->stateTransitions.matchToMatch, model->stateTransitions.deleteToDelete};
+    for(uint32_t j = 0; j < 5; j++){
+      testAssertString((uintptr_t)modelArrays[j] % P7_MODEL_DATA_ALIGNMENT == 0, "model array was not aligned");
+    }
+    testAssertString((char*)model->matchEmissionScores > (char*)model->insert0Emissions &&
+      (char*)model->stateTransitions.deleteToDelete > (char*)model->matchEmissionScores,
+      "model arrays were not laid out in a single block");
+  }
+  p7HmmListDealloc(&phmmList);
+
+  printf("\n\tstarting arena combined test\n");
+  rc = readP7HmmWithArena(combinedFileSrc, &phmmList);
+  testAssertString(rc == p7HmmSuccess, "readP7HmmWithArena did not return success");
+  testAssertString(phmmList.arena != NULL, "readP7HmmWithArena did not give the list an arena");
+  testAssertString(phmmList.count == 5 && phmmList.capacity >= phmmList.count,
+    "arena list did not have expected count of 5");
+  combinedHmmTest(&phmmList);
+  for(uint32_t i = 0; i < phmmList.count; i++){
+    testAssertString((uintptr_t)phmmList.phmms[i].model.insert0Emissions % P7_MODEL_DATA_ALIGNMENT == 0,
+      "arena model block was not aligned");
+    //the version and name are the first two strings of each model, and strings are packed without padding
+    const struct P7Header *header = &phmmList.phmms[i].header;
+    testAssertString(header->name == header->version + strlen(header->version) + 1,
+      "arena header strings were not packed together");
+  }
+  p7HmmListDealloc(&phmmList);
+  testAssertString(phmmList.arena == NULL && phmmList.count == 0, "p7HmmListDealloc did not reset the arena list");
+  //a directory opens as a stream, but every read from it fails, which is an I/O error rather than a failed allocation
+  rc = readP7Hmm(".", &phmmList);
+  testAssertString(rc == p7HmmFileNotFound, "readP7Hmm should report a failed read as p7HmmFileNotFound");
+
+  printf("\n\tstarting mapped combined test\n");
+  rc = readP7HmmMapped(combinedFileSrc, &phmmList);
+  testAssertString(rc == p7HmmSuccess, "readP7HmmMapped did not return success");
+  combinedHmmTest(&phmmList);
+  p7HmmListDealloc(&phmmList);
+
+  printf("\n\tstarting buffer combined test\n");
+  FILE *combinedFile = fopen(combinedFileSrc, "r");
+  fseek(combinedFile, 0, SEEK_END);
+  size_t combinedFileLength = ftell(combinedFile);
+  rewind(combinedFile);
+  char *combinedFileText = malloc(combinedFileLength);
+  testAssertString(fread(combinedFileText, 1, combinedFileLength, combinedFile) == combinedFileLength,
+    "failed to read the combined file into memory");
+  fclose(combinedFile);
+  rc = readP7HmmFromBuffer(combinedFileText, combinedFileLength, &phmmList);
+  testAssertString(rc == p7HmmSuccess, "readP7HmmFromBuffer did not return success");
+  combinedHmmTest(&phmmList);
+  p7HmmListDealloc(&phmmList);
+
+  printf("\n\tstarting gzip combined test\n");
+  const char *gzipFileSrc = "combinedTest.hmm.gz";
+  gzFile gzipFile = gzopen(gzipFileSrc, "wb");
+  testAssertString(gzipFile != NULL, "failed to create the gzip test file");
+  testAssertString(gzwrite(gzipFile, combinedFileText, combinedFileLength) == (int)combinedFileLength,
+    "failed to write the gzip test file");
+  gzclose(gzipFile);
+  rc = readP7Hmm(gzipFileSrc, &phmmList);
+  testAssertString(rc == p7HmmSuccess, "readP7Hmm did not return success on gzip file");
+  combinedHmmTest(&phmmList);
+  p7HmmListDealloc(&phmmList);
+  rc = readP7HmmMapped(gzipFileSrc, &phmmList);
+  testAssertString(rc == p7HmmSuccess, "readP7HmmMapped did not return success on gzip file");
+  combinedHmmTest(&phmmList);
+  p7HmmListDealloc(&phmmList);
+  rc = readP7HmmParallel(gzipFileSrc, 2, &phmmList);
+  testAssertString(rc == p7HmmSuccess, "readP7HmmParallel did not return success on gzip file");
+  combinedHmmTest(&phmmList);
+  p7HmmListDealloc(&phmmList);
+  remove(gzipFileSrc);
+  free(combinedFileText);
+
+  printf("\n\tstarting block compressed combined test\n");
+  const char *blockFileSrc = "combinedTest.hmm.bgz";
+  //small blocks, so the models are spread across several blocks
+  rc = p7HmmBlockCompressFile(combinedFileSrc, blockFileSrc, 1 << 16);
+  testAssertString(rc == p7HmmSuccess, "p7HmmBlockCompressFile did not return success");
+  for(uint32_t numThreads = 1; numThreads <= 3; numThreads++){
+    rc = readP7HmmBlockCompressed(blockFileSrc, numThreads, &phmmList);
+    testAssertString(rc == p7HmmSuccess, "readP7HmmBlockCompressed did not return success");
+    combinedHmmTest(&phmmList);
+    p7HmmListDealloc(&phmmList);
+  }
+  //the container is also a plain multi-member gzip file
+  rc = readP7Hmm(blockFileSrc, &phmmList);
+  testAssertString(rc == p7HmmSuccess, "readP7Hmm did not return success on block compressed file");
+  combinedHmmTest(&phmmList);
+  p7HmmListDealloc(&phmmList);
+  for(uint32_t modelIndex = 0; modelIndex < 5; modelIndex++){
+    rc = readP7HmmBlockCompressedModel(blockFileSrc, modelIndex, &phmmList);
+    testAssertString(rc == p7HmmSuccess, "readP7HmmBlockCompressedModel did not return success");
+    testAssertString(phmmList.count == 1, "readP7HmmBlockCompressedModel should return exactly one model");
+    if(phmmList.count == 1){
+      combinedModelTests[modelIndex](&phmmList.phmms[0]);
+    }
+    p7HmmListDealloc(&phmmList);
+  }
+  rc = readP7HmmBlockCompressedModel(blockFileSrc, 5, &phmmList);
+  testAssertString(rc == p7HmmModelNotFound, "readP7HmmBlockCompressedModel should not find a 6th model");
+  remove(blockFileSrc);
+  sprintf(printBuffer, "%s.p7bi", blockFileSrc);
+  remove(printBuffer);
+
+  for(uint32_t numThreads = 1; numThreads <= 4; numThreads++){
+    printf("\n\tstarting parallel combined test, %u threads\n", numThreads);
+    rc = readP7HmmParallel(combinedFileSrc, numThreads, &phmmList);
+    testAssertString(rc == p7HmmSuccess, "readP7HmmParallel did not return success");
+    combinedHmmTest(&phmmList);
+    p7HmmListDealloc(&phmmList);
+  }
+
+  printf("\n\tstarting batch test\n");
+  const char *batchFileSrcs[7] = {amylaseFileSrc, oxFileSrc, "missingFile.hmm", t2FileSrc, taeFileSrc, thioFileSrc, combinedFileSrc};
+  enum P7HmmReturnCode batchReturnCodes[7];
+  rc = readP7HmmBatch(batchFileSrcs, 7, 3, &phmmList, batchReturnCodes);
+  testAssertString(rc == p7HmmFileNotFound, "readP7HmmBatch did not report the missing file");
+  testAssertString(batchReturnCodes[2] == p7HmmFileNotFound, "readP7HmmBatch did not return file not found for the missing file");
+  for(uint32_t i = 0; i < 7; i++){
+    if(i != 2){
+      sprintf(printBuffer, "readP7HmmBatch did not return success for file %u", i);
+      testAssertString(batchReturnCodes[i] == p7HmmSuccess, printBuffer);
+    }
+  }
+  sprintf(printBuffer, "expected 10 models from the batch, but got %u", phmmList.count);
+  testAssertString(phmmList.count == 10, printBuffer);
+  if(phmmList.count == 10){
+    amalyseHmmTest(&phmmList.phmms[0]);
+    oxHmmTest(&phmmList.phmms[1]);
+    t2HmmTest(&phmmList.phmms[2]);
+    taeHmmTest(&phmmList.phmms[3]);
+    thioHmmTest(&phmmList.phmms[4]);
+    struct P7HmmList combinedSlice = {.phmms = &phmmList.phmms[5], .count = 5};
+    combinedHmmTest(&combinedSlice);
+  }
+  p7HmmListDealloc(&phmmList);
+
+  printf("\n\tstarting context test\n");
+  struct P7HmmContext *context;
+  rc = p7HmmContextCreate(&context);
+  testAssertString(rc == p7HmmSuccess, "p7HmmContextCreate did not return success");
+  for(uint32_t i = 0; i < 7 && rc == p7HmmSuccess; i++){
+    enum P7HmmReturnCode contextReturnCode = readP7HmmWithContext(context, batchFileSrcs[i], &phmmList);
+    sprintf(printBuffer, "readP7HmmWithContext gave return code %d for file %u", contextReturnCode, i);
+    testAssertString(contextReturnCode == (i == 2? p7HmmFileNotFound: p7HmmSuccess), printBuffer);
+    if(contextReturnCode == p7HmmSuccess && i < 6){
+      testAssertString(phmmList.count == 1, "readP7HmmWithContext did not read exactly one model");
+      const uint32_t testIndex = i < 2? i: i - 1;
+      //batch order is amylase, ox, (missing), t2, tae, thio
+      void (*const singleModelTests[5])(struct P7Hmm*) = {amalyseHmmTest, oxHmmTest, t2HmmTest, taeHmmTest, thioHmmTest};
+      singleModelTests[testIndex](&phmmList.phmms[0]);
+    }
+    else if(contextReturnCode == p7HmmSuccess){
+      combinedHmmTest(&phmmList);
+    }
+    p7HmmListDealloc(&phmmList);
+  }
+  p7HmmContextDestroy(context);
+
+  printf("\n\tstarting binary combined test\n");
+  const char *binaryFileSrc = "combinedTest.p7hb";
+  rc = readP7Hmm(combinedFileSrc, &phmmList);
+  testAssertString(rc == p7HmmSuccess, "readP7Hmm did not return success");
+  rc = p7HmmListWriteBinary(&phmmList, binaryFileSrc);
+  testAssertString(rc == p7HmmSuccess, "p7HmmListWriteBinary did not return success");
+  p7HmmListDealloc(&phmmList);
+  rc = p7HmmListReadBinary(binaryFileSrc, &phmmList);
+  testAssertString(rc == p7HmmSuccess, "p7HmmListReadBinary did not return success");
+  combinedHmmTest(&phmmList);
+  p7HmmListDealloc(&phmmList);
+  rc = p7HmmListReadBinary(combinedFileSrc, &phmmList);
+  testAssertString(rc == p7HmmFormatError, "p7HmmListReadBinary should reject a text hmm file");
+  remove(binaryFileSrc);
+
+  printf("\n\tstarting streaming combined test\n");
+  struct P7HmmReader *reader;
+  rc = p7HmmReaderOpen(combinedFileSrc, &reader);
+  testAssertString(rc == p7HmmSuccess, "p7HmmReaderOpen did not return success");
+  uint32_t numStreamedModels = 0;
+  struct P7Hmm *streamedPhmm;
+  while((rc = p7HmmReaderNext(reader, &streamedPhmm)) == p7HmmSuccess && streamedPhmm != NULL){
+    if(numStreamedModels < 5){
+      combinedModelTests[numStreamedModels](streamedPhmm);
+    }
+    numStreamedModels++;
+  }
+  testAssertString(rc == p7HmmSuccess, "p7HmmReaderNext did not return success");
+  sprintf(printBuffer, "expected to stream 5 models, but got %u", numStreamedModels);
+  testAssertString(numStreamedModels == 5, printBuffer);
+  p7HmmReaderClose(reader);
+
+  printf("\n\tstarting index combined test\n");
+  rc = p7HmmIndexBuild(combinedFileSrc);
+  testAssertString(rc == p7HmmSuccess, "p7HmmIndexBuild did not return success");
+  struct P7HmmIndex *index;
+  rc = p7HmmIndexOpen(combinedFileSrc, &index);
+  testAssertString(rc == p7HmmSuccess, "p7HmmIndexOpen did not return success");
+  if(rc == p7HmmSuccess){
+    //fetch in reverse file order, alternating names and accessions
+    const char *indexKeys[5] = {"Alpha-amylase", "PF19858.2", "T2SSL", "PF14113.9", "Thioredoxin_10"};
+    for(int32_t i = 4; i >= 0; i--){
+      rc = p7HmmIndexFetch(index, indexKeys[i], &phmmList);
+      sprintf(printBuffer, "p7HmmIndexFetch did not return success for %s", indexKeys[i]);
+      testAssertString(rc == p7HmmSuccess, printBuffer);
+      if(rc == p7HmmSuccess){
+        testAssertString(phmmList.count == 1, "p7HmmIndexFetch did not return exactly one model");
+        combinedModelTests[i](&phmmList.phmms[0]);
+        p7HmmListDealloc(&phmmList);
+      }
+    }
+    rc = p7HmmIndexFetch(index, "PF00128", &phmmList);
+    testAssertString(rc == p7HmmModelNotFound, "p7HmmIndexFetch should not find an accession without its version");
+    p7HmmIndexClose(index);
+  }
+  sprintf(printBuffer, "%s.p7i", combinedFileSrc);
+  remove(printBuffer);
+  rc = p7HmmIndexOpen(combinedFileSrc, &index);
+  testAssertString(rc == p7HmmFileNotFound, "p7HmmIndexOpen should fail without an index");
+  //rename a model in a copy of the file, keeping its length, so only the modification time shows the change
+  const char *indexedFileSrc = "indexedTest.hmm";
+  const struct timespec indexedTimes[2] = {{.tv_sec = 1000000000, .tv_nsec = 0}, {.tv_sec = 1000000000, .tv_nsec = 0}};
+  rc = readP7Hmm(combinedFileSrc, &phmmList);
+  testAssertString(rc == p7HmmSuccess, "readP7Hmm did not return success");
+  rc = p7HmmListWrite(&phmmList, indexedFileSrc);
+  testAssertString(rc == p7HmmSuccess, "p7HmmListWrite did not return success");
+  p7HmmListDealloc(&phmmList);
+  utimensat(AT_FDCWD, indexedFileSrc, indexedTimes, 0);
+  rc = p7HmmIndexBuild(indexedFileSrc);
+  testAssertString(rc == p7HmmSuccess, "p7HmmIndexBuild did not return success");
+  FILE *indexedFile = fopen(indexedFileSrc, "r+");
+  char *indexedLine = NULL;
+  size_t indexedLineCapacity = 0;
+  long indexedLineOffset = 0;
+  while(getline(&indexedLine, &indexedLineCapacity, indexedFile) > 0 && strncmp(indexedLine, "NAME  T2SSL", 11) != 0){
+    indexedLineOffset = ftell(indexedFile);
+  }
+  fseek(indexedFile, indexedLineOffset + 10, SEEK_SET);
+  fputc('X', indexedFile);
+  fclose(indexedFile);
+  free(indexedLine);
+  rc = p7HmmIndexOpen(indexedFileSrc, &index);
+  testAssertString(rc == p7HmmFormatError, "p7HmmIndexOpen should reject a file modified since it was indexed");
+  //with the time restored too, the fetch itself has to notice the model at the offset isn't the one asked for
+  utimensat(AT_FDCWD, indexedFileSrc, indexedTimes, 0);
+  rc = p7HmmIndexOpen(indexedFileSrc, &index);
+  testAssertString(rc == p7HmmSuccess, "p7HmmIndexOpen did not return success");
+  if(rc == p7HmmSuccess){
+    rc = p7HmmIndexFetch(index, "T2SSL", &phmmList);
+    testAssertString(rc == p7HmmFormatError, "p7HmmIndexFetch should reject a model that no longer has the key");
+    rc = p7HmmIndexFetch(index, "Tae4", &phmmList);
+    testAssertString(rc == p7HmmSuccess, "p7HmmIndexFetch did not return success for an unchanged model");
+    p7HmmListDealloc(&phmmList);
+    p7HmmIndexClose(index);
+  }
+  sprintf(printBuffer, "%s.p7i", indexedFileSrc);
+  remove(printBuffer);
+  remove(indexedFileSrc);
+
+  printf("\n\tstarting lazy combined test\n");
+  struct P7HmmLazyList *lazyList;
+  rc = p7HmmLazyOpen(combinedFileSrc, &lazyList);
+  testAssertString(rc == p7HmmSuccess, "p7HmmLazyOpen did not return success");
+  if(rc == p7HmmSuccess){
+    const struct P7HmmList *lazyHeaders = p7HmmLazyHeaders(lazyList);
+    sprintf(printBuffer, "expected 5 lazy models, but got %u", lazyHeaders->count);
+    testAssertString(lazyHeaders->count == 5, printBuffer);
+    for(uint32_t i = 0; i < lazyHeaders->count; i++){
+      testAssertString(lazyHeaders->phmms[i].model.matchEmissionScores == NULL, "lazy model body was parsed before it was requested");
+      testAssertString(lazyHeaders->phmms[i].stats.forwardLambda != 0, "lazy model stats were not parsed");
+    }
+    //load in reverse order, then again to make sure the cached model is returned
+    for(int32_t pass = 0; pass < 2; pass++){
+      for(int32_t i = lazyHeaders->count - 1; i >= 0 && i < 5; i--){
+        struct P7Hmm *lazyPhmm;
+        rc = p7HmmLazyGetModel(lazyList, i, &lazyPhmm);
+        testAssertString(rc == p7HmmSuccess, "p7HmmLazyGetModel did not return success");
+        testAssertString(lazyPhmm == &lazyHeaders->phmms[i], "p7HmmLazyGetModel did not return the listed model");
+        if(rc == p7HmmSuccess){
+          combinedModelTests[i](lazyPhmm);
+        }
+      }
+    }
+    struct P7Hmm *missingPhmm;
+    rc = p7HmmLazyGetModel(lazyList, 5, &missingPhmm);
+    testAssertString(rc == p7HmmModelNotFound, "p7HmmLazyGetModel should not find a 6th model");
+    p7HmmLazyClose(lazyList);
+  }
+
+  printf("\n\tstarting indented terminator test\n");
+  //the parser allows blanks before a '//' terminator, so the scans that skip over model bodies must too
+  const char *indentedFileSrc = "indentedTest.hmm";
+  FILE *indentedFile = fopen(indentedFileSrc, "w");
+  const char *indentedSourceSrcs[2] = {taeFileSrc, thioFileSrc};
+  char *indentedLine = NULL;
+  size_t indentedLineCapacity = 0;
+  for(uint32_t i = 0; i < 2; i++){
+    FILE *sourceFile = fopen(indentedSourceSrcs[i], "r");
+    while(getline(&indentedLine, &indentedLineCapacity, sourceFile) > 0){
+      fprintf(indentedFile, "%s%s", strcmp(indentedLine, "//\n") == 0? "  ": "", indentedLine);
+    }
+    fclose(sourceFile);
+  }
+  free(indentedLine);
+  fclose(indentedFile);
+  rc = readP7Hmm(indentedFileSrc, &phmmList);
+  testAssertString(rc == p7HmmSuccess, "readP7Hmm did not return success on indented terminators");
+  testAssertString(phmmList.count == 2, "readP7Hmm did not read 2 models with indented terminators");
+  p7HmmListDealloc(&phmmList);
+  rc = p7HmmLazyOpen(indentedFileSrc, &lazyList);
+  testAssertString(rc == p7HmmSuccess, "p7HmmLazyOpen did not return success on indented terminators");
+  if(rc == p7HmmSuccess){
+    testAssertString(p7HmmLazyHeaders(lazyList)->count == 2, "p7HmmLazyOpen did not list 2 models with indented terminators");
+    for(uint32_t i = 0; i < p7HmmLazyHeaders(lazyList)->count && i < 2; i++){
+      struct P7Hmm *lazyPhmm;
+      rc = p7HmmLazyGetModel(lazyList, i, &lazyPhmm);
+      testAssertString(rc == p7HmmSuccess, "p7HmmLazyGetModel did not return success on indented terminators");
+      if(rc == p7HmmSuccess){
+        (i == 0? taeHmmTest: thioHmmTest)(lazyPhmm);
+      }
+    }
+    p7HmmLazyClose(lazyList);
+  }
+  rc = p7HmmIndexBuild(indentedFileSrc);
+  testAssertString(rc == p7HmmSuccess, "p7HmmIndexBuild did not return success on indented terminators");
+  rc = p7HmmIndexOpen(indentedFileSrc, &index);
+  testAssertString(rc == p7HmmSuccess, "p7HmmIndexOpen did not return success on indented terminators");
+  if(rc == p7HmmSuccess){
+    const char *indentedKeys[2] = {"Tae4", "Thioredoxin_10"};
+    for(uint32_t i = 0; i < 2; i++){
+      rc = p7HmmIndexFetch(index, indentedKeys[i], &phmmList);
+      sprintf(printBuffer, "p7HmmIndexFetch did not return success for indented %s", indentedKeys[i]);
+      testAssertString(rc == p7HmmSuccess, printBuffer);
+      if(rc == p7HmmSuccess){
+        (i == 0? taeHmmTest: thioHmmTest)(&phmmList.phmms[0]);
+        p7HmmListDealloc(&phmmList);
+      }
+    }
+    p7HmmIndexClose(index);
+  }
+  //one byte blocks, so each model ends up in a block of its own
+  rc = p7HmmBlockCompressFile(indentedFileSrc, blockFileSrc, 1);
+  testAssertString(rc == p7HmmSuccess, "p7HmmBlockCompressFile did not return success on indented terminators");
+  rc = readP7HmmBlockCompressedModel(blockFileSrc, 1, &phmmList);
+  testAssertString(rc == p7HmmSuccess, "readP7HmmBlockCompressedModel did not find the model after an indented terminator");
+  if(rc == p7HmmSuccess){
+    testAssertString(phmmList.count == 1, "readP7HmmBlockCompressedModel should return exactly one model");
+    thioHmmTest(&phmmList.phmms[0]);
+    p7HmmListDealloc(&phmmList);
+  }
+  remove(blockFileSrc);
+  sprintf(printBuffer, "%s.p7bi", blockFileSrc);
+  remove(printBuffer);
+  sprintf(printBuffer, "%s.p7i", indentedFileSrc);
+  remove(printBuffer);
+  remove(indentedFileSrc);
+
+  printf("\n\tstarting filtered combined test\n");
+  //keeps models with LENG of at least 160, i.e., Alpha-amylase (336), OxRdtase_C (163) and T2SSL (233)
+  uint32_t minLength = 160;
+  rc = readP7HmmFiltered(combinedFileSrc, filterByLength, &minLength, &phmmList);
+  testAssertString(rc == p7HmmSuccess, "readP7HmmFiltered did not return success");
+  sprintf(printBuffer, "expected 3 models to pass the filter, but got %u", phmmList.count);
+  testAssertString(phmmList.count == 3, printBuffer);
+  if(rc == p7HmmSuccess && phmmList.count == 3){
+    amalyseHmmTest(&phmmList.phmms[0]);
+    oxHmmTest(&phmmList.phmms[1]);
+    t2HmmTest(&phmmList.phmms[2]);
+  }
+  p7HmmListDealloc(&phmmList);
+  minLength = UINT32_MAX;
+  rc = readP7HmmFiltered(combinedFileSrc, filterByLength, &minLength, &phmmList);
+  testAssertString(rc == p7HmmSuccess, "readP7HmmFiltered did not return success when rejecting every model");
+  testAssertString(phmmList.count == 0, "readP7HmmFiltered kept a model that should have been rejected");
+  p7HmmListDealloc(&phmmList);
+
+  printf("\n\tstarting skipped fields combined test\n");
+  struct P7HmmList fullList;
+  rc = readP7Hmm(combinedFileSrc, &fullList);
+  testAssertString(rc == p7HmmSuccess, "readP7Hmm did not return success");
+  const uint32_t skipFieldMasks[2] = {p7HmmSkipConsensusStructure | p7HmmSkipCommandHistory,
+    p7HmmSkipInsertEmissions | p7HmmSkipCompo | p7HmmSkipAnnotations | p7HmmSkipCommandHistory};
+  for(uint32_t maskIndex = 0; maskIndex < 2 && rc == p7HmmSuccess; maskIndex++){
+    const uint32_t skipFields = skipFieldMasks[maskIndex];
+    rc = readP7HmmSkippingFields(combinedFileSrc, skipFields, &phmmList);
+    testAssertString(rc == p7HmmSuccess, "readP7HmmSkippingFields did not return success");
+    testAssertString(phmmList.count == fullList.count, "readP7HmmSkippingFields did not read every model");
+    for(uint32_t i = 0; i < phmmList.count && i < fullList.count; i++){
+      const struct P7Hmm *phmm = &phmmList.phmms[i];
+      const struct P7Hmm *fullPhmm = &fullList.phmms[i];
+      const uint32_t numScores = p7HmmGetAlphabetCardinality(phmm) * phmm->header.modelLength;
+      testAssertString(memcmp(phmm->model.matchEmissionScores, fullPhmm->model.matchEmissionScores,
+        numScores * sizeof(float)) == 0, "match emissions differed when skipping fields");
+      testAssertString(memcmp(phmm->model.stateTransitions.matchToMatch, fullPhmm->model.stateTransitions.matchToMatch,
+        phmm->header.modelLength * sizeof(float)) == 0, "transitions differed when skipping fields");
+      testAssertString(phmm->header.commandLineHistory == NULL, "command history was kept when skipped");
+      testAssertString(!phmm->header.hasConsensusStructure && phmm->model.consensusStructure == NULL,
+        "consensus structure was kept when skipped");
+      if(skipFields & p7HmmSkipInsertEmissions){
+        testAssertString(phmm->model.insertEmissionScores == NULL && phmm->model.compo == NULL,
+          "insert emissions or compo were kept when skipped");
+        testAssertString(phmm->model.mapAnnotations == NULL && phmm->model.consensusResidues == NULL &&
+          phmm->model.referenceAnnotation == NULL && phmm->model.modelMask == NULL, "annotations were kept when skipped");
+        testAssertString(!phmm->header.hasMapAnnotation && !phmm->header.hasConsensusResidue,
+          "annotation flags were left set when skipped");
+        testAssertString(isnan(p7HmmGetInsertEmissionScores(phmm, 0, 0)),
+          "skipped insert emission score should be NaN");
+      }
+      else{
+        testAssertString(memcmp(phmm->model.insertEmissionScores, fullPhmm->model.insertEmissionScores,
+          numScores * sizeof(float)) == 0, "insert emissions differed when they weren't skipped");
+        testAssertString(memcmp(phmm->model.mapAnnotations, fullPhmm->model.mapAnnotations,
+          phmm->header.modelLength * sizeof(uint32_t)) == 0, "map annotations differed when they weren't skipped");
+        testAssertString(memcmp(phmm->model.compo, fullPhmm->model.compo,
+          p7HmmGetAlphabetCardinality(phmm) * sizeof(float)) == 0, "compo differed when it wasn't skipped");
+      }
+    }
+    if(skipFields & p7HmmSkipInsertEmissions){
+      FILE *skippedFile = fopen("skippedWriteTest.hmm", "w");
+      rc = p7HmmWrite(&phmmList.phmms[0], skippedFile);
+      fclose(skippedFile);
+      remove("skippedWriteTest.hmm");
+      testAssertString(rc == p7HmmFormatError, "p7HmmWrite should refuse a model without insert emissions");
+      rc = p7HmmSuccess;
+    }
+    p7HmmListDealloc(&phmmList);
+  }
+  p7HmmListDealloc(&fullList);
+
+  printf("\n\tstarting packed layout test\n");
+  rc = readP7Hmm(combinedFileSrc, &phmmList);
+  testAssertString(rc == p7HmmSuccess, "readP7Hmm did not return success");
+  for(uint32_t i = 0; i < phmmList.count && rc == p7HmmSuccess; i++){
+    const struct P7Hmm *phmm = &phmmList.phmms[i];
+    const struct P7StateTransitions *transitions = &phmm->model.stateTransitions;
+    struct P7HmmPackedModel packedModel;
+    rc = p7HmmPackModel(phmm, &packedModel);
+    testAssertString(rc == p7HmmSuccess, "p7HmmPackModel did not return success");
+    testAssertString((uintptr_t)packedModel.nodes % P7_MODEL_DATA_ALIGNMENT == 0 &&
+      (packedModel.nodeStride * sizeof(float)) % P7_MODEL_DATA_ALIGNMENT == 0, "packed records were not aligned");
+    for(uint32_t nodeIndex = 0; nodeIndex < phmm->header.modelLength && rc == p7HmmSuccess; nodeIndex++){
+      for(uint32_t symbolIndex = 0; symbolIndex < p7HmmGetAlphabetCardinality(phmm); symbolIndex++){
+        testAssertString(p7HmmPackedGetMatchEmissionScore(&packedModel, nodeIndex, symbolIndex) ==
+          p7HmmGetMatchEmissionScore(phmm, nodeIndex, symbolIndex), "packed match emission differed");
+        testAssertString(p7HmmPackedGetInsertEmissionScore(&packedModel, nodeIndex, symbolIndex) ==
+          p7HmmGetInsertEmissionScores(phmm, nodeIndex, symbolIndex), "packed insert emission differed");
+      }
+      testAssertString(p7HmmPackedGetTransition(&packedModel, nodeIndex, p7HmmMatchToMatch) ==
+        transitions->matchToMatch[nodeIndex], "packed match to match transition differed");
+      testAssertString(p7HmmPackedGetTransition(&packedModel, nodeIndex, p7HmmInsertToInsert) ==
+        transitions->insertToInsert[nodeIndex], "packed insert to insert transition differed");
+      //the last node's delete to delete transition is NaN, so compare the bits
+      testAssertString(memcmp(&p7HmmPackedGetNode(&packedModel, nodeIndex)[p7HmmDeleteToDelete],
+        &transitions->deleteToDelete[nodeIndex], sizeof(float)) == 0, "packed delete to delete transition differed");
+    }
+    testAssertString(p7HmmPackedGetNode(&packedModel, phmm->header.modelLength) == NULL &&
+      isnan(p7HmmPackedGetMatchEmissionScore(&packedModel, phmm->header.modelLength, 0)),
+      "out of range packed node should not be returned");
+    p7HmmPackedModelDealloc(&packedModel);
+  }
+  p7HmmListDealloc(&phmmList);
+
+  printf("\n\tstarting striped profile test\n");
+  rc = readP7Hmm(combinedFileSrc, &phmmList);
+  testAssertString(rc == p7HmmSuccess, "readP7Hmm did not return success");
+  const enum P7HmmVectorWidth vectorWidths[3] = {p7HmmVectorWidthSse2, p7HmmVectorWidthAvx2, p7HmmVectorWidthAvx512};
+  for(uint32_t i = 0; i < phmmList.count && rc == p7HmmSuccess; i++){
+    const struct P7Hmm *phmm = &phmmList.phmms[i];
+    const uint32_t alphabetCardinality = p7HmmGetAlphabetCardinality(phmm);
+    const uint32_t modelLength = phmm->header.modelLength;
+    for(uint32_t widthIndex = 0; widthIndex < 3 && rc == p7HmmSuccess; widthIndex++){
+      const uint32_t width = vectorWidths[widthIndex];
+      struct P7HmmStripedProfile profile;
+      rc = p7HmmStripeProfile(phmm, vectorWidths[widthIndex], &profile);
+      testAssertString(rc == p7HmmSuccess, "p7HmmStripeProfile did not return success");
+      if(rc != p7HmmSuccess){
+        break;
+      }
+      testAssertString((uintptr_t)profile.msvMatchCosts % P7_MODEL_DATA_ALIGNMENT == 0 &&
+        (uintptr_t)profile.viterbiTransitions % P7_MODEL_DATA_ALIGNMENT == 0 &&
+        (uintptr_t)profile.forwardTransitions % P7_MODEL_DATA_ALIGNMENT == 0, "striped profile arrays were not aligned");
+      testAssertString(profile.msvNumSegments * width >= modelLength &&
+        profile.forwardNumSegments * (width / 4) >= modelLength, "striped profile had too few segments");
+      uint8_t minMsvCost = 255;
+      for(uint32_t symbolIndex = 0; symbolIndex < alphabetCardinality; symbolIndex++){
+        for(uint32_t segment = 0; segment < profile.msvNumSegments; segment++){
+          for(uint32_t lane = 0; lane < width; lane++){
+            const uint8_t cost = profile.msvMatchCosts[(symbolIndex * profile.msvNumSegments + segment) * width + lane];
+            if(segment + lane * profile.msvNumSegments >= modelLength){
+              testAssertString(cost == 255, "striped MSV padding was not the worst cost");
+            }
+            minMsvCost = cost < minMsvCost? cost: minMsvCost;
+          }
+        }
+        const uint32_t viterbiLanes = width / 2;
+        const uint32_t forwardLanes = width / 4;
+        for(uint32_t nodeIndex = 0; nodeIndex < modelLength; nodeIndex++){
+          const float logOdds = phmm->model.insert0Emissions[symbolIndex] - p7HmmGetMatchEmissionScore(phmm, nodeIndex, symbolIndex);
+          const uint32_t viterbiPosition = (symbolIndex * profile.viterbiNumSegments + nodeIndex % profile.viterbiNumSegments) *
+            viterbiLanes + nodeIndex / profile.viterbiNumSegments;
+          testAssertString(profile.viterbiMatchScores[viterbiPosition] == (int16_t)roundf(profile.viterbiScale * logOdds),
+            "striped Viterbi match score differed");
+          const uint32_t forwardPosition = (symbolIndex * profile.forwardNumSegments + nodeIndex % profile.forwardNumSegments) *
+            forwardLanes + nodeIndex / profile.forwardNumSegments;
+          testAssertString(fabsf(profile.forwardMatchOdds[forwardPosition] - expf(logOdds)) <= 1e-5f * expf(logOdds),
+            "striped Forward match odds differed");
+        }
+      }
+      testAssertString(minMsvCost == 0, "the best striped MSV score was not biased to a cost of 0");
+      //node 0's MM vector lane holds the begin to M1 transition, and node 1's holds M1 to M2
+      const uint32_t forwardLanes = width / 4;
+      const float *forwardTransitions = profile.forwardTransitions;
+      testAssertString(fabsf(forwardTransitions[p7HmmStripedMatchToMatch * forwardLanes] -
+        expf(-phmm->model.initialTransitions.beginToM1)) < 1e-6f, "striped begin to M1 transition differed");
+      testAssertString(fabsf(forwardTransitions[(p7HmmStripedNumTransitions + p7HmmStripedMatchToMatch) * forwardLanes] -
+        expf(-phmm->model.stateTransitions.matchToMatch[0])) < 1e-6f, "striped M1 to M2 transition differed");
+      testAssertString(forwardTransitions[p7HmmStripedDeleteToMatch * forwardLanes] == 0.0f,
+        "striped profile should not have a D0 to M1 transition");
+      p7HmmStripedProfileDealloc(&profile);
+    }
+  }
+  p7HmmListDealloc(&phmmList);
+  struct P7HmmStripedProfile autoProfile;
+  rc = readP7Hmm(taeFileSrc, &phmmList);
+  if(rc == p7HmmSuccess){
+    rc = p7HmmStripeProfile(&phmmList.phmms[0], p7HmmVectorWidthAuto, &autoProfile);
+    testAssertString(rc == p7HmmSuccess && autoProfile.vectorWidth == p7HmmDetectVectorWidth(),
+      "p7HmmVectorWidthAuto did not pick the detected vector width");
+    p7HmmStripedProfileDealloc(&autoProfile);
+    testAssertString(p7HmmStripeProfile(&phmmList.phmms[0], 24, &autoProfile) == p7HmmFormatError,
+      "p7HmmStripeProfile should reject an unsupported vector width");
+  }
+  p7HmmListDealloc(&phmmList);
+
+  printf("\n\tstarting quantized storage test\n");
+  rc = readP7HmmQuantized(combinedFileSrc, (enum P7HmmScorePrecision)(p7HmmPrecisionByte + 1), &phmmList);
+  testAssertString(rc == p7HmmFormatError && phmmList.count == 0, "readP7HmmQuantized should reject an invalid precision");
+  rc = readP7Hmm(combinedFileSrc, &fullList);
+  testAssertString(rc == p7HmmSuccess, "readP7Hmm did not return success");
+  const enum P7HmmScorePrecision precisions[3] = {p7HmmPrecisionHalf, p7HmmPrecisionFixed16, p7HmmPrecisionByte};
+  for(uint32_t precisionIndex = 0; precisionIndex < 3 && rc == p7HmmSuccess; precisionIndex++){
+    const enum P7HmmScorePrecision precision = precisions[precisionIndex];
+    rc = readP7HmmQuantized(combinedFileSrc, precision, &phmmList);
+    testAssertString(rc == p7HmmSuccess, "readP7HmmQuantized did not return success");
+    testAssertString(phmmList.count == fullList.count, "readP7HmmQuantized did not read every model");
+    for(uint32_t i = 0; i < phmmList.count && i < fullList.count; i++){
+      struct P7Hmm *phmm = &phmmList.phmms[i];
+      const struct P7Hmm *fullPhmm = &fullList.phmms[i];
+      const uint32_t alphabetCardinality = p7HmmGetAlphabetCardinality(phmm);
+      const uint32_t modelLength = phmm->header.modelLength;
+      testAssertString(phmm->model.matchEmissionScores == NULL && phmm->model.stateTransitions.matchToMatch == NULL &&
+        phmm->model.quantized.precision == precision, "quantized model kept its float scores");
+      testAssertString(memcmp(phmm->model.consensusResidues, fullPhmm->model.consensusResidues, modelLength) == 0 &&
+        memcmp(phmm->model.compo, fullPhmm->model.compo, alphabetCardinality * sizeof(float)) == 0,
+        "quantized model did not keep its annotations and compo");
+      //half precision has 11 significant bits, and byte codes are a 252nd of the model's score range
+      const float byteStep = 1.0f / phmm->model.quantized.scale;
+      float *decodedScores = malloc(alphabetCardinality * modelLength * sizeof(float));
+      testAssertString(p7HmmDequantizeMatchEmissions(phmm, decodedScores) == p7HmmSuccess,
+        "p7HmmDequantizeMatchEmissions did not return success");
+      for(uint32_t nodeIndex = 0; nodeIndex < modelLength; nodeIndex++){
+        for(uint32_t symbolIndex = 0; symbolIndex < alphabetCardinality; symbolIndex++){
+          const float expected[2] = {p7HmmGetMatchEmissionScore(fullPhmm, nodeIndex, symbolIndex),
+            p7HmmGetInsertEmissionScores(fullPhmm, nodeIndex, symbolIndex)};
+          const float decoded[2] = {p7HmmGetMatchEmissionScore(phmm, nodeIndex, symbolIndex),
+            p7HmmGetInsertEmissionScores(phmm, nodeIndex, symbolIndex)};
+          for(uint32_t j = 0; j < 2; j++){
+            const float tolerance = precision == p7HmmPrecisionHalf? fabsf(expected[j]) / 2048.0f:
+              precision == p7HmmPrecisionFixed16? 0.0005f: byteStep / 2.0f;
+            testAssertString(fabsf(decoded[j] - expected[j]) <= tolerance * 1.001f, "quantized emission score was out of tolerance");
+          }
+          testAssertString(decodedScores[nodeIndex * alphabetCardinality + symbolIndex] == decoded[0],
+            "bulk dequantized match emission differed from the getter");
+        }
+        for(uint32_t transition = p7HmmMatchToMatch; transition <= p7HmmDeleteToDelete; transition++){
+          const float expected = p7HmmGetTransitionScore(fullPhmm, nodeIndex, transition);
+          const float decoded = p7HmmGetTransitionScore(phmm, nodeIndex, transition);
+          const float tolerance = precision == p7HmmPrecisionHalf? fabsf(expected) / 2048.0f:
+            precision == p7HmmPrecisionFixed16? 0.0005f: byteStep / 2.0f;
+          testAssertString(isnan(expected)? isnan(decoded): fabsf(decoded - expected) <= tolerance * 1.001f,
+            "quantized transition score was out of tolerance");
+        }
+      }
+      const float lastDecodedScore = p7HmmGetTransitionScore(phmm, modelLength - 2, p7HmmDeleteToDelete);
+      rc = p7HmmDequantizeModel(phmm);
+      testAssertString(rc == p7HmmSuccess && phmm->model.quantized.matchEmissionScores == NULL &&
+        memcmp(phmm->model.matchEmissionScores, decodedScores, alphabetCardinality * modelLength * sizeof(float)) == 0 &&
+        phmm->model.stateTransitions.deleteToDelete[modelLength - 2] == lastDecodedScore,
+        "p7HmmDequantizeModel did not restore the decoded scores");
+      free(decodedScores);
+    }
+    p7HmmListDealloc(&phmmList);
+  }
+  //models in an arena list take their new blocks from the arena, so nothing in the list is freed on its own
+  rc = readP7HmmWithArena(combinedFileSrc, &phmmList);
+  testAssertString(rc == p7HmmSuccess, "readP7HmmWithArena did not return success");
+  for(uint32_t i = 0; i < phmmList.count && i < fullList.count; i++){
+    struct P7Hmm *phmm = &phmmList.phmms[i];
+    rc = p7HmmQuantizeModel(phmm, p7HmmPrecisionFixed16);
+    testAssertString(rc == p7HmmSuccess && phmm->model.quantized.matchEmissionScores != NULL,
+      "p7HmmQuantizeModel did not quantize an arena model");
+    testAssertString(fabsf(p7HmmGetMatchEmissionScore(phmm, 0, 0) - p7HmmGetMatchEmissionScore(&fullList.phmms[i], 0, 0))
+      <= 0.0005f, "quantized arena model's score was out of tolerance");
+    if(i % 2 == 0){
+      rc = p7HmmDequantizeModel(phmm);
+      testAssertString(rc == p7HmmSuccess && phmm->model.matchEmissionScores != NULL &&
+        phmm->model.arena == phmmList.arena, "p7HmmDequantizeModel did not restore an arena model from the arena");
+    }
+  }
+  p7HmmListDealloc(&phmmList);
+  p7HmmListDealloc(&fullList);
+  //an impossible transition or emission (-ln(0)) must stay impossible, rather than saturating to a finite score
+  for(uint32_t precisionIndex = 0; precisionIndex < 3; precisionIndex++){
+    rc = readP7Hmm(thioFileSrc, &phmmList);
+    testAssertString(rc == p7HmmSuccess, "readP7Hmm did not return success");
+    if(rc != p7HmmSuccess){
+      break;
+    }
+    struct P7Hmm *phmm = &phmmList.phmms[0];
+    phmm->model.matchEmissionScores[1] = INFINITY;
+    phmm->model.stateTransitions.matchToDelete[2] = INFINITY;
+    phmm->model.stateTransitions.insertToInsert[3] = -INFINITY;
+    rc = p7HmmQuantizeModel(phmm, precisions[precisionIndex]);
+    testAssertString(rc == p7HmmSuccess, "p7HmmQuantizeModel did not return success");
+    testAssertString(isinf(p7HmmGetMatchEmissionScore(phmm, 0, 1)) && p7HmmGetMatchEmissionScore(phmm, 0, 1) > 0,
+      "quantized infinite emission was not kept infinite");
+    testAssertString(p7HmmGetTransitionScore(phmm, 2, p7HmmMatchToDelete) == INFINITY &&
+      p7HmmGetTransitionScore(phmm, 3, p7HmmInsertToInsert) == -INFINITY,
+      "quantized infinite transition was not kept infinite");
+    testAssertString(isfinite(p7HmmGetMatchEmissionScore(phmm, 0, 0)), "quantized finite emission became infinite");
+    rc = p7HmmDequantizeModel(phmm);
+    testAssertString(rc == p7HmmSuccess && phmm->model.matchEmissionScores[1] == INFINITY &&
+      phmm->model.stateTransitions.matchToDelete[2] == INFINITY, "dequantized infinite score was not infinite");
+    p7HmmListDealloc(&phmmList);
+  }
+
+  printf("\n\tstarting transposed emissions test\n");
+  for(uint32_t useArena = 0; useArena < 2; useArena++){
+    rc = useArena? readP7HmmWithArena(combinedFileSrc, &phmmList): readP7Hmm(combinedFileSrc, &phmmList);
+    testAssertString(rc == p7HmmSuccess, "reading the combined file did not return success");
+    for(uint32_t i = 0; i < phmmList.count; i++){
+      struct P7Hmm *phmm = &phmmList.phmms[i];
+      const uint32_t alphabetCardinality = p7HmmGetAlphabetCardinality(phmm);
+      testAssertString(phmm->model.transposedMatchEmissions == NULL, "transposed emissions were built before use");
+      for(uint32_t symbolIndex = 0; symbolIndex < alphabetCardinality; symbolIndex++){
+        const float *row = p7HmmGetSymbolMatchEmissions(phmm, symbolIndex);
+        testAssertString(row != NULL && (uintptr_t)row % P7_MODEL_DATA_ALIGNMENT == 0,
+          "transposed emission row was not aligned");
+        if(row == NULL){
+          break;
+        }
+        uint32_t nodeIndex = 0;
+        for(; nodeIndex < phmm->header.modelLength; nodeIndex++){
+          testAssertString(row[nodeIndex] == p7HmmGetMatchEmissionScore(phmm, nodeIndex, symbolIndex),
+            "transposed match emission differed");
+        }
+        for(; nodeIndex % P7_HMM_TRANSPOSED_ROW_PADDING != 0; nodeIndex++){
+          testAssertString(isinf(row[nodeIndex]), "transposed emission row padding was not INFINITY");
+        }
+      }
+      const float *firstRow = phmm->model.transposedMatchEmissions;
+      testAssertString(p7HmmGetSymbolMatchEmissions(phmm, 0) == firstRow, "transposed emissions were rebuilt");
+      testAssertString(p7HmmGetSymbolMatchEmissions(phmm, alphabetCardinality) == NULL,
+        "out of range symbol should not have a transposed row");
+      //the rounded scores must not be served from a transposed copy of the original floats
+      rc = p7HmmQuantizeModel(phmm, p7HmmPrecisionByte);
+      testAssertString(rc == p7HmmSuccess, "p7HmmQuantizeModel did not return success");
+      testAssertString(p7HmmGetSymbolMatchEmissions(phmm, 0) == NULL, "quantized model still had transposed emissions");
+      rc = p7HmmDequantizeModel(phmm);
+      testAssertString(rc == p7HmmSuccess, "p7HmmDequantizeModel did not return success");
+      for(uint32_t symbolIndex = 0; symbolIndex < alphabetCardinality; symbolIndex++){
+        const float *row = p7HmmGetSymbolMatchEmissions(phmm, symbolIndex);
+        testAssertString(row != NULL, "transposed emissions were not rebuilt after dequantizing");
+        for(uint32_t nodeIndex = 0; row != NULL && nodeIndex < phmm->header.modelLength; nodeIndex++){
+          testAssertString(row[nodeIndex] == p7HmmGetMatchEmissionScore(phmm, nodeIndex, symbolIndex),
+            "transposed match emission differed after quantizing");
+        }
+      }
+    }
+    p7HmmListDealloc(&phmmList);
+  }
+
+  printf("\n\tstarting compacted insert emissions test\n");
+  rc = readP7Hmm(combinedFileSrc, &fullList);
+  testAssertString(rc == p7HmmSuccess, "readP7Hmm did not return success");
+  rc = readP7HmmCompactInserts(combinedFileSrc, &phmmList);
+  testAssertString(rc == p7HmmSuccess, "readP7HmmCompactInserts did not return success");
+  testAssertString(phmmList.count == fullList.count, "readP7HmmCompactInserts did not read every model");
+  for(uint32_t i = 0; i < phmmList.count && i < fullList.count; i++){
+    const struct P7Hmm *phmm = &phmmList.phmms[i];
+    const struct P7Hmm *fullPhmm = &fullList.phmms[i];
+    const uint32_t alphabetCardinality = p7HmmGetAlphabetCardinality(phmm);
+    testAssertString(phmm->model.insertEmissionScores == NULL && phmm->model.insertRowIndices != NULL,
+      "compacted model kept a row of insert emissions per node");
+    sprintf(printBuffer, "model %u kept %u unique insert rows for %u nodes", i, phmm->model.numUniqueInsertRows,
+      phmm->header.modelLength);
+    testAssertString(phmm->model.numUniqueInsertRows != 0 && phmm->model.numUniqueInsertRows < phmm->header.modelLength,
+      printBuffer);
+    for(uint32_t nodeIndex = 0; nodeIndex < phmm->header.modelLength; nodeIndex++){
+      testAssertString(phmm->model.insertRowIndices[nodeIndex] < phmm->model.numUniqueInsertRows,
+        "insert row index was out of range");
+      for(uint32_t symbolIndex = 0; symbolIndex < alphabetCardinality; symbolIndex++){
+        testAssertString(p7HmmGetInsertEmissionScores(phmm, nodeIndex, symbolIndex) ==
+          p7HmmGetInsertEmissionScores(fullPhmm, nodeIndex, symbolIndex), "compacted insert emission differed");
+      }
+    }
+  }
+  p7HmmListDealloc(&fullList);
+  if(rc == p7HmmSuccess){
+    const char *compactedFileSrc = "compactedTest.hmm";
+    rc = p7HmmListWrite(&phmmList, compactedFileSrc);
+    testAssertString(rc == p7HmmSuccess, "p7HmmListWrite did not return success for compacted models");
+    testAssertString(filesAreIdentical(combinedFileSrc, compactedFileSrc, false),
+      "written copy of the compacted models was not byte identical to the original");
+    remove(compactedFileSrc);
+    rc = p7HmmQuantizeModel(&phmmList.phmms[0], p7HmmPrecisionHalf);
+    testAssertString(rc == p7HmmSuccess && phmmList.phmms[0].model.insertRowIndices != NULL &&
+      p7HmmGetInsertEmissionScores(&phmmList.phmms[0], 0, 0) == phmmList.phmms[0].model.uniqueInsertEmissions[
+        phmmList.phmms[0].model.insertRowIndices[0] * p7HmmGetAlphabetCardinality(&phmmList.phmms[0])],
+      "quantizing a compacted model did not keep its insert rows");
+    rc = p7HmmListWriteBinary(&phmmList, binaryFileSrc);
+    testAssertString(rc == p7HmmFormatError, "quantized models should not be written as binary");
+    rc = p7HmmDequantizeModel(&phmmList.phmms[0]);
+    testAssertString(rc == p7HmmSuccess, "p7HmmDequantizeModel did not return success");
+    rc = p7HmmListWriteBinary(&phmmList, binaryFileSrc);
+    testAssertString(rc == p7HmmSuccess, "p7HmmListWriteBinary did not return success for compacted models");
+    p7HmmListDealloc(&phmmList);
+    rc = p7HmmListReadBinary(binaryFileSrc, &phmmList);
+    testAssertString(rc == p7HmmSuccess, "p7HmmListReadBinary did not return success");
+    combinedHmmTest(&phmmList);
+    remove(binaryFileSrc);
+  }
   p7HmmListDealloc(&phmmList);
+
+  printf("\n\tstarting validation test\n");
+  rc = p7HmmValidateFile(combinedFileSrc, &phmmList);
+  testAssertString(rc == p7HmmSuccess, "p7HmmValidateFile did not return success");
+  testAssertString(phmmList.count == 5, "p7HmmValidateFile did not summarize every model");
+  const char *expectedNames[5] = {"Alpha-amylase", "OxRdtase_C", "T2SSL", "Tae4", "Thioredoxin_10"};
+  const uint32_t expectedLengths[5] = {336, 163, 233, 121, 142};
+  for(uint32_t i = 0; i < phmmList.count && i < 5; i++){
+    testAssertString(strcmp(phmmList.phmms[i].header.name, expectedNames[i]) == 0, "validation summary had the wrong name");
+    testAssertString(phmmList.phmms[i].header.modelLength == expectedLengths[i], "validation summary had the wrong length");
+    testAssertString(phmmList.phmms[i].model.matchEmissionScores == NULL && phmmList.phmms[i].model.compo == NULL &&
+      phmmList.phmms[i].model.mapAnnotations == NULL, "p7HmmValidateFile allocated model data");
+  }
+  p7HmmListDealloc(&phmmList);
+  //cut the combined file off partway through the third model's body
+  const char *truncatedFileSrc = "truncatedTest.hmm";
+  combinedFile = fopen(combinedFileSrc, "r");
+  FILE *truncatedFile = fopen(truncatedFileSrc, "w");
+  char *truncatedLine = NULL;
+  size_t truncatedLineCapacity = 0;
+  uint32_t numModelsStarted = 0;
+  uint32_t numThirdModelLines = 0;
+  while(getline(&truncatedLine, &truncatedLineCapacity, combinedFile) > 0 && numThirdModelLines < 100){
+    numModelsStarted += strncmp(truncatedLine, "HMMER3", 6) == 0;
+    numThirdModelLines += numModelsStarted == 3;
+    fputs(truncatedLine, truncatedFile);
+  }
+  free(truncatedLine);
+  fclose(combinedFile);
+  fclose(truncatedFile);
+  rc = p7HmmValidateFile(truncatedFileSrc, &phmmList);
+  testAssertString(rc == p7HmmFormatError, "p7HmmValidateFile did not report the truncated model");
+  sprintf(printBuffer, "expected summaries for the 2 models before the truncated one, but got %u", phmmList.count);
+  testAssertString(phmmList.count == 2, printBuffer);
+  p7HmmListDealloc(&phmmList);
+  rc = readP7Hmm(truncatedFileSrc, &phmmList);
+  testAssertString(rc == p7HmmFormatError, "readP7Hmm and p7HmmValidateFile disagreed on the truncated file");
+  remove(truncatedFileSrc);
+
+  const char *writeFileSrcs[6] ={amylaseFileSrc, oxFileSrc, t2FileSrc, taeFileSrc, thioFileSrc, combinedFileSrc};
+  const char *writtenFileSrc = "writeTest.hmm";
+  for(uint32_t i = 0; i < 6; i++){
+    printf("\n\tstarting write test for %s\n", writeFileSrcs[i]);
+    rc = readP7Hmm(writeFileSrcs[i], &phmmList);
+    testAssertString(rc == p7HmmSuccess, "readP7Hmm did not return success");
+    rc = p7HmmListWrite(&phmmList, writtenFileSrc);
+    testAssertString(rc == p7HmmSuccess, "p7HmmListWrite did not return success");
+    p7HmmListDealloc(&phmmList);
+    sprintf(printBuffer, "written copy of %s was not identical to the original", writeFileSrcs[i]);
+    testAssertString(filesAreIdentical(writeFileSrcs[i], writtenFileSrc, true), printBuffer);
+  }
+  //every model in the combined file is exactly as HMMER wrote it, so the copy must match byte for byte
+  rc = readP7Hmm(combinedFileSrc, &phmmList);
+  testAssertString(rc == p7HmmSuccess, "readP7Hmm did not return success");
+  if(rc == p7HmmSuccess){
+    FILE *writtenFile = fopen(writtenFileSrc, "w");
+    for(uint32_t i = 0; i < phmmList.count; i++){
+      rc = p7HmmWrite(&phmmList.phmms[i], writtenFile);
+      testAssertString(rc == p7HmmSuccess, "p7HmmWrite did not return success");
+    }
+    fclose(writtenFile);
+    testAssertString(filesAreIdentical(combinedFileSrc, writtenFileSrc, false),
+      "written copy of the combined file was not byte identical to the original");
+    p7HmmListDealloc(&phmmList);
+  }
+  //none of the test files have a model mask, so give Tae4 one. HMMER marks unmasked nodes with '.' when MM is yes.
+  printf("\n\tstarting model mask write test\n");
+  const char *maskedFileSrc = "maskedTest.hmm";
+  FILE *taeFile = fopen(taeFileSrc, "r");
+  FILE *maskedFile = fopen(maskedFileSrc, "w");
+  char *maskedLine = NULL;
+  size_t maskedLineCapacity = 0;
+  ssize_t maskedLineLength;
+  uint32_t numMatchLines = 0;
+  while((maskedLineLength = getline(&maskedLine, &maskedLineCapacity, taeFile)) > 0){
+    if(strncmp(maskedLine, "MM ", 3) == 0){
+      strcpy(maskedLine, "MM    yes\n");
+    }
+    else if(maskedLineLength >= 7 && strcmp(maskedLine + maskedLineLength - 6, "- - -\n") == 0){
+      //the mask is the second to last annotation column of each match line
+      maskedLine[maskedLineLength - 4] = numMatchLines++ == 0? 'm': '.';
+    }
+    fputs(maskedLine, maskedFile);
+  }
+  free(maskedLine);
+  fclose(taeFile);
+  fclose(maskedFile);
+  rc = readP7Hmm(maskedFileSrc, &phmmList);
+  testAssertString(rc == p7HmmSuccess, "readP7Hmm did not return success on the masked file");
+  if(rc == p7HmmSuccess){
+    testAssertString(phmmList.phmms[0].header.hasModelMask && phmmList.phmms[0].model.modelMask[0] &&
+      !phmmList.phmms[0].model.modelMask[1], "model mask was not read");
+    rc = p7HmmListWrite(&phmmList, writtenFileSrc);
+    testAssertString(rc == p7HmmSuccess, "p7HmmListWrite did not return success");
+    testAssertString(filesAreIdentical(maskedFileSrc, writtenFileSrc, true),
+      "written copy of the masked file was not identical to the original");
+    p7HmmListDealloc(&phmmList);
+  }
+  remove(maskedFileSrc);
+  remove(writtenFileSrc);
+}
+
+bool filterByLength(const struct P7Hmm *phmm, void *filterData){
+  testAssertString(phmm->model.matchEmissionScores == NULL, "filter was called after the model data was allocated");
+  return phmm->header.modelLength >= *(uint32_t*)filterData;
+}
+
+//compares the files line by line. Two of the single model test files had the trailing spaces HMMER
+//writes after the alphabet symbols trimmed away, so trailing blanks can optionally be ignored.
+bool filesAreIdentical(const char *fileSrc1, const char *fileSrc2, const bool ignoreTrailingBlanks){
+  FILE *file1 = fopen(fileSrc1, "r");
+  FILE *file2 = fopen(fileSrc2, "r");
+  bool identical = file1 != NULL && file2 != NULL;
+  char *line1 = NULL, *line2 = NULL;
+  size_t capacity1 = 0, capacity2 = 0;
+  while(identical){
+    ssize_t length1 = getline(&line1, &capacity1, file1);
+    ssize_t length2 = getline(&line2, &capacity2, file2);
+    if(length1 < 0 || length2 < 0){
+      identical = length1 == length2;
+      break;
+    }
+    if(ignoreTrailingBlanks){
+      while(length1 > 0 && (line1[length1 - 1] == ' ' || line1[length1 - 1] == '\n')) length1--;
+      while(length2 > 0 && (line2[length2 - 1] == ' ' || line2[length2 - 1] == '\n')) length2--;
+    }
+    identical = length1 == length2 && memcmp(line1, line2, length1) == 0;
+  }
+  free(line1);
+  free(line2);
+  if(file1 != NULL){
+    fclose(file1);
+  }
+  if(file2 != NULL){
+    fclose(file2);
+  }
+  return identical;
 }
 
 
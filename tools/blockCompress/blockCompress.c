@@ -0,0 +1,33 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../../src/p7HmmReader.h"
+
+
+//creates a block compressed container (and its .p7bi block index) from a plain hmm file.
+int main(int argc, char **argv){
+  if(argc < 3 || argc > 4){
+    fprintf(stderr, "usage: %s <input.hmm> <output.hmm.gz> [block length in bytes]\n", argv[0]);
+    return 1;
+  }
+  size_t blockLength = 0;
+  if(argc == 4){
+    char *end;
+    blockLength = strtoull(argv[3], &end, 10);
+    if(*end != '\0' || blockLength == 0){
+      fprintf(stderr, "block length must be a positive integer, got '%s'\n", argv[3]);
+      return 1;
+    }
+  }
+
+  enum P7HmmReturnCode returnCode = p7HmmBlockCompressFile(argv[1], argv[2], blockLength);
+  switch(returnCode){
+    case p7HmmSuccess:
+      return 0;
+    case p7HmmFileNotFound:
+      fprintf(stderr, "could not read '%s' or write '%s'\n", argv[1], argv[2]);
+      return 2;
+    default:
+      fprintf(stderr, "failed to block compress '%s'\n", argv[1]);
+      return 3;
+  }
+}